@@ -0,0 +1,235 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#ifndef _WIN32
+#include "evdev.hpp"
+#include "gamepad_state.hpp"
+#include "xinput_fix.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#define BITS_PER_LONG       (sizeof(unsigned long) * 8)
+#define BIT_ARRAY_SIZE(n)   (((n) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+#define TEST_BIT(bits, n)   (((bits)[(n) / BITS_PER_LONG] >> ((n) % BITS_PER_LONG)) & 1)
+
+namespace evdev
+{
+    struct button_mapping
+    {
+        uint16_t code;
+        uint16_t button;
+    };
+
+    /* The face buttons are named after their position (BTN_NORTH is the top one),
+     * which is Y on XInput pads */
+    static const button_mapping buttons[] =
+    {
+        { BTN_SOUTH, xinput_fix::CODE_A },
+        { BTN_EAST, xinput_fix::CODE_B },
+        { BTN_WEST, xinput_fix::CODE_X },
+        { BTN_NORTH, xinput_fix::CODE_Y },
+        { BTN_TL, xinput_fix::CODE_LEFT_SHOULDER },
+        { BTN_TR, xinput_fix::CODE_RIGHT_SHOULDER },
+        { BTN_SELECT, xinput_fix::CODE_BACK },
+        { BTN_START, xinput_fix::CODE_START },
+        { BTN_MODE, xinput_fix::CODE_GUIDE },
+        { BTN_THUMBL, xinput_fix::CODE_LEFT_THUMB },
+        { BTN_THUMBR, xinput_fix::CODE_RIGHT_THUMB },
+        { BTN_DPAD_UP, xinput_fix::CODE_DPAD_UP },
+        { BTN_DPAD_DOWN, xinput_fix::CODE_DPAD_DOWN },
+        { BTN_DPAD_LEFT, xinput_fix::CODE_DPAD_LEFT },
+        { BTN_DPAD_RIGHT, xinput_fix::CODE_DPAD_RIGHT }
+    };
+
+    static const uint16_t axis_codes[] =
+    {
+        ABS_X, ABS_Y, ABS_RX, ABS_RY, ABS_Z, ABS_RZ, ABS_BRAKE, ABS_GAS, ABS_HAT0X, ABS_HAT0Y
+    };
+
+    static bool is_gamepad(const char* path)
+    {
+        unsigned long keys[BIT_ARRAY_SIZE(KEY_CNT)] = {};
+        const auto fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+
+        if (fd < 0)
+            return false;
+
+        const auto result = ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keys)), keys) >= 0 && TEST_BIT(keys, BTN_GAMEPAD);
+        close(fd);
+        return result;
+    }
+
+    std::vector<std::string> find_pads()
+    {
+        std::vector<std::pair<int, std::string>> found;
+        const auto dir = opendir("/dev/input");
+
+        if (!dir)
+            return {};
+
+        while (const auto entry = readdir(dir))
+        {
+            if (strncmp(entry->d_name, "event", 5) != 0)
+                continue;
+
+            auto path = std::string("/dev/input/") + entry->d_name;
+            if (is_gamepad(path.c_str()))
+                found.emplace_back(atoi(entry->d_name + 5), path);
+        }
+        closedir(dir);
+
+        /* readdir() has no order, this keeps the pad ids the same between runs */
+        std::sort(found.begin(), found.end());
+        std::vector<std::string> paths;
+        for (const auto& pad : found)
+            paths.emplace_back(pad.second);
+        return paths;
+    }
+
+    uint16_t to_button(const uint16_t code)
+    {
+        for (const auto& mapping : buttons)
+        {
+            if (mapping.code == code)
+                return mapping.button;
+        }
+        return 0;
+    }
+
+    axis_target to_axis(const uint16_t code)
+    {
+        switch (code)
+        {
+        case ABS_X:
+            return AXIS_STICK_L_X;
+        case ABS_Y:
+            return AXIS_STICK_L_Y;
+        case ABS_RX:
+            return AXIS_STICK_R_X;
+        case ABS_RY:
+            return AXIS_STICK_R_Y;
+        case ABS_Z: /* Xbox pads */
+        case ABS_BRAKE:
+            return AXIS_TRIGGER_L;
+        case ABS_RZ:
+        case ABS_GAS:
+            return AXIS_TRIGGER_R;
+        case ABS_HAT0X:
+            return AXIS_DPAD_X;
+        case ABS_HAT0Y:
+            return AXIS_DPAD_Y;
+        default:
+            return AXIS_NONE;
+        }
+    }
+
+    /* -1 to 1 for sticks, with the center of the device range at 0 */
+    static float stick_value(const input_absinfo &info, const int32_t value)
+    {
+        if (info.maximum <= info.minimum)
+            return 0.f;
+        return 2.f * (value - info.minimum) / (info.maximum - info.minimum) - 1.f;
+    }
+
+    /* 0 to 255 for triggers like XInput */
+    static int8_t trigger_value(const input_absinfo &info, const int32_t value)
+    {
+        if (info.maximum <= info.minimum)
+            return 0;
+        return int8_t(uint8_t(255 * int64_t(value - info.minimum) / (info.maximum - info.minimum)));
+    }
+
+    static void set_buttons(gamepad::gamepad_state* state, const uint16_t mask, const bool pressed)
+    {
+        if (pressed)
+            state->button_states = int16_t(uint16_t(state->button_states) | mask);
+        else
+            state->button_states = int16_t(uint16_t(state->button_states) & ~mask);
+    }
+
+    void apply(gamepad::gamepad_state* state, const input_absinfo* axes, const input_event &event)
+    {
+        if (event.type == EV_KEY)
+        {
+            const auto button = to_button(event.code);
+            if (button)
+                set_buttons(state, button, event.value != 0);
+            return;
+        }
+
+        if (event.type != EV_ABS || event.code >= ABS_CNT)
+            return;
+
+        const auto& info = axes[event.code];
+        switch (to_axis(event.code))
+        {
+        case AXIS_STICK_L_X:
+            state->stick_l_x = stick_value(info, event.value);
+            break;
+        case AXIS_STICK_L_Y: /* Up is already negative, like on windows after inverting XInput */
+            state->stick_l_y = stick_value(info, event.value);
+            break;
+        case AXIS_STICK_R_X:
+            state->stick_r_x = stick_value(info, event.value);
+            break;
+        case AXIS_STICK_R_Y:
+            state->stick_r_y = stick_value(info, event.value);
+            break;
+        case AXIS_TRIGGER_L:
+            state->trigger_l = trigger_value(info, event.value);
+            break;
+        case AXIS_TRIGGER_R:
+            state->trigger_r = trigger_value(info, event.value);
+            break;
+        case AXIS_DPAD_X: /* Some pads report the dpad as a hat instead of buttons */
+            set_buttons(state, xinput_fix::CODE_DPAD_LEFT, event.value < 0);
+            set_buttons(state, xinput_fix::CODE_DPAD_RIGHT, event.value > 0);
+            break;
+        case AXIS_DPAD_Y:
+            set_buttons(state, xinput_fix::CODE_DPAD_UP, event.value < 0);
+            set_buttons(state, xinput_fix::CODE_DPAD_DOWN, event.value > 0);
+            break;
+        default:;
+        }
+    }
+
+    bool read_state(const int fd, gamepad::gamepad_state* state, input_absinfo* axes)
+    {
+        unsigned long keys[BIT_ARRAY_SIZE(KEY_CNT)] = {};
+        input_event event = {};
+
+        if (ioctl(fd, EVIOCGKEY(sizeof(keys)), keys) < 0)
+            return false;
+
+        *state = gamepad::gamepad_state();
+        event.type = EV_KEY;
+        for (const auto& mapping : buttons)
+        {
+            event.code = mapping.code;
+            event.value = TEST_BIT(keys, mapping.code);
+            apply(state, axes, event);
+        }
+
+        /* Axes the device doesn't have keep a range of 0, so they stay at rest */
+        event.type = EV_ABS;
+        for (const auto code : axis_codes)
+        {
+            if (ioctl(fd, EVIOCGABS(code), &axes[code]) < 0)
+                continue;
+            event.code = code;
+            event.value = axes[code].value;
+            apply(state, axes, event);
+        }
+        return true;
+    }
+}
+#endif
@@ -0,0 +1,57 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#ifndef _WIN32
+#include <linux/input.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace gamepad
+{
+    class gamepad_state;
+}
+
+/* Linux gamepads through the event interface (/dev/input/event*), which
+ * uses the same button and axis codes for every pad the kernel supports.
+ * Reading the devices usually requires being in the input group
+ */
+namespace evdev
+{
+    enum axis_target
+    {
+        AXIS_NONE,
+        AXIS_STICK_L_X,
+        AXIS_STICK_L_Y,
+        AXIS_STICK_R_X,
+        AXIS_STICK_R_Y,
+        AXIS_TRIGGER_L,
+        AXIS_TRIGGER_R,
+        AXIS_DPAD_X,
+        AXIS_DPAD_Y
+    };
+
+    /* Paths of all event devices with gamepad buttons, sorted by their number */
+    std::vector<std::string> find_pads();
+
+    /* Button code of the xinput_fix::gamepad_codes, 0 for unknown keys */
+    uint16_t to_button(uint16_t code);
+
+    axis_target to_axis(uint16_t code);
+
+    /* Applies one EV_KEY or EV_ABS event to the state. Axis
+     * ranges come from the device, so the values are normalized
+     * to the same ranges that XInput pads use */
+    void apply(gamepad::gamepad_state* state, const input_absinfo* axes, const input_event &event);
+
+    /* Reads the current state of all buttons and axes, used after opening the
+     * device and after the kernel dropped events (SYN_DROPPED) */
+    bool read_state(int fd, gamepad::gamepad_state* state, input_absinfo* axes);
+}
+#endif
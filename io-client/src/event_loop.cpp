@@ -0,0 +1,238 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#include "event_loop.hpp"
+#include "network.hpp"
+#include "uiohook.hpp"
+#include "gamepad.hpp"
+#include <atomic>
+#include <cstdio>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+
+#define EPOLL_MAX_EVENTS    (2 + PAD_COUNT)
+#define TAG_WAKE_UP         0
+#define TAG_SOCKET          1
+#define TAG_PAD             2 /* Followed by the pad index */
+#endif
+
+namespace event_loop
+{
+    /* Only the first wake_up() until the loop drained the hook events has to signal it */
+    static std::atomic<bool> wake_pending{ false };
+
+#ifdef _WIN32
+    static HANDLE wake_event = nullptr;
+    static uint32_t last_pad_poll = 0;
+#else
+    static int epoll_fd = -1;
+    static int wake_fd = -1;
+
+    static bool add_fd(const int fd, const uint64_t tag)
+    {
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u64 = tag;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0)
+            return true;
+
+        DEBUG_LOG("Adding file descriptor to epoll failed: %s\n", strerror(errno));
+        return false;
+    }
+#endif
+
+    /* Returns whichever timeout is earlier, -1 means none */
+    static int earliest(const int a, const int b)
+    {
+        if (a < 0)
+            return b;
+        if (b < 0)
+            return a;
+        return a < b ? a : b;
+    }
+
+    bool init()
+    {
+#ifdef _WIN32
+        wake_event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        if (!wake_event)
+        {
+            DEBUG_LOG("CreateEvent failed: %lu\n", GetLastError());
+            return false;
+        }
+#else
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+        if (epoll_fd < 0 || wake_fd < 0)
+        {
+            DEBUG_LOG("Creating epoll instance failed: %s\n", strerror(errno));
+            return false;
+        }
+
+        if (!add_fd(wake_fd, TAG_WAKE_UP) || !add_fd(network::socket_fd(), TAG_SOCKET))
+            return false;
+
+        if (util::cfg.monitor_gamepad)
+        {
+            for (auto i = 0; i < PAD_COUNT; i++)
+            {
+                if (gamepad::pad_handles[i].valid() && !add_fd(gamepad::pad_handles[i].fd(), TAG_PAD + i))
+                    return false;
+            }
+        }
+#endif
+        return true;
+    }
+
+    static void handle_wake_up()
+    {
+#ifndef _WIN32
+        uint64_t value;
+        if (read(wake_fd, &value, sizeof(value)) < 0 && errno != EAGAIN)
+        {
+            DEBUG_LOG("Reading wake up event failed: %s\n", strerror(errno));
+        }
+#endif
+        /* Cleared first, so events pushed during the drain signal again */
+        wake_pending = false;
+        uiohook::drain_events();
+    }
+
+    /* Waits until something happened or the timeout passed and handles it.
+     * Returns false if the connection should be closed */
+    static bool wait(int timeout)
+    {
+#ifdef _WIN32
+        /* Neither the socket nor XInput can wake us up */
+        timeout = earliest(timeout, LISTEN_TIMEOUT);
+        if (util::cfg.monitor_gamepad)
+        {
+            const auto since_poll = util::get_ticks() - last_pad_poll;
+            timeout = earliest(timeout, since_poll >= PAD_POLL_INTERVAL ? 0 : int(PAD_POLL_INTERVAL - since_poll));
+        }
+
+        if (WaitForSingleObject(wake_event, DWORD(timeout)) == WAIT_OBJECT_0)
+            handle_wake_up();
+
+        if (util::cfg.monitor_gamepad && util::get_ticks() - last_pad_poll >= PAD_POLL_INTERVAL)
+        {
+            gamepad::poll();
+            last_pad_poll = util::get_ticks();
+        }
+
+        const auto ready = netlib_check_socket_set(network::set, 0);
+        if (ready == -1)
+        {
+            DEBUG_LOG("netlib_check_socket_set failed: %s\n", netlib_get_error());
+            return false;
+        }
+        return !ready || !netlib_socket_ready(network::sock) || network::handle_message();
+#else
+        epoll_event events[EPOLL_MAX_EVENTS];
+        const auto count = epoll_wait(epoll_fd, events, EPOLL_MAX_EVENTS, timeout);
+
+        if (count < 0)
+        {
+            if (errno == EINTR) /* A signal, stop() was probably called */
+                return true;
+            DEBUG_LOG("epoll_wait failed: %s\n", strerror(errno));
+            return false;
+        }
+
+        for (auto i = 0; i < count; i++)
+        {
+            const auto tag = events[i].data.u64;
+
+            if (tag == TAG_WAKE_UP)
+            {
+                handle_wake_up();
+            }
+            else if (tag == TAG_SOCKET)
+            {
+                if (!network::handle_message())
+                    return false;
+            }
+            else
+            {
+                auto& pad = gamepad::pad_handles[tag - TAG_PAD];
+                if (!pad.read_events())
+                {
+                    DEBUG_LOG("Gamepad %i was disconnected\n", pad.get_id());
+                    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, pad.fd(), nullptr);
+                    pad.unload();
+                }
+            }
+        }
+        return true;
+#endif
+    }
+
+    void run()
+    {
+        while (network::network_loop)
+        {
+            const auto timeout = earliest(uiohook::check_wheel(), network::send_timeout());
+
+            if (!wait(timeout))
+            {
+                DEBUG_LOG("Received quit signal\n");
+                break;
+            }
+
+            if (!network::send_changes())
+                break;
+        }
+        DEBUG_LOG("Event loop exited\n");
+    }
+
+    static bool signal_loop()
+    {
+#ifdef _WIN32
+        return wake_event && SetEvent(wake_event);
+#else
+        /* write() is async signal safe, so this also works from signal handlers */
+        const uint64_t value = 1;
+        return wake_fd >= 0 && write(wake_fd, &value, sizeof(value)) == sizeof(value);
+#endif
+    }
+
+    void stop()
+    {
+        network::network_loop = false;
+        signal_loop();
+    }
+
+    void wake_up()
+    {
+        if (wake_pending.exchange(true))
+            return; /* The loop didn't drain the earlier events yet */
+        if (!signal_loop())
+            wake_pending = false;
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (wake_event)
+            CloseHandle(wake_event);
+        wake_event = nullptr;
+#else
+        if (epoll_fd >= 0)
+            ::close(epoll_fd);
+        if (wake_fd >= 0)
+            ::close(wake_fd);
+        epoll_fd = wake_fd = -1;
+#endif
+    }
+}
@@ -0,0 +1,30 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+/* Handles hook events, gamepads and the server connection on one thread.
+ * On linux it sleeps in epoll until the socket or a gamepad is readable,
+ * the hook thread wakes it up or the next message is due. Windows has no
+ * file descriptors for these, so it waits on an event and still checks
+ * the socket and XInput every LISTEN_TIMEOUT and PAD_POLL_INTERVAL
+ */
+namespace event_loop
+{
+    bool init();
+
+    /* Runs until stop() is called or the connection is lost */
+    void run();
+
+    /* Makes run() return. Safe to call from any thread and signal handlers */
+    void stop();
+
+    /* Tells the loop that hook events are queued. Safe to call from any thread */
+    void wake_up();
+
+    void close();
+}
@@ -8,20 +8,18 @@
 #include "gamepad.hpp"
 #include "network.hpp"
 #include <stdio.h>
-#include <thread>
+#ifndef _WIN32
+#include "evdev.hpp"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace gamepad
 {
     volatile bool hook_state = false;
-    volatile bool hook_run_flag = true;
 	gamepad_handle pad_handles[PAD_COUNT];
 
-#ifdef _WIN32
-    HANDLE hook_thread;
-#else
-    pthread_t game_pad_hook_thread;
-#endif
-
 	gamepad_handle::~gamepad_handle()
     {
 		unload();
@@ -32,9 +30,9 @@ namespace gamepad
 #ifdef _WIN32
 		RtlZeroMemory(&m_x_input, sizeof(xinput_fix::gamepad));
 #else
-		if (m_device_file)
-			fclose(m_device_file);
-		m_device_file = nullptr;
+		if (m_fd >= 0)
+			::close(m_fd);
+		m_fd = -1;
 #endif
     }
 
@@ -44,13 +42,19 @@ namespace gamepad
 		unload();
 		update();
 #else
-		m_device_file = fopen(m_path.c_str(), "wb+");
-		if (m_device_file)
-		{
-			void * tmp = malloc(8 * 12 * sizeof(char));
-			fread(tmp, sizeof(char) * 8 * 12, 1, m_device_file);
-			free(tmp);
-		}
+		if (m_path.empty())
+			return;
+
+		m_fd = open(m_path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+		if (m_fd < 0)
+			return;
+
+		/* Buttons that are already held down are sent right away */
+		gamepad_state state;
+		if (evdev::read_state(m_fd, &state, m_axes))
+			update_state(&state);
+		m_pending = state;
+		m_dropped = false;
 #endif
     }
 
@@ -60,24 +64,25 @@ namespace gamepad
 		update();
 		return m_valid;
 #else
-		return m_device_file != nullptr && m_pad_id >= 0;
+		return m_fd >= 0 && m_pad_id >= 0;
 #endif
     }
 
+#ifdef _WIN32
     void gamepad_handle::init(const uint8_t pad_id)
     {
-#ifdef _WIN32
 		m_pad_id = pad_id;
 		load();
+    }
 #else
+    void gamepad_handle::init(const uint8_t pad_id, const std::string &path)
+    {
 		unload();
 		m_pad_id = pad_id;
-		m_path.clear();
-		m_path = "/dev/input/js";
-		m_path.append(std::to_string(pad_id));
+		m_path = path;
 		load();
-#endif
     }
+#endif
 
     uint8_t gamepad_handle::get_id() const
     {
@@ -91,26 +96,21 @@ namespace gamepad
 
     void gamepad_handle::update_state(gamepad_state * new_state)
     {
-        if (new_state)
+        if (!new_state)
+            return;
+
+        new_state->apply_deadzones();
+        if (m_current_state.merge(new_state))
         {
-            m_mutex.lock();
-            if (m_current_state.merge(new_state))
-            {
-                m_changed = true;
-            }
-            m_mutex.unlock();
+            m_changed = true;
+            network::notify_changes(network::get_timestamp());
         }
     }
 
 #ifdef _WIN32
     void gamepad_handle::update()
     {
-        m_mutex.lock();
-		if (xinput_fix::update(m_pad_id, &m_x_input) == ERROR_SUCCESS)
-			m_valid = true;
-		else
-			m_valid = false;
-        m_mutex.unlock();
+		m_valid = xinput_fix::update(m_pad_id, &m_x_input) == ERROR_SUCCESS;
     }
 
     xinput_fix::gamepad* gamepad_handle::get_xinput()
@@ -119,15 +119,57 @@ namespace gamepad
     }
 
 #else
-	FILE * gamepad_state::dev()
+	int gamepad_handle::fd() const
+	{
+		return m_fd;
+	}
+
+	bool gamepad_handle::read_events()
 	{
-		return m_device_file;
+		input_event events[32];
+
+		for (;;)
+		{
+			const auto length = read(m_fd, events, sizeof(events));
+			if (length < 0 && errno == EINTR)
+				continue;
+			if (length < 0)
+				return errno == EAGAIN; /* ENODEV once the pad is unplugged */
+			if (length == 0)
+				return false;
+
+			for (size_t i = 0; i < size_t(length) / sizeof(input_event); i++)
+			{
+				const auto& event = events[i];
+
+				if (event.type == EV_SYN && event.code == SYN_DROPPED)
+				{
+					/* Everything until the next report is incomplete, the state is read again then */
+					m_dropped = true;
+				}
+				else if (event.type == EV_SYN && event.code == SYN_REPORT)
+				{
+					if (m_dropped && !evdev::read_state(m_fd, &m_pending, m_axes))
+						return false;
+					m_dropped = false;
+
+					/* All changes of one report are merged at once, so a stick
+					 * moving diagonally is only one change instead of two */
+					auto state = m_pending;
+					update_state(&state);
+				}
+				else if (!m_dropped)
+				{
+					evdev::apply(&m_pending, m_axes, event);
+				}
+			}
+		}
 	}
 #endif
 
     /* Hook util methods */
 
-	bool start_pad_hook(bool threaded)
+	bool start_pad_hook()
 	{
 		if (hook_state)
 			return true;
@@ -141,28 +183,9 @@ namespace gamepad
 			return false;
 		}
 #endif
-		hook_state = hook_run_flag = init_pads();
+		hook_state = init_pads();
         if (!hook_state)
-        {
             DEBUG_LOG("Initializing gamepads failed\n");
-            return false;
-        }
-
-        if (threaded)
-        {
-#ifdef _WIN32
-		    hook_thread = CreateThread(nullptr, 0, static_cast<LPTHREAD_START_ROUTINE>(hook_method),
-			    nullptr, 0, nullptr);
-		    hook_state = hook_thread;
-#else
-            hook_state = pthread_create(&game_pad_hook_thread, nullptr, hook_method, nullptr) == 0;
-#endif
-        }
-        else
-        {
-            hook_state = true;
-            hook_method(nullptr);
-        }
         return hook_state;
 	}
 
@@ -170,9 +193,19 @@ namespace gamepad
 	{
 		uint8_t id = 0;
 		auto flag = false;
+#ifndef _WIN32
+		const auto paths = evdev::find_pads();
+		if (paths.empty())
+			DEBUG_LOG("No gamepads found in /dev/input, reading them might require being in the input group\n");
+#endif
 		for (auto& state : pad_handles)
 		{
+#ifdef _WIN32
 			state.init(id++);
+#else
+			state.init(id, id < paths.size() ? paths[id] : std::string());
+			id++;
+#endif
 			if (state.valid())
 				flag = true;
 		}
@@ -189,8 +222,12 @@ namespace gamepad
 		if (!hook_state)
 			return;
 		hook_state = false;
-		hook_run_flag = false;
+
+        for (auto& pad : pad_handles)
+            pad.unload();
+#ifdef _WIN32
         xinput_fix::unload();
+#endif
 	}
 
     bool check_changes()
@@ -203,41 +240,16 @@ namespace gamepad
         return false;
     }
 
-    /* Background process for querying game pads */
 #ifdef _WIN32
-	DWORD WINAPI hook_method(const LPVOID arg)
-#else
-    void* hook_method(void *)
-#endif
+    void poll()
     {
-        /* The hook only keeps track of the gamepad states here
-         * and the changes will then be sent in a different thread
-         */
-		while (hook_run_flag)
-		{
-            for (auto& pad : pad_handles)
-            {
-                if (!pad.valid())
-                    continue;
-#ifdef _WIN32
-                gamepad_state new_state(pad.get_xinput());
-                pad.update_state(&new_state);
-#else
-                /* TODO: Linux implementation */
-#endif
-            }
-#ifdef _WIN32
-            Sleep(25);
-#endif
-		}
-
         for (auto& pad : pad_handles)
-            pad.unload();
-
-#ifdef _WIN32
-		return 0x0;
-#else
-		pthread_exit(nullptr);
-#endif
+        {
+            if (!pad.valid())
+                continue;
+            gamepad_state new_state(pad.get_xinput());
+            pad.update_state(&new_state);
+        }
     }
+#endif
 }
@@ -7,23 +7,21 @@
 
 #pragma once
 #include <stdint.h>
-#include <mutex>
+#include <string>
 #include "gamepad_state.hpp"
 #include "xinput_fix.hpp"
+#ifndef _WIN32
+#include <linux/input.h>
+#endif
 
 #define PAD_COUNT 4
+#define PAD_POLL_INTERVAL 25 /* ms between XInput updates, which can't notify us about changes */
 
 namespace gamepad
 {
-#ifdef _WIN32
-    extern HANDLE hook_thread;
-#else
-    extern pthread_t game_pad_hook_thread;
-#endif
     class gamepad_handle;
     extern gamepad_handle pad_handles[PAD_COUNT];
     extern volatile bool hook_state;
-    extern volatile bool hook_run_flag;
 
     static xinput_fix::gamepad_codes pad_keys[] =
 	{ /* These keycodes are only used on windows,
@@ -44,21 +42,6 @@ namespace gamepad
 		xinput_fix::CODE_START,
 		xinput_fix::CODE_BACK
 	};
-#ifndef _WIN32
-#define ID_TYPE         6
-#define ID_BUTTON       1
-#define ID_STATE_1      4
-#define ID_STATE_2      5
-#define ID_KEY_CODE     7
-#define ID_PRESSED      1
-
-#define ID_L_ANALOG_X   0
-#define ID_L_ANALOG_Y   1
-#define ID_L_TRIGGER    2
-#define ID_R_ANALOG_X   3
-#define ID_R_ANALOG_Y   4
-#define ID_R_TRIGGER    5
-#endif /* !WINDOWS */
 
 	class gamepad_handle
 	{
@@ -71,45 +54,56 @@ namespace gamepad
 
 		bool valid();
 
+#ifdef _WIN32
 		void init(const uint8_t pad_id);
+#else
+		void init(const uint8_t pad_id, const std::string &path);
+#endif
 
 		uint8_t get_id() const;
 
         gamepad_state* get_state();
 
+        /* Applies the deadzones to the new state and takes it over if it differs */
         void update_state(gamepad_state* new_state);
 
         bool m_changed = false;
+        gamepad_state m_sent_state; /* Last state sent to the server */
 #ifdef _WIN32
 		void update();
 		xinput_fix::gamepad* get_xinput();
 	private:
-        std::mutex m_mutex;
 		xinput_fix::gamepad m_x_input = {};
 		bool m_valid = false;
 #else
-		FILE* dev();
+		/* Non blocking file descriptor of the device, -1 if it isn't open */
+		int fd() const;
+
+		/* Reads all pending events, returns false if the device is gone */
+		bool read_events();
 
 	private:
-		FILE* m_device_file = nullptr;
+		int m_fd = -1;
 		std::string m_path;
+		input_absinfo m_axes[ABS_CNT] = {}; /* Ranges of the axes the device has */
+		gamepad_state m_pending; /* Changes since the last SYN_REPORT */
+		bool m_dropped = false;  /* The kernel dropped events, m_pending has to be read again */
 #endif
 		int8_t m_pad_id = -1;
 		gamepad_state m_current_state;
         
     };
 
-    /* Thread stuff*/
-	bool start_pad_hook(bool threaded);
+    /* The pads are read by the event loop, there's no separate thread */
+	bool start_pad_hook();
 	bool init_pads();
 	void close();
 
     bool check_changes();
 
 #ifdef _WIN32
-	DWORD WINAPI hook_method(LPVOID arg);
-#else
-	void* hook_method(void*);
+    /* Updates all pads from XInput, called every PAD_POLL_INTERVAL */
+    void poll();
 #endif
 
 
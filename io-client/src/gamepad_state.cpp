@@ -7,6 +7,8 @@
 
 #include "gamepad_state.hpp"
 #include "xinput_fix.hpp"
+#include "util.hpp"
+#include <math.h>
 #include "../../io-obs/util/layout_constants.hpp"
 #define IO_CLIENT 1 /* Prevents external util.hpp from including obs headers */
 #include "../../io-obs/util/util.hpp"
@@ -20,6 +22,7 @@ namespace gamepad
 		trigger_l = trigger_r = 0;
 	}
 
+#ifdef _WIN32
     gamepad_state::gamepad_state(xinput_fix::gamepad* pad)
     {
         if (pad)
@@ -36,46 +39,43 @@ namespace gamepad
             trigger_r = pad->bRightTrigger;
         }
     }
+#endif
+
+    static float stick_deadzone(const float value)
+    {
+        if (fabsf(value) * 100 < util::cfg.stick_deadzone)
+            return 0.f;
+        return roundf(value * STICK_STEPS) / STICK_STEPS;
+    }
+
+    static int8_t trigger_deadzone(const int8_t value)
+    {
+        return uint8_t(value) < util::cfg.trigger_deadzone ? 0 : value;
+    }
+
+    void gamepad_state::apply_deadzones()
+    {
+        stick_l_x = stick_deadzone(stick_l_x);
+        stick_l_y = stick_deadzone(stick_l_y);
+        stick_r_x = stick_deadzone(stick_r_x);
+        stick_r_y = stick_deadzone(stick_r_y);
+        trigger_l = trigger_deadzone(trigger_l);
+        trigger_r = trigger_deadzone(trigger_r);
+    }
 
     bool gamepad_state::merge(gamepad_state* new_state)
     {
 		if (!new_state)
 			return false;
-        auto merged = false;
-#ifdef _WIN32 
-	    /* On windows the new state contains all changes -> No merging needed*/
-        if (new_state->button_states != button_states)
-            merged = true;
-        /* TODO: Dead zones might need tweaking */
-        else if (abs(new_state->stick_l_x - stick_l_x) > 0.1f) 
-            merged = true;                           
-        else if (abs(new_state->stick_l_y - stick_l_y) > 0.1f)
-            merged = true;
-        else if (abs(new_state->stick_r_x - stick_r_x) > 0.1f)
-            merged = true;
-        else if (abs(new_state->stick_r_y - stick_r_y) > 0.1f)
-            merged = true;
-        else if (abs(new_state->trigger_l - trigger_l) > 10)
-            merged = true;
-        else if (abs(new_state->trigger_r - trigger_r) > 10)
-            merged = true;
-
-        if (merged)
-        {
-            button_states = new_state->button_states;
-            stick_l_x = new_state->stick_l_x;
-            stick_l_y = new_state->stick_l_y;
-            stick_r_x = new_state->stick_r_x;
-            stick_r_y = new_state->stick_r_y;
-            trigger_l = new_state->trigger_l;
-            trigger_r = new_state->trigger_r;   
-        }
-
-#else   /* On linux old values should be kept and if needed overridden by new ones */
 
-        /*TODO: implementation*/
-#endif
+        /* Both states went through apply_deadzones(), so any difference is a real change */
+        const auto merged = new_state->button_states != button_states ||
+            new_state->stick_l_x != stick_l_x || new_state->stick_l_y != stick_l_y ||
+            new_state->stick_r_x != stick_r_x || new_state->stick_r_y != stick_r_y ||
+            new_state->trigger_l != trigger_l || new_state->trigger_r != trigger_r;
 
+        if (merged)
+            *this = *new_state;
 		return merged;
 	}
 }
@@ -9,6 +9,8 @@
 #include <cstdint>
 #include "xinput_fix.hpp"
 
+#define STICK_STEPS 128 /* Sticks are rounded to this many steps per direction, so noise isn't sent */
+
 namespace gamepad
 {
 	/* Contains the current state of a gamepad*/
@@ -18,9 +20,12 @@ namespace gamepad
         gamepad_state();
 #ifdef _WIN32
 	    explicit gamepad_state(xinput_fix::gamepad* pad);
-#else
-        /* Linux constructor */
 #endif
+        /* Sets sticks and triggers inside the configured deadzones to rest and rounds the sticks.
+         * Both platforms do this before merging, so jitter doesn't count as a change */
+        void apply_deadzones();
+
+        /* Takes over the new state if it differs, returns whether it did */
 	    bool merge(gamepad_state* new_state);
 
 		int16_t button_states;
@@ -10,18 +10,17 @@
 #include "network.hpp"
 #include "uiohook.hpp"
 #include "gamepad.hpp"
+#include "event_loop.hpp"
 
 /* Catch Application closing */
 void sig_int__handler(int signal)
 {
-    network::network_loop = false;
-    gamepad::hook_run_flag = false;
+    event_loop::stop();
 }
 
 void sig_break__handler(int signal)
 {
-    network::network_loop = false;
-    gamepad::hook_run_flag = false;
+    event_loop::stop();
 }
 
 
@@ -44,36 +43,34 @@ int main(int argc, char **argv)
         return util::RET_NO_HOOKS;
     }
 
-	if (!network::start_connection()) /* Starts a separate network thread */
+	if (!network::start_connection())
 	{
 		network::close();
 		return util::RET_CONNECTION;
 	}
 
-    /* This will block if uiohook isn't running */
-    if (util::cfg.monitor_gamepad)
+    if (util::cfg.monitor_gamepad && !gamepad::start_pad_hook())
     {
-        auto threaded = util::cfg.monitor_keyboard || util::cfg.monitor_mouse;
-        if (threaded)
-        {
-            if (!gamepad::start_pad_hook(true))
-            {
-                printf("Gamepad hook initialization failed!\n");
-                return util::RET_GAMEPAD_INIT;
-            }
-        }
-        else
-        {
-            gamepad::start_pad_hook(false);
-        }
+        printf("Gamepad hook initialization failed!\n");
+        util::close_all();
+        return util::RET_GAMEPAD_INIT;
 	}
-    
+
+    if (!event_loop::init())
+    {
+        util::close_all();
+        return util::RET_EVENT_LOOP_INIT;
+    }
+
+    /* uiohook runs on its own thread and queues its events for the event loop */
     if ((util::cfg.monitor_keyboard || util::cfg.monitor_mouse) && !uiohook::init())
     {
         printf("uiohook init failed\n");
+        util::close_all();
         return util::RET_UIOHOOK_INIT;
     }
 
+    event_loop::run();
     util::close_all();
 
 	return 0;
@@ -9,9 +9,14 @@
 #include "network.hpp"
 #include "util.hpp"
 #include <cstdio>
+#include <chrono>
+#include <random>
 #include "gamepad.hpp"
+#include "../../io-obs/network/wire_format.hpp"
+#define IO_CLIENT
+#include "../../io-obs/util/util.hpp"
 #ifdef UNIX
-#include <pthread.h>
+#include <unistd.h>
 #endif
 
 namespace network
@@ -22,16 +27,26 @@ namespace network
 
     volatile bool need_refresh = false;
     volatile bool data_block = false;
+    volatile uint8_t protocol_version = 1;
     volatile bool network_loop = true;
     
     bool connected = false;
     bool state = false;
 
-#ifdef _WIN32
-	static HANDLE network_thread;
-#else
-	static pthread_t network_thread;
-#endif
+    /* Only used by the event loop */
+    static bool data_changed = false;
+    static uint32_t change_time = 0;    /* First change since the last message, the push window starts here */
+    static bool new_input = false;
+    static uint32_t input_time = 0;
+
+    static std::chrono::steady_clock::time_point connection_start;
+
+    /* Only used once the server agreed on udp */
+    static udp_socket udp = nullptr;
+    static udp_packet* packet = nullptr;
+    static bool udp_active = false;
+    static uint32_t udp_token = 0;
+    static uint32_t last_snapshot = 0;
 
     bool start_connection()
     {
@@ -73,130 +88,256 @@ namespace network
 			return false;
         }
 
-        if (!start_thread())
+        /* Tell server which protocol version we support and that
+         * we'll send data without being asked for it */
+        buffer->write_pos = 0;
+        if (!netlib_write_uint8(buffer, MSG_HELLO) || !netlib_write_uint8(buffer, PROTOCOL_VERSION) ||
+            (util::cfg.push_window && !netlib_write_uint8(buffer, MSG_PUSH_MODE)) ||
+            !netlib_tcp_send_buf_smart(sock, buffer))
         {
-			DEBUG_LOG("Failed to create network thread.\n");
-			return false;
+            DEBUG_LOG("Failed to send protocol handshake: %s\n", netlib_get_error());
+            return false;
         }
+        connection_start = std::chrono::steady_clock::now();
         connected = true;
 		return true;
     }
 
-    bool start_thread()
+    /* Writes the frame header right in front of the data after FRAME_HEADER_MAX and sends both */
+    static bool send_frame()
     {
-#ifdef _WIN32
-		network_thread = CreateThread(nullptr, 0, static_cast<LPTHREAD_START_ROUTINE>(network_thread_method),
-			nullptr, 0, nullptr);
-		return network_thread;
-#else
-		return pthread_create(&network_thread, nullptr, network_thread_method, nullptr) == 0;
-#endif
+        const auto length = buffer->write_pos - FRAME_HEADER_MAX;
+        if (length <= 0)
+            return true;
+
+        const auto start = FRAME_HEADER_MAX - 1 - wire::varint_size(length);
+        netlib_byte_buf header = { buffer->data + start, uint8_t(FRAME_HEADER_MAX - start), 0, 0 };
+        netlib_write_uint8(&header, MSG_FRAME);
+        wire::write_varint(&header, length);
+
+        const auto size = buffer->write_pos - start;
+        return netlib_tcp_send(sock, buffer->data + start, size) >= size;
     }
 
-#ifdef _WIN32
-	DWORD WINAPI network_thread_method(const LPVOID arg)
-#else
-	void* network_thread_method(void *)
-#endif
-	{
-        while (network_loop)
+    /* Opens the udp socket and tells the server which token our snapshots use */
+    static bool start_udp()
+    {
+        std::random_device random;
+
+        udp = netlib_udp_open(0);
+        packet = udp ? netlib_alloc_packet(UDP_PACKET_SIZE) : nullptr;
+        if (!packet || netlib_udp_bind(udp, 0, &util::cfg.ip) == -1)
+            return false;
+        netlib_udp_set_packet_loss(udp, util::cfg.udp_loss);
+
+        while (!udp_token) /* 0 is used for clients without udp */
+            udp_token = random();
+
+        buffer->write_pos = 0;
+        if (!netlib_write_uint8(buffer, MSG_UDP_MODE) || !wire::write_varint(buffer, udp_token) ||
+            !netlib_tcp_send_buf_smart(sock, buffer))
+            return false;
+
+        udp_active = true;
+        return true;
+    }
+
+    /* Sends the full state, so a lost packet is replaced by the next one */
+    static bool send_snapshot()
+    {
+        static uint32_t sequence = 0;
+        netlib_byte_buf view = { packet->data, UDP_PACKET_SIZE, 0, 0 };
+
+        if (!netlib_write_uint8(&view, MSG_SNAPSHOT) || !wire::write_varint(&view, udp_token) ||
+            !wire::write_varint(&view, sequence) || !wire::write_varint(&view, take_input_time()) ||
+            !uiohook::data.write_snapshot(&view) || !util::write_gamepad_snapshot(&view))
+            return false;
+
+        sequence++;
+        last_snapshot = get_timestamp();
+        packet->len = view.write_pos;
+        return netlib_udp_send(udp, 0, packet) > 0;
+    }
+
+    int send_timeout()
+    {
+        if (need_refresh)
+            return 0;
+
+        const auto now = get_timestamp();
+        auto timeout = -1;
+
+        if (util::cfg.push_window && data_changed)
+            timeout = UTIL_MAX(int(change_time + util::cfg.push_window - now), 0);
+        if (udp_active)
+        {
+            const auto repeat = UTIL_MAX(int(last_snapshot + SNAPSHOT_INTERVAL - now), 0);
+            timeout = timeout < 0 ? repeat : UTIL_MIN(timeout, repeat);
+        }
+        return timeout;
+    }
+
+    bool send_changes()
+    {
+        const auto now = get_timestamp();
+
+        /* Everything that happened during the push window is collected into one message */
+        const auto push = util::cfg.push_window && data_changed && now - change_time >= util::cfg.push_window;
+        /* Snapshots are repeated even without changes, in case the last one got lost */
+        const auto repeat = udp_active && now - last_snapshot >= SNAPSHOT_INTERVAL;
+
+        if (!need_refresh && !push && !repeat)
+            return true;
+        data_changed = false;
+
+        if (udp_active)
+        {
+            if (!send_snapshot())
+            {
+                DEBUG_LOG("Sending snapshot failed: %s\n", netlib_get_error());
+                return false;
+            }
+            need_refresh = false;
+            return true;
+        }
+
+        /* Space for the frame header is left at the start */
+        buffer->write_pos = protocol_version >= 3 ? FRAME_HEADER_MAX : 0;
+        if (protocol_version >= 2)
+        {
+            /* The server keeps the state, so it only needs what changed */
+            if (!util::write_input_delta())
+            {
+                DEBUG_LOG("Failed to write input delta to buffer. Exiting...\n");
+                return false;
+            }
+        }
+        else
         {
-            if (!listen()) /* Has a timeout of 25ms*/
+            if (gamepad::check_changes() && !util::write_gamepad_data())
             {
-				DEBUG_LOG("Received quit signal\n");
-                util::close_all();
-				break;
+                DEBUG_LOG("Failed to write gamepad event data to buffer. Exiting...\n");
+                return false;
             }
 
-            /* Reset scroll wheel if no scroll event happened */
-            if (util::get_ticks() - uiohook::data.get_last_scroll() >= SCROLL_TIMEOUT)
+            /* Pushed data only contains what changed, a refresh request gets everything */
+            if (!uiohook::data.write_to_buffer(network::buffer, !need_refresh))
             {
-                uiohook::data.reset_wheel();
+                DEBUG_LOG("Writing uiohook data to buffer failed: %s\n", netlib_get_error());
+                return false;
             }
+        }
 
-            if (need_refresh)
+        if (protocol_version >= 3)
+        {
+            if (!send_frame())
             {
-                std::lock_guard<std::mutex> lock(uiohook::m_mutex);
+                DEBUG_LOG("Sending frame failed: %s\n", netlib_get_error());
+                return false;
+            }
+        }
+        else
+        {
+            if (buffer->write_pos > 0 && !netlib_write_uint8(network::buffer, MSG_END_BUFFER))
+            {
+                DEBUG_LOG("Writing buffer end failed: %s\n", netlib_get_error());
+                return false;
+            }
 
-                buffer->write_pos = 0;
-                if (gamepad::check_changes() && !util::write_gamepad_data())
-                {
-                    DEBUG_LOG("Failed to write gamepad event data to buffer. Exiting...\n");
-                    break;
-                }
+            if (buffer->write_pos > 0 && !netlib_tcp_send_buf_smart(sock, buffer))
+            {
+                DEBUG_LOG("netlib_tcp_send_buf_smart: %s\n", netlib_get_error());
+                return false;
+            }
+        }
+
+        need_refresh = false;
+        return true;
+    }
 
-                if (!uiohook::data.write_to_buffer(network::buffer))
+    bool handle_message()
+    {
+        switch (util::recv_msg())
+        {
+        case MSG_NAME_NOT_UNIQUE:
+            DEBUG_LOG("Nickname is already in use. Disconnecting...\n");
+            return false;
+        case MSG_NAME_INVALID:
+            DEBUG_LOG("Nickname is not valid. Disconnecting...\n");
+            return false;
+        case MSG_SERVER_SHUTDOWN:
+            DEBUG_LOG("Server is shutting down.\n");
+            return false;
+        case MSG_READ_ERROR:
+            DEBUG_LOG("Couldn't read message.\n");
+            return false;
+        case MSG_HELLO:
+            {
+                uint8_t version = 0;
+                if (netlib_tcp_recv(sock, &version, sizeof(version)) < int(sizeof(version)) || !version)
                 {
-                    DEBUG_LOG("Writing uiohook data to buffer failed: %s\n", netlib_get_error());
-                    break;
+                    DEBUG_LOG("Couldn't read protocol version.\n");
+                    return false;
                 }
+                DEBUG_LOG("Using protocol version %i\n", version);
+                protocol_version = version;
 
-                if (!netlib_write_uint8(network::buffer, MSG_END_BUFFER))
+                if (util::cfg.udp && version >= 4 && !start_udp())
                 {
-                    DEBUG_LOG("Writing buffer end failed: %s\n", netlib_get_error());
-                    break;
+                    DEBUG_LOG("Couldn't start udp, using tcp instead: %s\n", netlib_get_error());
                 }
-
-                if (buffer->write_pos > 0 && !netlib_tcp_send_buf_smart(sock, buffer))
+            }
+            return true;
+        case MSG_REFRESH:
+            need_refresh = true;
+            return true;
+        case MSG_PING_CLIENT: /* Answered with our time since version 5, so the server can sync clocks */
+            if (protocol_version >= 5)
+            {
+                uint8_t data[6];
+                netlib_byte_buf pong = { data, sizeof(data), 0, 0 };
+                if (!netlib_write_uint8(&pong, MSG_PONG) || !wire::write_varint(&pong, get_timestamp()) ||
+                    !netlib_tcp_send_buf_smart(sock, &pong))
                 {
-                    DEBUG_LOG("netlib_tcp_send_buf_smart: %s\n", netlib_get_error());
-                    break;
+                    DEBUG_LOG("Answering ping failed: %s\n", netlib_get_error());
+                    return false;
                 }
-
-                
-                need_refresh = false;
             }
+            return true;
+        default:
+        case MSG_INVALID:
+            return false;
         }
+    }
 
-        DEBUG_LOG("Network loop exited\n");
-
-#ifdef _WIN32
-		return 0;
-#else
-		pthread_exit(nullptr);
-#endif
-	}
-
-	int numready = 0;
-    bool listen()
+    void notify_changes(const uint32_t time)
     {
-		numready = netlib_check_socket_set(set, LISTEN_TIMEOUT);
+        if (!new_input)
+            input_time = time;
+        if (!data_changed)
+            change_time = time;
+        new_input = true;
+        data_changed = true;
+    }
 
-		if (numready == -1)
-		{
-            DEBUG_LOG("netlib_check_socket_set failed: %s\n", netlib_get_error());
-			return false;
-		}
+    uint32_t take_input_time()
+    {
+        new_input = false;
+        return input_time;
+    }
 
-        if (numready && netlib_socket_ready(sock))
-        {
-			auto msg = util::recv_msg();
+    uint32_t get_timestamp()
+    {
+        return uint32_t(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - connection_start).count());
+    }
 
-            switch (msg)
-            {
-			case MSG_NAME_NOT_UNIQUE:
-				DEBUG_LOG("Nickname is already in use. Disconnecting...\n");
-				return false;
-			case MSG_NAME_INVALID:
-				DEBUG_LOG("Nickname is not valid. Disconnecting...\n");
-				return false;
-			case MSG_SERVER_SHUTDOWN:
-				DEBUG_LOG("Server is shutting down.\n");
-				return false;
-			case MSG_READ_ERROR:
-				DEBUG_LOG("Couldn't read message.\n");
-				return false;
-            case MSG_REFRESH:
-                need_refresh = true; /* fallthrough */
-            case MSG_PING_CLIENT: /* NO-OP needed */
-                return true;
-			default:
-			case MSG_INVALID:
-				return false;
-            }
-        }
-		return true;
+#ifndef _WIN32
+    int socket_fd()
+    {
+        return netlib_socket_fd(sock);
     }
+#endif
 
     bool init()
 	{
@@ -206,7 +347,7 @@ namespace network
 			return false;
 		}
 
-		buffer = netlib_alloc_byte_buf(BUFFER_SIZE);
+		buffer = netlib_alloc_byte_buf(BUFFER_SIZE + FRAME_HEADER_MAX);
 
         if (!buffer)
         {
@@ -237,9 +378,12 @@ namespace network
 #else
         usleep(100 * 1000);
 #endif
-        network_loop = false;
 
         netlib_tcp_close(sock);
+        if (packet)
+            netlib_free_packet(packet);
+        if (udp)
+            netlib_udp_close(udp);
         netlib_free_byte_buf(buffer);
         netlib_quit();
         buffer = NULL;
@@ -12,9 +12,11 @@
 #endif
 #include "util.hpp"
 
- /* We need 85 bytes if all four gamepads are sent + 32 bytes if all buttons are pressed down */
-#define BUFFER_SIZE     118
-#define LISTEN_TIMEOUT  25
+ /* We need 85 bytes if all four gamepads are sent + 32 bytes if all buttons are pressed down
+  * + 110 bytes for a full mouse path */
+#define BUFFER_SIZE     228
+#define LISTEN_TIMEOUT  25 /* ms between socket checks on windows, where the event loop can't wait for it */
+#define PUSH_WINDOW_MAX 16
 
 namespace network
 {
@@ -22,20 +24,39 @@ namespace network
 	extern netlib_socket_set set;
     extern bool connected;
     extern bool state;
-	extern volatile bool network_loop;
-    extern volatile bool need_refresh;  /* Set to true by other threads */
+	extern volatile bool network_loop;  /* Cleared to stop the event loop */
+    extern volatile bool need_refresh;  /* Set to true when the server asks for all data */
+    extern volatile uint8_t protocol_version; /* Agreed on with the server, 1 until it answered MSG_HELLO */
     extern volatile bool data_block;    /* Set to true to prevent other threads from modifying data, which is about to be sent */
 	extern netlib_byte_buf* buffer;     /* Shared buffer for writing data, which will be sent to the server */
 	
 	bool init();
 	bool start_connection();
-	bool start_thread();
-	bool listen();
 
-#ifdef _WIN32
-	DWORD WINAPI network_thread_method(LPVOID arg);
-#else
-	void* network_thread_method(void*);
+	/* Handles one message from the server, once the socket is readable.
+	 * Returns false if the connection should be closed */
+	bool handle_message();
+
+	/* Called by the event loop after the data of a hook changed, so it's pushed
+	 * to the server after the push window. Time is when the hook received it */
+	void notify_changes(uint32_t time);
+
+	/* Timestamp of the oldest change since the last call, or of the
+	 * last change if nothing changed since. Used for latency measurement */
+	uint32_t take_input_time();
+
+	/* Milliseconds until send_changes() has something to do, -1 if it has to wait for input */
+	int send_timeout();
+
+	/* Sends everything that is due, returns false if sending failed */
+	bool send_changes();
+
+	/* Milliseconds since the connection was opened, used as the MSG_INPUT_DELTA timestamp */
+	uint32_t get_timestamp();
+
+#ifndef _WIN32
+	/* File descriptor of the tcp socket, for epoll */
+	int socket_fd();
 #endif
 
 	void close();
@@ -6,45 +6,72 @@
  */
 
 #include "uiohook.hpp"
+#include <condition_variable>
 #include <cstdarg>
 #include <cstdio>
+#include <mutex>
 #include "network.hpp"
 #include "gamepad.hpp"
+#include "event_loop.hpp"
+#include "../../io-obs/network/wire_format.hpp"
 #define IO_CLIENT
 #include "../../io-obs/util/util.hpp"
 
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#endif
+
 namespace uiohook
 {
-    std::mutex m_mutex;
     data_holder data;
     volatile bool hook_state = false;
+    spsc_ring<hook_event, HOOK_RING_SIZE> event_ring;
 
-    data_holder::data_holder(): m_mouse_x(0), m_mouse_y(0), m_wheel_direction(wheel_none), m_new_mouse_data(false)
+    /* Lets init() wait until the hook either started or failed */
+    static std::mutex start_mutex;
+    static std::condition_variable start_signal;
+    static bool hook_done = false;
+    static int hook_status = UIOHOOK_SUCCESS;
+
+#ifdef _WIN32
+    static HANDLE hook_thread = nullptr;
+#else
+    static pthread_t hook_thread;
+    static bool hook_thread_started = false;
+#endif
+
+    data_holder::data_holder(): m_mouse_x(0), m_mouse_y(0), m_wheel_direction(wheel_none), m_wheel_amount(0),
+        m_wheel_pressed(false), m_new_mouse_data(false), m_new_button_data(false), m_last_scroll(0),
+        m_mouse_path(), m_mouse_path_size(0), m_sent_mouse_time(0),
+        m_sent_mouse_x(0), m_sent_mouse_y(0), m_sent_wheel_direction(wheel_none), m_sent_wheel_pressed(false)
     {
     }
 
-    void data_holder::set_button(const uint16_t keycode, const bool pressed)
+    bool data_holder::set_button(const uint16_t keycode, const bool pressed)
     {
-        m_mutex.lock();
+        auto changed = false;
         if (pressed)
-            m_button_states[keycode] = pressed;
+            changed = m_button_states.emplace(keycode, pressed).second;
         else
-            m_button_states.erase(keycode);
-        m_mutex.unlock();
+            changed = m_button_states.erase(keycode) > 0;
+        m_new_button_data = m_new_button_data || changed;
+        return changed; /* Key repeat doesn't change anything */
     }
 
-    void data_holder::set_mouse_pos(const int16_t x, const int16_t y)
+    bool data_holder::set_mouse_pos(const int16_t x, const int16_t y, const uint32_t time)
     {
-        m_mutex.lock();
         m_mouse_x = x;
         m_mouse_y = y;
         m_new_mouse_data = true;
-        m_mutex.unlock();
+
+        wire::add_path_sample(m_mouse_path, m_mouse_path_size, { time, x, y });
+        return true;
     }
 
-    void data_holder::set_wheel(int amount, wheel_dir dir)
+    bool data_holder::set_wheel(int amount, wheel_dir dir)
     {
-        m_mutex.lock();
         if (dir != m_wheel_direction)
             m_wheel_amount = amount;
         else
@@ -52,39 +79,45 @@ namespace uiohook
         m_wheel_direction = dir;
         m_new_mouse_data = true;
         m_last_scroll = util::get_ticks();
-        m_mutex.unlock();
+        return true;
     }
 
-    void data_holder::reset_wheel()
+    bool data_holder::reset_wheel()
     {
-        m_mutex.lock();
-        m_new_mouse_data = true;
+        const auto changed = m_wheel_direction != wheel_none;
+        m_new_mouse_data = m_new_mouse_data || changed;
         m_wheel_direction = wheel_none;
-        m_mutex.unlock();
+        return changed;
     }
 
-    void data_holder::set_wheel(bool pressed)
+    bool data_holder::set_wheel(bool pressed)
     {
-        m_mutex.lock();
         m_new_mouse_data = true;
         m_wheel_pressed = pressed;
-        m_mutex.unlock();
+        return true;
     }
 
-    bool data_holder::write_to_buffer(netlib_byte_buf* buffer)
+    bool data_holder::write_to_buffer(netlib_byte_buf* buffer, const bool only_changes)
     {
-        /* Message always sends both mouse and button data. */
+        /* Button data always contains all pressed buttons, the server replaces its old state with it */
 
         auto success = true;
 
-        if (netlib_write_uint8(buffer, MSG_BUTTON_DATA))
+        if (!only_changes || m_new_button_data)
         {
-            if (netlib_write_uint8(buffer, int(m_button_states.size())))
+            if (netlib_write_uint8(buffer, MSG_BUTTON_DATA))
             {
-                for (const auto& data : m_button_states)
+                if (netlib_write_uint8(buffer, int(m_button_states.size())))
                 {
-                    if (!netlib_write_uint16(buffer, data.first))
-                        success = false;
+                    for (const auto& data : m_button_states)
+                    {
+                        if (!netlib_write_uint16(buffer, data.first))
+                            success = false;
+                    }
+                }
+                else
+                {
+                    success = false;
                 }
             }
             else
@@ -92,10 +125,8 @@ namespace uiohook
                 success = false;
             }
         }
-        else
-        {
-            success = false;
-        }
+        m_new_button_data = false;
+        m_sent_button_states = m_button_states;
 
         if (m_new_mouse_data)
         {
@@ -107,16 +138,96 @@ namespace uiohook
             
             /* TODO: write other mouse data */
             m_new_mouse_data = false;
+            m_mouse_path_size = 0;
+            m_sent_mouse_x = m_mouse_x;
+            m_sent_mouse_y = m_mouse_y;
+            m_sent_wheel_direction = m_wheel_direction;
+            m_sent_wheel_pressed = m_wheel_pressed;
         }
 
         return success;
     }
 
+    bool data_holder::write_delta(netlib_byte_buf* buffer, uint8_t &count)
+    {
+        auto success = true;
+
+        if (m_new_button_data)
+        {
+            success = wire::write_key_delta(buffer, m_button_states, m_sent_button_states, count);
+            m_sent_button_states = m_button_states;
+            m_new_button_data = false;
+        }
+
+        if (m_new_mouse_data)
+        {
+            /* Servers with version 6 get every position in between, older ones only the last */
+            if (success && network::protocol_version >= 6 && m_mouse_path_size > 0)
+            {
+                success = wire::write_mouse_path(buffer, m_mouse_path, m_mouse_path_size, m_sent_mouse_x,
+                    m_sent_mouse_y, m_sent_mouse_time);
+                ++count;
+            }
+            else if (success && (m_mouse_x != m_sent_mouse_x || m_mouse_y != m_sent_mouse_y))
+            {
+                success = wire::write_event(buffer, wire::DE_MOUSE_POS, 0) &&
+                    wire::write_varint(buffer, wire::zigzag(m_mouse_x - m_sent_mouse_x)) &&
+                    wire::write_varint(buffer, wire::zigzag(m_mouse_y - m_sent_mouse_y));
+                ++count;
+            }
+            m_mouse_path_size = 0;
+
+            if (success && (m_wheel_direction != m_sent_wheel_direction || m_wheel_pressed != m_sent_wheel_pressed))
+            {
+                success = wire::write_event(buffer, wire::DE_WHEEL, (m_wheel_direction + 1) | m_wheel_pressed << 2);
+                ++count;
+            }
+
+            m_new_mouse_data = false;
+            m_sent_mouse_x = m_mouse_x;
+            m_sent_mouse_y = m_mouse_y;
+            m_sent_wheel_direction = m_wheel_direction;
+            m_sent_wheel_pressed = m_wheel_pressed;
+        }
+
+        return success;
+    }
+
+    bool data_holder::write_snapshot(netlib_byte_buf* buffer)
+    {
+        /* Keys that don't fit are left out until enough others are released */
+        const auto count = m_button_states.size() < SNAPSHOT_MAX_KEYS ? m_button_states.size() : SNAPSHOT_MAX_KEYS;
+        auto success = wire::write_varint(buffer, uint32_t(count));
+        auto key = m_button_states.begin();
+
+        for (size_t i = 0; success && i < count; i++, ++key)
+            success = wire::write_varint(buffer, key->first);
+
+        success = success && wire::write_varint(buffer, wire::zigzag(m_mouse_x)) &&
+            wire::write_varint(buffer, wire::zigzag(m_mouse_y)) &&
+            netlib_write_uint8(buffer, uint8_t((m_wheel_direction + 1) | m_wheel_pressed << 2));
+
+        m_sent_button_states = m_button_states;
+        m_new_button_data = false;
+        m_new_mouse_data = false;
+        m_mouse_path_size = 0;
+        m_sent_mouse_x = m_mouse_x;
+        m_sent_mouse_y = m_mouse_y;
+        m_sent_wheel_direction = m_wheel_direction;
+        m_sent_wheel_pressed = m_wheel_pressed;
+        return success;
+    }
+
     uint32_t data_holder::get_last_scroll()
     {
         return m_last_scroll;
     }
 
+    bool data_holder::wheel_active() const
+    {
+        return m_wheel_direction != wheel_none;
+    }
+
     bool logger_proc(unsigned level, const char* format, ...)
     {
         auto status = false;
@@ -148,59 +259,122 @@ namespace uiohook
 
 	void dispatch_proc(uiohook_event* const event)
 	{
+        hook_event e = { network::get_timestamp(), event->type, 0, 0, 0, 0 };
+
         switch(event->type)
         {
         case EVENT_HOOK_ENABLED:
             DEBUG_LOG("uiohook started\n");
-            hook_state = true;
-            break;
+            {
+                std::lock_guard<std::mutex> lock(start_mutex);
+                hook_state = true;
+            }
+            start_signal.notify_one();
+            return;
         case EVENT_HOOK_DISABLED:
             DEBUG_LOG("uiohook exited\n");
-            break;
+            return;
         case EVENT_MOUSE_CLICKED:
         case EVENT_MOUSE_PRESSED:
         case EVENT_MOUSE_RELEASED:
-            if (util::cfg.monitor_mouse)
-            {
-                if (is_middle_mouse(event->data.mouse.button))
-                    data.set_wheel(event->type == EVENT_MOUSE_PRESSED);
-                else
-                    data.set_button(util_mouse_fix(event->data.mouse.button)| VC_MOUSE_MASK,
-                        event->type == EVENT_MOUSE_PRESSED);
-            }
+            if (!util::cfg.monitor_mouse)
+                return;
+            e.code = event->data.mouse.button;
             break;
         case EVENT_MOUSE_WHEEL:
-            if (util::cfg.monitor_mouse)
-            {
-                data.set_wheel(event->data.wheel.amount, event->data.wheel.rotation >= WHEEL_DOWN
-                    ? wheel_down : wheel_up);
-            } /* Fallthrough */
+            if (!util::cfg.monitor_mouse)
+                return;
+            e.code = uint16_t(event->data.wheel.rotation >= WHEEL_DOWN ? wheel_down : wheel_up);
+            e.amount = event->data.wheel.amount;
+            e.x = event->data.wheel.x;
+            e.y = event->data.wheel.y;
+            break;
         case EVENT_MOUSE_MOVED:
         case EVENT_MOUSE_DRAGGED:
-            if (util::cfg.monitor_mouse)
-                data.set_mouse_pos(event->data.mouse.x, event->data.mouse.y);
+            if (!util::cfg.monitor_mouse)
+                return;
+            e.x = event->data.mouse.x;
+            e.y = event->data.mouse.y;
             break;
         case EVENT_KEY_TYPED: /* TODO: how to handle this */
         case EVENT_KEY_PRESSED:
         case EVENT_KEY_RELEASED:
-            if (util::cfg.monitor_keyboard)
-                data.set_button(event->data.keyboard.keycode, event->type == EVENT_KEY_PRESSED);
+            if (!util::cfg.monitor_keyboard)
+                return;
+            e.code = event->data.keyboard.keycode;
             break;
-        default:;
+        default:
+            return;
         }
+
+        /* Everything else happens on the event loop, so the hook never waits for it */
+        event_ring.push(e);
+        event_loop::wake_up();
 	}
 
-    bool init()
+    void drain_events()
     {
-		hook_set_logger_proc(&logger_proc);
-    	hook_set_dispatch_proc(&dispatch_proc);
+        static uint64_t reported_overflow = 0;
+        hook_event e;
 
-        const auto status = hook_run();
+        while (event_ring.pop(e))
+        {
+            auto changed = false;
+            switch (e.type)
+            {
+            case EVENT_MOUSE_CLICKED:
+            case EVENT_MOUSE_PRESSED:
+            case EVENT_MOUSE_RELEASED:
+                if (is_middle_mouse(e.code))
+                    changed = data.set_wheel(e.type == EVENT_MOUSE_PRESSED);
+                else
+                    changed = data.set_button(util_mouse_fix(e.code) | VC_MOUSE_MASK, e.type == EVENT_MOUSE_PRESSED);
+                break;
+            case EVENT_MOUSE_WHEEL:
+                changed = data.set_wheel(e.amount, wheel_dir(int16_t(e.code)));
+                changed = data.set_mouse_pos(e.x, e.y, e.time) || changed;
+                break;
+            case EVENT_MOUSE_MOVED:
+            case EVENT_MOUSE_DRAGGED:
+                changed = data.set_mouse_pos(e.x, e.y, e.time);
+                break;
+            default: /* Keyboard events */
+                changed = data.set_button(e.code, e.type == EVENT_KEY_PRESSED);
+            }
+
+            if (changed)
+                network::notify_changes(e.time);
+        }
+
+        const auto overflow = event_ring.overflow();
+        if (overflow != reported_overflow)
+        {
+            DEBUG_LOG("Event queue was full, dropped %llu events\n",
+                static_cast<unsigned long long>(overflow - reported_overflow));
+            reported_overflow = overflow;
+        }
+    }
 
+    int check_wheel()
+    {
+        if (!data.wheel_active())
+            return -1;
+
+        const auto elapsed = util::get_ticks() - data.get_last_scroll();
+        if (elapsed < SCROLL_TIMEOUT)
+            return int(SCROLL_TIMEOUT - elapsed);
+
+        /* No scroll event happened for a while */
+        if (data.reset_wheel())
+            network::notify_changes(network::get_timestamp());
+        return -1;
+    }
+
+    static bool check_status(const int status)
+    {
 		switch (status)
 		{
 		case UIOHOOK_SUCCESS:
-            hook_state = true;
 			return true;
 		case UIOHOOK_ERROR_OUT_OF_MEMORY:
 			logger_proc(LOG_LEVEL_ERROR, "[uiohook] Failed to allocate memory. (%#X)", status);
@@ -246,6 +420,56 @@ namespace uiohook
 		}
     }
 
+#ifdef _WIN32
+    static DWORD WINAPI hook_thread_method(const LPVOID arg)
+#else
+    static void* hook_thread_method(void*)
+#endif
+    {
+        const auto status = hook_run();
+        {
+            std::lock_guard<std::mutex> lock(start_mutex);
+            hook_done = true;
+            hook_status = status;
+        }
+        start_signal.notify_one();
+
+        /* The hook failed after it was started, close() didn't stop it */
+        if (status != UIOHOOK_SUCCESS && hook_state)
+        {
+            check_status(status);
+            event_loop::stop();
+        }
+#ifdef _WIN32
+        return 0;
+#else
+        return nullptr;
+#endif
+    }
+
+    bool init()
+    {
+		hook_set_logger_proc(&logger_proc);
+    	hook_set_dispatch_proc(&dispatch_proc);
+
+#ifdef _WIN32
+        hook_thread = CreateThread(nullptr, 0, static_cast<LPTHREAD_START_ROUTINE>(hook_thread_method),
+            nullptr, 0, nullptr);
+        if (!hook_thread)
+#else
+        hook_thread_started = pthread_create(&hook_thread, nullptr, hook_thread_method, nullptr) == 0;
+        if (!hook_thread_started)
+#endif
+        {
+            DEBUG_LOG("Failed to create hook thread.\n");
+            return false;
+        }
+
+        std::unique_lock<std::mutex> lock(start_mutex);
+        start_signal.wait(lock, [] { return hook_state || hook_done; });
+        return hook_state || check_status(hook_status);
+    }
+
     void close()
     {
         if (!hook_state)
@@ -267,5 +491,18 @@ namespace uiohook
 			break;
 		default: ;
 		}
+
+#ifdef _WIN32
+        if (hook_thread)
+        {
+            WaitForSingleObject(hook_thread, INFINITE);
+            CloseHandle(hook_thread);
+            hook_thread = nullptr;
+        }
+#else
+        if (hook_thread_started)
+            pthread_join(hook_thread, nullptr);
+        hook_thread_started = false;
+#endif
     }
 }
@@ -7,14 +7,16 @@
 
 #pragma once
 #include <uiohook.h>
-#include <mutex>
 #include <map>
 #include <netlib.h>
+#include "../../io-obs/network/wire_format.hpp"
+#include "../../io-obs/util/spsc_ring.hpp"
+
+#define SCROLL_TIMEOUT  120
+#define HOOK_RING_SIZE  1024 /* Events the hook can queue before the event loop handles them */
 
-#define SCROLL_TIMEOUT 120
 namespace uiohook
 {
-    extern std::mutex m_mutex;
     enum wheel_dir
     {
         wheel_up = -1,
@@ -23,6 +25,16 @@ namespace uiohook
     };
 
 
+    /* Compact copy of a uiohook event, passed from the hook thread to the event loop */
+    struct hook_event
+    {
+        uint32_t time; /* network::get_timestamp() when the hook received it */
+        uint16_t type;
+        uint16_t code; /* Keycode, mouse button or wheel direction */
+        int16_t x, y;
+        int16_t amount; /* Wheel rotation */
+    };
+
     class data_holder
     {
         std::map<uint16_t, bool> m_button_states;
@@ -31,17 +43,39 @@ namespace uiohook
         int16_t m_wheel_amount;
         bool m_wheel_pressed;
         bool m_new_mouse_data;
+        bool m_new_button_data;
         uint32_t m_last_scroll;
 
+        /* Every mouse position since the last message, thinned out once it's full */
+        wire::path_sample m_mouse_path[MOUSE_PATH_MAX];
+        uint8_t m_mouse_path_size;
+        uint32_t m_sent_mouse_time; /* Time of the last sample in DE_MOUSE_PATH */
+
+        /* State the server was last sent, deltas are based on it */
+        std::map<uint16_t, bool> m_sent_button_states;
+        int16_t m_sent_mouse_x, m_sent_mouse_y;
+        wheel_dir m_sent_wheel_direction;
+        bool m_sent_wheel_pressed;
+
     public:
         data_holder();
-        void set_button(uint16_t keycode, bool pressed);
-        void set_mouse_pos(int16_t x, int16_t y);
-        void set_wheel(int amount, wheel_dir dir);
-        void reset_wheel();
-        void set_wheel(bool pressed);
-        bool write_to_buffer(netlib_byte_buf* buffer);
+        /* All setters return whether anything changed */
+        bool set_button(uint16_t keycode, bool pressed);
+        bool set_mouse_pos(int16_t x, int16_t y, uint32_t time);
+        bool set_wheel(int amount, wheel_dir dir);
+        bool reset_wheel();
+        bool set_wheel(bool pressed);
+        /* Writes button and mouse data, if only_changes is set
+         * only the parts which changed since the last call are written */
+        bool write_to_buffer(netlib_byte_buf* buffer, bool only_changes);
+
+        /* Writes MSG_INPUT_DELTA events for everything that changed since the last call */
+        bool write_delta(netlib_byte_buf* buffer, uint8_t &count);
+
+        /* Writes the key and mouse part of a MSG_SNAPSHOT, which always contains everything */
+        bool write_snapshot(netlib_byte_buf* buffer);
         uint32_t get_last_scroll();
+        bool wheel_active() const;
     };
 
     inline uint16_t util_mouse_fix(int m)
@@ -60,11 +94,22 @@ namespace uiohook
         return util_mouse_fix(m) == MOUSE_BUTTON3;
     }
 
+    /* Only used by the event loop, the hook thread only fills event_ring */
     extern data_holder data;
     extern volatile bool hook_state;
+    extern spsc_ring<hook_event, HOOK_RING_SIZE> event_ring;
+
 	bool logger_proc(unsigned level, const char* format, ...);
 
 	void dispatch_proc(uiohook_event * event);
+
+    /* Applies all queued events to data */
+    void drain_events();
+
+    /* Resets the wheel once scrolling timed out, returns ms until that happens or -1 */
+    int check_wheel();
+
+    /* Runs the hook on its own thread, since uiohook blocks until it's stopped */
     bool init();
     void close();
 }
@@ -5,12 +5,15 @@
  * github.com/univrsal/input-overlay
  */
 #include "util.hpp"
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include "network.hpp"
 #include <string>
 #include "gamepad.hpp"
 #include "uiohook.hpp"
+#include "event_loop.hpp"
+#include "../../io-obs/network/wire_format.hpp"
 #define IO_CLIENT
 #include "../../io-obs/util/util.hpp"
 
@@ -40,12 +43,23 @@ namespace util
 			DEBUG_LOG(" --gamepad=1   enable/disable gamepad monitoring. Off by default\n");
 			DEBUG_LOG(" --mouse=1     enable/disable mouse monitoring.  Off by default\n");
 			DEBUG_LOG(" --keyboard=1  enable/disable keyboard monitoring. On by default\n");
+			DEBUG_LOG(" --push=2      send input after collecting it for this many ms [0 - %i]. 2 by default\n", PUSH_WINDOW_MAX);
+			DEBUG_LOG("               0 only sends input when obs asks for it, like older versions\n");
+			DEBUG_LOG(" --udp=1       send input over udp if obs supports it. Off by default\n");
+			DEBUG_LOG(" --udp-loss=0  drop this percentage of udp packets, for testing [0 - 100]\n");
+			DEBUG_LOG(" --deadzone=8  percentage of the stick range around the center that counts as rest [0 - 100]\n");
+			DEBUG_LOG(" --trigger-deadzone=10  trigger values below this count as released [0 - 255]\n");
 			return false;
 		}
 
 		cfg.monitor_gamepad = false;
 		cfg.monitor_keyboard = true;
 		cfg.monitor_mouse = false;
+		cfg.push_window = 2;
+		cfg.udp = false;
+		cfg.udp_loss = 0;
+		cfg.stick_deadzone = 8;
+		cfg.trigger_deadzone = 10;
 		cfg.port = 1608;
 
 		auto const s = sizeof(cfg.username);
@@ -80,6 +94,56 @@ namespace util
                  cfg.monitor_mouse = arg.find('1') != std::string::npos;
              else if (arg.find("--keyboard") != std::string::npos)
                  cfg.monitor_keyboard = arg.find('1') != std::string::npos;
+             else if (arg.find("--push=") != std::string::npos)
+             {
+                 const auto window = strtol(arg.c_str() + arg.find('=') + 1, nullptr, 0);
+                 if (window >= 0 && window <= PUSH_WINDOW_MAX)
+                 {
+                     cfg.push_window = uint8_t(window);
+                 }
+                 else
+                 {
+                     DEBUG_LOG("%li is outside the valid push window range [0 - %i]\n", window, PUSH_WINDOW_MAX);
+                 }
+             }
+             else if (arg.find("--udp-loss=") != std::string::npos)
+             {
+                 const auto loss = strtol(arg.c_str() + arg.find('=') + 1, nullptr, 0);
+                 if (loss >= 0 && loss <= 100)
+                 {
+                     cfg.udp_loss = uint8_t(loss);
+                 }
+                 else
+                 {
+                     DEBUG_LOG("%li is outside the valid packet loss range [0 - 100]\n", loss);
+                 }
+             }
+             else if (arg.find("--trigger-deadzone=") != std::string::npos)
+             {
+                 const auto deadzone = strtol(arg.c_str() + arg.find('=') + 1, nullptr, 0);
+                 if (deadzone >= 0 && deadzone <= 255)
+                 {
+                     cfg.trigger_deadzone = uint8_t(deadzone);
+                 }
+                 else
+                 {
+                     DEBUG_LOG("%li is outside the valid trigger deadzone range [0 - 255]\n", deadzone);
+                 }
+             }
+             else if (arg.find("--deadzone=") != std::string::npos)
+             {
+                 const auto deadzone = strtol(arg.c_str() + arg.find('=') + 1, nullptr, 0);
+                 if (deadzone >= 0 && deadzone <= 100)
+                 {
+                     cfg.stick_deadzone = uint8_t(deadzone);
+                 }
+                 else
+                 {
+                     DEBUG_LOG("%li is outside the valid deadzone range [0 - 100]\n", deadzone);
+                 }
+             }
+             else if (arg.find("--udp") != std::string::npos)
+                 cfg.udp = arg.find('1') != std::string::npos;
         }
 
         DEBUG_LOG("io_client configuration:\n");
@@ -88,6 +152,9 @@ namespace util
         DEBUG_LOG(" Keyboard: %s\n", cfg.monitor_keyboard ? "Yes" : "No");
         DEBUG_LOG(" Mouse:    %s\n", cfg.monitor_mouse ? "Yes" : "No");
         DEBUG_LOG(" Gamepad:  %s\n", cfg.monitor_gamepad ? "Yes" : "No");
+        DEBUG_LOG(" Deadzone: %i%% stick, %i trigger\n", cfg.stick_deadzone, cfg.trigger_deadzone);
+        DEBUG_LOG(" Push:     %i ms%s\n", cfg.push_window, cfg.push_window ? "" : " (Waiting for refresh)");
+        DEBUG_LOG(" Udp:      %s, %i%% simulated packet loss\n", cfg.udp ? "Yes" : "No", cfg.udp_loss);
         
 		return true;
     }
@@ -133,12 +200,12 @@ namespace util
     int write_gamepad_data()
     {
         auto result = 1;
-        netlib_write_uint8(network::buffer, MSG_GAMEPAD_DATA);
         for (auto& pad : gamepad::pad_handles)
         {
             if (pad.m_changed)
             {
-                if (
+                /* The server reads one pad per message */
+                if (!netlib_write_uint8(network::buffer, MSG_GAMEPAD_DATA) ||
                     !netlib_write_uint8(network::buffer, pad.get_id()) ||
                     !netlib_write_uint16(network::buffer, pad.get_state()->button_states) ||
                     !netlib_write_float(network::buffer, pad.get_state()->stick_l_x) ||
@@ -150,6 +217,7 @@ namespace util
                     result = 0;
 
                 pad.m_changed = false;
+                pad.m_sent_state = *pad.get_state();
             }
         }
         
@@ -159,6 +227,111 @@ namespace util
         return result;
     }
 
+    static wire::pad_values pad_values(const gamepad::gamepad_state& state)
+    {
+        return { uint16_t(state.button_states),
+            { wire::quantize_axis(state.stick_l_x), wire::quantize_axis(state.stick_l_y),
+              wire::quantize_axis(state.stick_r_x), wire::quantize_axis(state.stick_r_y) },
+            { uint8_t(state.trigger_l), uint8_t(state.trigger_r) } };
+    }
+
+    static bool write_gamepad_delta(netlib_byte_buf* buffer, uint8_t &count)
+    {
+        for (auto& pad : gamepad::pad_handles)
+        {
+            if (!pad.m_changed)
+                continue;
+
+            const auto state = pad.get_state();
+            auto& sent = pad.m_sent_state;
+
+            if (!wire::write_pad_delta(buffer, pad.get_id(), pad_values(*state), pad_values(sent), count))
+                return false;
+
+            pad.m_changed = false;
+            sent = *state;
+        }
+        return true;
+    }
+
+    bool write_gamepad_snapshot(netlib_byte_buf* buffer)
+    {
+        uint8_t mask = 0;
+        int16_t axes[PAD_COUNT][4];
+
+        /* Pads at rest are left out, the server resets the ones that are missing */
+        for (auto& pad : gamepad::pad_handles)
+        {
+            const auto state = pad.get_state();
+            auto* pad_axes = axes[pad.get_id()];
+            pad_axes[0] = wire::quantize_axis(state->stick_l_x);
+            pad_axes[1] = wire::quantize_axis(state->stick_l_y);
+            pad_axes[2] = wire::quantize_axis(state->stick_r_x);
+            pad_axes[3] = wire::quantize_axis(state->stick_r_y);
+
+            if (cfg.monitor_gamepad && (state->button_states || state->trigger_l || state->trigger_r ||
+                pad_axes[0] || pad_axes[1] || pad_axes[2] || pad_axes[3]))
+                mask |= 1 << pad.get_id();
+        }
+
+        if (!wire::write_varint(buffer, mask))
+            return false;
+
+        for (auto& pad : gamepad::pad_handles)
+        {
+            const auto state = pad.get_state();
+            if (mask & (1 << pad.get_id()))
+            {
+                if (!wire::write_varint(buffer, uint16_t(state->button_states)))
+                    return false;
+                for (const auto& axis : axes[pad.get_id()])
+                {
+                    if (!wire::write_varint(buffer, wire::zigzag(axis)))
+                        return false;
+                }
+                if (!netlib_write_uint8(buffer, state->trigger_l) || !netlib_write_uint8(buffer, state->trigger_r))
+                    return false;
+            }
+            pad.m_changed = false;
+            pad.m_sent_state = *state;
+        }
+        return true;
+    }
+
+    int write_input_delta()
+    {
+        static uint32_t sequence = 0;
+        const auto buffer = network::buffer;
+        const auto start = buffer->write_pos;
+        uint8_t count = 0;
+
+        if (!netlib_write_uint8(buffer, MSG_INPUT_DELTA) || !wire::write_varint(buffer, sequence) ||
+            !wire::write_varint(buffer, network::take_input_time()))
+        {
+            DEBUG_LOG("Writing delta header failed: %s\n", netlib_get_error());
+            return 0;
+        }
+
+        /* Event count is filled in once all events are written */
+        const auto count_pos = buffer->write_pos;
+        if (!netlib_write_uint8(buffer, 0) || !uiohook::data.write_delta(buffer, count) ||
+            (cfg.monitor_gamepad && !write_gamepad_delta(buffer, count)))
+        {
+            DEBUG_LOG("Writing delta events failed: %s\n", netlib_get_error());
+            return 0;
+        }
+
+        if (!count)
+        {
+            buffer->write_pos = start; /* Nothing changed */
+            return 1;
+        }
+
+        buffer->data[count_pos] = count;
+        sequence++;
+        return 1;
+    }
+
     bool write_keystate(netlib_byte_buf* buffer, uint16_t code, bool pressed)
     {
 		auto result = netlib_write_uint16(buffer, code);
@@ -181,15 +354,9 @@ namespace util
 
     uint32_t get_ticks()
     {
-#ifdef _WIN32
-		SYSTEMTIME time;
-		GetSystemTime(&time);
-		return (time.wSecond * 1000) + time.wMilliseconds;
-#else
-		struct timespec spec;
-		clock_gettime(CLOCK_MONOTONIC, &spec);
-		return round(spec.tv_nsec / 1.0e6);
-#endif
+        /* Has to be monotonic and must not wrap every minute, the event loop schedules with it */
+        return uint32_t(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
     }
 
     message recv_msg()
@@ -217,6 +384,7 @@ namespace util
     {
         uiohook::close();
         gamepad::close();
+        event_loop::close();
         network::close();
     }
 
@@ -32,6 +32,11 @@ namespace util
 		bool monitor_mouse;
 		bool monitor_keyboard;
 		char username[64];
+		uint8_t push_window; /* ms to collect events before sending them, 0 waits for the server to ask */
+		bool udp;            /* Send MSG_SNAPSHOT over udp if the server supports it */
+		uint8_t udp_loss;    /* Percentage of udp packets to drop, for testing */
+		uint8_t stick_deadzone;   /* Percentage of the stick range around the center that counts as rest */
+		uint8_t trigger_deadzone; /* Trigger values below this count as released [0 - 255] */
 		uint16_t port;
 		ip_address ip;
 	} config;
@@ -45,7 +50,8 @@ namespace util
         RET_NO_HOOKS,
         RET_CONNECTION,
         RET_GAMEPAD_INIT,
-        RET_UIOHOOK_INIT
+        RET_UIOHOOK_INIT,
+        RET_EVENT_LOOP_INIT
     };
 
     /* Get config values and print help */
@@ -55,6 +61,13 @@ namespace util
 
     int write_gamepad_data();
 
+    /* Writes a MSG_INPUT_DELTA with all changes since the last
+     * message, or nothing if there weren't any */
+    int write_input_delta();
+
+    /* Writes the gamepad part of a MSG_SNAPSHOT */
+    bool write_gamepad_snapshot(netlib_byte_buf* buffer);
+
 	bool write_keystate(netlib_byte_buf* buffer, uint16_t code, bool pressed);
 
 	inline uint16_t swap_be16(uint16_t in)
@@ -29,6 +29,7 @@ io_settings_dialog::io_settings_dialog(QWidget* parent) : QDialog(parent, Qt::Di
 #ifndef LINUX
     ui->tab_gamepad->setVisible(false);
 #else
+    ui->cb_pad_evdev->setChecked(io_config::pad_evdev);
     for (const auto &binding : gamepad::default_bindings) {
         auto text_box = findChild<QLineEdit*>(binding.text_box_id);
         if (text_box) {
@@ -74,6 +75,7 @@ io_settings_dialog::io_settings_dialog(QWidget* parent) : QDialog(parent, Qt::Di
     if (pos != std::string::npos)
         text.replace(pos, strlen("%s"), network::local_ip);
     ui->lbl_status->setText(text.c_str());
+    m_latency_format = ui->lbl_latency->text().toStdString();
 
 
     /* Check for new connections every 250ms */
@@ -111,17 +113,36 @@ void io_settings_dialog::RefreshUi()
     if (network::network_flag && network::server_instance && network::server_instance->clients_changed()) {
         ui->box_connections->clear();
         QStringList list;
-        std::vector<const char*> names;
+        std::vector<std::string> names;
         /* I'd do it differently, but including Qt headers and obs headers
          * creates conflicts with LOG_WARNING...
          */
         network::server_instance->get_clients(names);
 
         for (auto &name : names)
-            list.append(name);
+            list.append(name.c_str());
         ui->box_connections->addItems(list);
     }
 
+    /* Latency histograms only change when remote input is drawn */
+    if (network::input_latency.count() != m_latency_samples) {
+        m_latency_samples = network::input_latency.count();
+        auto text = m_latency_format;
+
+        for (const auto histogram : {&network::input_latency, &network::transport_latency}) {
+            const auto pos = text.find("%s");
+            if (pos == std::string::npos)
+                break;
+
+            std::string value = "-";
+            if (histogram->count())
+                value = std::to_string(histogram->percentile(.5)) + " / " +
+                        std::to_string(histogram->percentile(.99)) + " ms";
+            text.replace(pos, strlen("%s"), value);
+        }
+        ui->lbl_latency->setText(text.c_str());
+    }
+
 #ifdef LINUX
     if (gamepad::last_input != 0xff) {
         auto mylineEdits = this->findChildren<QWidget*>();
@@ -220,6 +241,10 @@ void io_settings_dialog::FormAccepted()
     io_config::io_window_filters.write_to_config(cfg);
 
 #ifdef LINUX
+    io_config::pad_evdev = ui->cb_pad_evdev->isChecked();
+
+    /* The gamepad thread uses the bindings while it holds the mutex */
+    std::lock_guard<std::mutex> lock(gamepad::mutex);
     for (const auto &binding : gamepad::default_bindings) {
         auto text_box = findChild<QLineEdit*>(binding.text_box_id);
         if (text_box) {
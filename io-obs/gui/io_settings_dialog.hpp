@@ -10,6 +10,7 @@
 #include "ui_settings_dialog.hpp"
 #include <QTimer>
 #include <mutex>
+#include <string>
 #include <netlib.h>
 
 class io_settings_dialog : public QDialog
@@ -49,6 +50,8 @@ private Q_SLOTS:
 private:
     Ui::io_config_dialog* ui;
     QTimer* m_refresh = nullptr;
+    std::string m_latency_format;
+    uint32_t m_latency_samples = UINT32_MAX; /* Samples when the latency label was last updated */
 
 };
 
@@ -57,6 +57,7 @@ public:
     QPushButton *btn_remove;
     QWidget *tab_gamepad;
     QVBoxLayout *verticalLayout_3;
+    QCheckBox *cb_pad_evdev;
     QLabel *lbl_bindings;
     QScrollArea *scrollArea;
     QWidget *scrollAreaWidgetContents;
@@ -154,6 +155,7 @@ public:
     QSpinBox *box_port;
     QLabel *lbl_refresh_rate;
     QSpinBox *box_refresh_rate;
+    QLabel *lbl_latency;
     QLabel *lbl_connections;
     QListWidget *box_connections;
     QPushButton *btn_refresh;
@@ -296,6 +298,11 @@ public:
         tab_gamepad->setObjectName(QString::fromUtf8("tab_gamepad"));
         verticalLayout_3 = new QVBoxLayout(tab_gamepad);
         verticalLayout_3->setObjectName(QString::fromUtf8("verticalLayout_3"));
+        cb_pad_evdev = new QCheckBox(tab_gamepad);
+        cb_pad_evdev->setObjectName(QString::fromUtf8("cb_pad_evdev"));
+
+        verticalLayout_3->addWidget(cb_pad_evdev);
+
         lbl_bindings = new QLabel(tab_gamepad);
         lbl_bindings->setObjectName(QString::fromUtf8("lbl_bindings"));
 
@@ -863,6 +870,11 @@ public:
 
         verticalLayout_4->addWidget(box_refresh_rate);
 
+        lbl_latency = new QLabel(tab_remote);
+        lbl_latency->setObjectName(QString::fromUtf8("lbl_latency"));
+
+        verticalLayout_4->addWidget(lbl_latency);
+
         lbl_connections = new QLabel(tab_remote);
         lbl_connections->setObjectName(QString::fromUtf8("lbl_connections"));
 
@@ -968,6 +980,7 @@ public:
         lbl_list->setText(QCoreApplication::translate("io_config_dialog", "Dialog.InputControl.List", nullptr));
         btn_remove->setText(QCoreApplication::translate("io_config_dialog", "Dialog.InputControl.Remove", nullptr));
         tabs->setTabText(tabs->indexOf(tab_local), QCoreApplication::translate("io_config_dialog", "Dialog.LocalFeatures", nullptr));
+        cb_pad_evdev->setText(QCoreApplication::translate("io_config_dialog", "Dialog.Gamepad.Evdev", nullptr));
         lbl_bindings->setText(QCoreApplication::translate("io_config_dialog", "Dialog.Gamepad.Info", nullptr));
         lbl_a->setText(QCoreApplication::translate("io_config_dialog", "Dialog.Gamepad.Binding.A", nullptr));
         txt_a->setInputMask(QCoreApplication::translate("io_config_dialog", "009", nullptr));
@@ -1023,6 +1036,7 @@ public:
 #if QT_CONFIG(tooltip)
         box_refresh_rate->setToolTip(QCoreApplication::translate("io_config_dialog", "<html><head/><body><p>Dialog.InputOverlay.RemoteRefreshRate.Tooltip</p></body></html>", nullptr));
 #endif // QT_CONFIG(tooltip)
+        lbl_latency->setText(QCoreApplication::translate("io_config_dialog", "Dialog.Remote.Latency", nullptr));
         lbl_connections->setText(QCoreApplication::translate("io_config_dialog", "Dialog.Remote.Connections", nullptr));
         btn_refresh->setText(QCoreApplication::translate("io_config_dialog", "Source.InputSource.Reload", nullptr));
         tabs->setTabText(tabs->indexOf(tab_remote), QCoreApplication::translate("io_config_dialog", "Dialog.RemoteConnection", nullptr));
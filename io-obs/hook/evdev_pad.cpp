@@ -0,0 +1,334 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#include "evdev_pad.hpp"
+#include "gamepad_binding.hpp"
+#include "util/util.hpp"
+#include "util/element/element_data_holder.hpp"
+#include <cstdio>
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#define EVDEV_BATCH_SIZE    64 /* Events read at once */
+#define LONG_BITS           (sizeof(unsigned long) * 8)
+#define BIT_ARRAY_SIZE(n)   ((n) / LONG_BITS + 1)
+#define DPAD_BUTTONS        (1 << PAD_LEFT | 1 << PAD_RIGHT | 1 << PAD_UP | 1 << PAD_DOWN)
+#define STICK_BUTTONS       (1 << PAD_L_STICK | 1 << PAD_R_STICK)
+
+namespace gamepad
+{
+    static bool test_bit(const unsigned long* bits, const unsigned bit)
+    {
+        return (bits[bit / LONG_BITS] >> (bit % LONG_BITS)) & 1;
+    }
+
+    /* Positions follow Documentation/input/gamepad.rst, so BTN_WEST is X on an xbox pad */
+    static pad_button_events to_button(const uint16_t code)
+    {
+        switch (code) {
+            case BTN_SOUTH:
+                return PAD_A;
+            case BTN_EAST:
+                return PAD_B;
+            case BTN_WEST:
+                return PAD_X;
+            case BTN_NORTH:
+                return PAD_Y;
+            case BTN_TL:
+                return PAD_LB;
+            case BTN_TR:
+                return PAD_RB;
+            case BTN_SELECT:
+                return PAD_BACK;
+            case BTN_START:
+                return PAD_START;
+            case BTN_MODE:
+                return PAD_GUIDE;
+            case BTN_THUMBL:
+                return PAD_L_STICK;
+            case BTN_THUMBR:
+                return PAD_R_STICK;
+            case BTN_DPAD_LEFT:
+                return PAD_LEFT;
+            case BTN_DPAD_RIGHT:
+                return PAD_RIGHT;
+            case BTN_DPAD_UP:
+                return PAD_UP;
+            case BTN_DPAD_DOWN:
+                return PAD_DOWN;
+            default:
+                return PAD_BUTTON_INVALID;
+        }
+    }
+
+    static int to_dpad_direction(const uint16_t buttons)
+    {
+        auto dir = 0;
+        if (buttons & 1 << PAD_LEFT)
+            dir |= DD_LEFT;
+        if (buttons & 1 << PAD_RIGHT)
+            dir |= DD_RIGHT;
+        if (buttons & 1 << PAD_UP)
+            dir |= DD_UP;
+        if (buttons & 1 << PAD_DOWN)
+            dir |= DD_DOWN;
+        return dir;
+    }
+
+    bool evdev_pad::load(const std::string &path, const uint8_t player)
+    {
+        unsigned long keys[BIT_ARRAY_SIZE(KEY_CNT)] = {};
+        unsigned long axes[BIT_ARRAY_SIZE(ABS_CNT)] = {};
+
+        unload();
+        m_fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (m_fd < 0)
+            return false;
+
+        /* Keyboards, mice etc. are also event devices */
+        if (ioctl(m_fd, EVIOCGBIT(EV_KEY, sizeof(keys)), keys) < 0 || !test_bit(keys, BTN_GAMEPAD) ||
+            ioctl(m_fd, EVIOCGBIT(EV_ABS, sizeof(axes)), axes) < 0) {
+            unload();
+            return false;
+        }
+
+        /* Event times use the wall clock by default, but have to be comparable to os_gettime_ns() */
+        int clock = CLOCK_MONOTONIC;
+        if (ioctl(m_fd, EVIOCSCLOCKID, &clock) < 0)
+            blog(LOG_WARNING, "[input-overlay] Couldn't use the monotonic clock for %s: %s", path.c_str(),
+                 strerror(errno));
+
+        m_axes = 0;
+        for (auto code = 0; code < ABS_CNT; code++) {
+            if (test_bit(axes, code) && ioctl(m_fd, EVIOCGABS(code), &m_abs[code]) >= 0 &&
+                m_abs[code].maximum > m_abs[code].minimum)
+                m_axes |= 1ull << code;
+        }
+
+        /* Some drivers report the analog triggers as brake and gas pedal */
+        if (!(m_axes & 1ull << ABS_Z) && m_axes & 1ull << ABS_BRAKE) {
+            m_trigger_axes[0] = ABS_BRAKE;
+            m_trigger_axes[1] = ABS_GAS;
+        } else {
+            m_trigger_axes[0] = ABS_Z;
+            m_trigger_axes[1] = ABS_RZ;
+        }
+        m_analog_triggers = (m_axes & 1ull << m_trigger_axes[0]) != 0;
+
+        m_path = path;
+        m_identity = read_identity(m_fd);
+        m_player = player;
+        m_dropped = false;
+        m_reset = true;
+        m_queued = 0;
+        read_state();
+        queue_frame();
+        blog(LOG_DEBUG, "[input-overlay] Gamepad %i uses %s", m_player, m_path.c_str());
+        return true;
+    }
+
+    std::string evdev_pad::identity(const std::string &path)
+    {
+        const auto fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0)
+            return "";
+
+        const auto result = read_identity(fd);
+        close(fd);
+        return result;
+    }
+
+    std::string evdev_pad::read_identity(const int fd)
+    {
+        input_id id = {};
+        char name[256] = {};
+        char ids[16];
+
+        ioctl(fd, EVIOCGID, &id);
+        if (ioctl(fd, EVIOCGUNIQ(sizeof(name) - 1), name) <= 0 || !name[0])
+            ioctl(fd, EVIOCGPHYS(sizeof(name) - 1), name);
+
+        snprintf(ids, sizeof(ids), "%04x:%04x ", id.vendor, id.product);
+        return ids + std::string(name);
+    }
+
+    void evdev_pad::unload()
+    {
+        if (m_fd >= 0)
+            close(m_fd);
+        m_fd = -1;
+    }
+
+    void evdev_pad::read_state()
+    {
+        unsigned long keys[BIT_ARRAY_SIZE(KEY_CNT)] = {};
+
+        m_frame = pad_frame();
+        if (ioctl(m_fd, EVIOCGKEY(sizeof(keys)), keys) >= 0) {
+            for (auto code = BTN_GAMEPAD; code <= BTN_THUMBR; code++)
+                set_key(code, test_bit(keys, code));
+            for (auto code = BTN_DPAD_UP; code <= BTN_DPAD_RIGHT; code++)
+                set_key(code, test_bit(keys, code));
+        }
+
+        for (auto code = 0; code < ABS_CNT; code++) {
+            if (m_axes & 1ull << code && ioctl(m_fd, EVIOCGABS(code), &m_abs[code]) >= 0)
+                set_axis(code, m_abs[code].value);
+        }
+    }
+
+    void evdev_pad::set_key(const uint16_t code, const int32_t value)
+    {
+        if (!m_analog_triggers && (code == BTN_TL2 || code == BTN_TR2)) {
+            m_frame.triggers[code == BTN_TR2] = value ? 1.f : 0.f;
+            return;
+        }
+
+        const auto button = to_button(code);
+        if (button == PAD_BUTTON_INVALID)
+            return;
+
+        /* Value is 2 for key repeats */
+        if (value)
+            m_frame.buttons |= 1 << button;
+        else
+            m_frame.buttons &= ~(1 << button);
+    }
+
+    void evdev_pad::set_axis(const uint16_t code, const int32_t value)
+    {
+        if (code >= ABS_CNT || !(m_axes & 1ull << code))
+            return;
+
+        const auto &abs = m_abs[code];
+        if (code == m_trigger_axes[0] || code == m_trigger_axes[1]) {
+            const auto val = static_cast<float>(value - abs.minimum) / (abs.maximum - abs.minimum);
+            m_frame.triggers[code == m_trigger_axes[1]] = UTIL_CLAMP(0.f, val, 1.f);
+            return;
+        }
+
+        switch (code) {
+            case ABS_X:
+            case ABS_Y:
+            case ABS_RX:
+            case ABS_RY: {
+                /* Movement within flat is noise, the driver reports it for the stick's center */
+                const auto center = (abs.minimum + abs.maximum) / 2.f;
+                const auto offset = value - center;
+                const auto index = code == ABS_X ? 0 : code == ABS_Y ? 1 : code == ABS_RX ? 2 : 3;
+                if (fabsf(offset) <= abs.flat)
+                    m_frame.sticks[index] = 0.f;
+                else
+                    m_frame.sticks[index] = UTIL_CLAMP(-1.f, offset / (abs.maximum - center), 1.f);
+                break;
+            }
+            case ABS_HAT0X: /* Dpads of pads without BTN_DPAD_* */
+                m_frame.buttons &= ~(1 << PAD_LEFT | 1 << PAD_RIGHT);
+                if (value)
+                    m_frame.buttons |= 1 << (value < 0 ? PAD_LEFT : PAD_RIGHT);
+                break;
+            case ABS_HAT0Y:
+                m_frame.buttons &= ~(1 << PAD_UP | 1 << PAD_DOWN);
+                if (value)
+                    m_frame.buttons |= 1 << (value < 0 ? PAD_UP : PAD_DOWN);
+                break;
+            default:;
+        }
+    }
+
+    int evdev_pad::read_frames()
+    {
+        input_event events[EVDEV_BATCH_SIZE];
+        const auto bytes = read(m_fd, events, sizeof(events));
+        if (bytes < 0)
+            return errno == EAGAIN || errno == EINTR ? 0 : -1;
+        if (bytes == 0)
+            return -1;
+        return handle_events(events, static_cast<int>(bytes / sizeof(input_event)));
+    }
+
+    int evdev_pad::handle_events(const input_event* events, const int count)
+    {
+        auto frames = 0;
+        for (auto i = 0; i < count; i++) {
+            const auto &event = events[i];
+
+            if (event.type == EV_SYN && event.code == SYN_DROPPED) {
+                /* The kernel's buffer overflowed, events up to the next SYN_REPORT are lost */
+                m_dropped = true;
+            } else if (event.type == EV_SYN && event.code == SYN_REPORT) {
+                if (m_dropped)
+                    read_state();
+                m_dropped = false;
+                m_frame.time = event.input_event_sec * 1000000000ull + event.input_event_usec * 1000ull;
+                queue_frame();
+                frames++;
+            } else if (!m_dropped && event.type == EV_KEY) {
+                set_key(event.code, event.value);
+            } else if (!m_dropped && event.type == EV_ABS) {
+                set_axis(event.code, event.value);
+            }
+        }
+        return frames;
+    }
+
+    void evdev_pad::queue_frame()
+    {
+        if (m_queued < EVDEV_FRAME_QUEUE)
+            m_queued++;
+        m_queue[m_queued - 1] = m_frame;
+    }
+
+    void evdev_pad::apply(element_data_holder* data)
+    {
+        for (auto i = 0; i < m_queued; i++)
+            apply_frame(data, m_queue[i]);
+        m_queued = 0;
+    }
+
+    void evdev_pad::apply_frame(element_data_holder* data, const pad_frame &state)
+    {
+        const auto last_input = data->get_last_input();
+        const auto changed = m_reset ? 0xffff : state.buttons ^ m_applied.buttons;
+
+        for (auto i = 0; i < PAD_BUTTON_EVENT_COUNT; i++) {
+            /* Stick buttons are part of the stick data */
+            if (changed & 1 << i && !(STICK_BUTTONS & 1 << i))
+                data->set_gamepad_button(m_player, PAD_TO_VC(i), state.buttons & 1 << i ? BS_PRESSED : BS_RELEASED);
+        }
+
+        if (changed & DPAD_BUTTONS) {
+            /* Directions are merged on linux, so the pressed and released ones are added separately */
+            const auto pressed = to_dpad_direction(state.buttons);
+            const auto released = ~pressed & (DD_LEFT | DD_RIGHT | DD_UP | DD_DOWN);
+            data->add_gamepad_data(m_player, VC_DPAD_DATA,
+                                   element_data_dpad(static_cast<dpad_direction>(pressed), BS_PRESSED));
+            data->add_gamepad_data(m_player, VC_DPAD_DATA,
+                                   element_data_dpad(static_cast<dpad_direction>(released), BS_RELEASED));
+        }
+
+        if (changed & STICK_BUTTONS || memcmp(state.sticks, m_applied.sticks, sizeof(state.sticks)) != 0)
+            data->add_gamepad_data(m_player, VC_STICK_DATA, element_data_analog_stick(
+                (state.buttons & 1 << PAD_L_STICK) != 0, (state.buttons & 1 << PAD_R_STICK) != 0,
+                state.sticks[0], state.sticks[1], state.sticks[2], state.sticks[3]));
+
+        if (m_reset || memcmp(state.triggers, m_applied.triggers, sizeof(state.triggers)) != 0)
+            data->add_gamepad_data(m_player, VC_TRIGGER_DATA, element_data_trigger(state.triggers[0],
+                                                                                   state.triggers[1]));
+
+        /* The holder uses the time the change was applied, but evdev knows when it happened */
+        if (state.time && data->get_last_input() != last_input)
+            data->set_last_input(state.time);
+
+        m_applied = state;
+        m_reset = false;
+    }
+}
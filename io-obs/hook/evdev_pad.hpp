@@ -0,0 +1,111 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <linux/input.h>
+#include <stdint.h>
+#include <string>
+
+#define EVDEV_FRAME_QUEUE 64 /* Completed frames kept until the next apply() */
+
+class element_data_holder;
+
+/* Gamepads read from /dev/input/eventN. Unlike /dev/input/jsN, evdev
+ * reports the standard codes from the kernel's gamepad documentation,
+ * so no bindings are needed. Events come in frames which end with
+ * SYN_REPORT and carry microsecond timestamps. Frames are only applied
+ * once they're complete, so both axes of a stick always change together
+ */
+namespace gamepad
+{
+    class evdev_pad
+    {
+    public:
+        ~evdev_pad()
+        {
+            unload();
+        }
+
+        /* Opens the device if it is a gamepad, returns false otherwise */
+        bool load(const std::string &path, uint8_t player);
+
+        void unload();
+
+        bool valid() const
+        { return m_fd >= 0; }
+
+        int fd() const
+        { return m_fd; }
+
+        uint8_t get_player() const
+        { return m_player; }
+
+        const std::string &get_path() const
+        { return m_path; }
+
+        /* Stays after unloading, so the pad gets the same slot when it comes back */
+        const std::string &get_identity() const
+        { return m_identity; }
+
+        /* Vendor, product and the unique id of wireless or the usb port of wired
+         * pads, empty if the device can't be opened */
+        static std::string identity(const std::string &path);
+
+        /* Reads pending events without blocking, returns -1 if the pad
+         * was disconnected and otherwise the amount of completed frames */
+        int read_frames();
+
+        /* Handles events as read from the device, returns the amount of completed frames */
+        int handle_events(const input_event* events, int count);
+
+        /* Writes the frames completed since the last call into data one after
+         * another, so a press and release between two calls both reach the
+         * press log. Each frame that changed anything sets the last input of
+         * data to the time it happened */
+        void apply(element_data_holder* data);
+
+    private:
+        struct pad_frame
+        {
+            uint16_t buttons = 0; /* One bit per pad_button_events */
+            float sticks[4] = {}; /* Left x, y and right x, y from -1 to 1, positive y is down */
+            float triggers[2] = {}; /* Left and right from 0 to 1 */
+            uint64_t time = 0; /* ns of the SYN_REPORT on the clock of os_gettime_ns(), 0 if unknown */
+        };
+
+        /* Replaces the current frame with the state of the device,
+         * used after opening it and after events were dropped */
+        void read_state();
+
+        /* Adds the current frame to the queue, if it's full the newest frame is replaced */
+        void queue_frame();
+
+        void apply_frame(element_data_holder* data, const pad_frame &state);
+
+        void set_key(uint16_t code, int32_t value);
+
+        void set_axis(uint16_t code, int32_t value);
+
+        static std::string read_identity(int fd);
+
+        std::string m_path;
+        std::string m_identity;
+        int m_fd = -1;
+        uint8_t m_player = 0;
+        bool m_dropped = false; /* Events up to the next SYN_REPORT are incomplete */
+        bool m_reset = true; /* The next apply() writes everything, not just changes */
+        bool m_analog_triggers = false; /* False if the triggers only report BTN_TL2 and BTN_TR2 */
+        uint16_t m_trigger_axes[2] = {ABS_Z, ABS_RZ};
+        uint64_t m_axes = 0; /* One bit per ABS_* code the pad has */
+        input_absinfo m_abs[ABS_CNT] = {};
+        pad_frame m_frame; /* Events since the last SYN_REPORT */
+        pad_frame m_queue[EVDEV_FRAME_QUEUE]; /* Frames completed since the last apply(), oldest first */
+        int m_queued = 0;
+        pad_frame m_applied; /* State last written by apply() */
+    };
+}
@@ -7,12 +7,10 @@
 
 #include <linux/joystick.h>
 #include "util/util.hpp"
-#include "util/element/element_analog_stick.hpp"
-#include "util/element/element_button.hpp"
-#include "util/element/element_dpad.hpp"
-#include "util/element/element_trigger.hpp"
 #include "util/element/element_data_holder.hpp"
 #include "gamepad_binding.hpp"
+#include <algorithm>
+#include <iterator>
 
 namespace gamepad
 {
@@ -31,75 +29,98 @@ namespace gamepad
                                     {S_BINDING_ANALOG_L, "txt_analog_left", PAD_L_STICK, false},
                                     {S_BINDING_ANALOG_R, "txt_analog_right", PAD_R_STICK, false},
                                     {S_BINDING_ANALOG_LX, "txt_lx", PAD_LX, true},
-                                    {S_BINDING_ANALOG_LY, "txt_ly", PAD_LX, true},
+                                    {S_BINDING_ANALOG_LY, "txt_ly", PAD_LY, true},
                                     {S_BINDING_ANALOG_RX, "txt_rx", PAD_RX, true},
                                     {S_BINDING_ANALOG_RY, "txt_ry", PAD_RY, true}};
 
     void gamepad_binding::handle_event(uint8_t pad_id, element_data_holder* data, js_event* event)
     {
-        uint16_t vc = 0;
-
         if (event->type == JS_EVENT_BUTTON) {
-            auto state = event->value ? BS_PRESSED : BS_RELEASED;
-            vc = get_button_event_by_id(event->number);
-
-            if (vc == PAD_L_STICK)
-                data->add_gamepad_data(pad_id, VC_STICK_DATA,new element_data_analog_stick(state, ES_LEFT));
-            else if (vc == PAD_R_STICK)
-                data->add_gamepad_data(pad_id, VC_STICK_DATA, new element_data_analog_stick(state, ES_RIGHT));
-            else if (vc == PAD_DOWN)
-                data->add_gamepad_data(pad_id, VC_DPAD_DATA, new element_data_dpad(DD_DOWN, state));
-            else if (vc == PAD_UP)
-                data->add_gamepad_data(pad_id, VC_DPAD_DATA, new element_data_dpad(DD_UP, state));
-            else if (vc == PAD_LEFT)
-                data->add_gamepad_data(pad_id, VC_DPAD_DATA, new element_data_dpad(DD_LEFT, state));
-            else if (vc == PAD_RIGHT)
-                data->add_gamepad_data(pad_id, VC_DPAD_DATA, new element_data_dpad(DD_RIGHT, state));
-
-            if (vc != PAD_L_STICK && vc != PAD_R_STICK)
-                data->add_gamepad_data(pad_id, PAD_TO_VC(vc), new element_data_button(state));
+            const auto &action = m_button_actions[event->number];
+            const auto state = event->value ? BS_PRESSED : BS_RELEASED;
 
+            switch (action.type) {
+                case PA_DPAD:
+                    data->add_gamepad_data(pad_id, VC_DPAD_DATA,
+                                           element_data_dpad(static_cast<dpad_direction>(action.arg), state));
+                    /* Falls through - dpad directions are buttons as well */
+                case PA_BUTTON:
+                    data->set_gamepad_button(pad_id, action.vc, state);
+                    break;
+                case PA_STICK_BUTTON:
+                    data->add_gamepad_data(pad_id, VC_STICK_DATA,
+                                           element_data_analog_stick(state, static_cast<element_side>(action.arg)));
+                    break;
+                default:;
+            }
         } else if (event->type == JS_EVENT_AXIS) {
-            vc = get_axis_event_by_id(event->number);
-            float axis;
+            const auto &action = m_axis_actions[event->number];
 
-            if (vc == PAD_LT || vc == PAD_RT) {
-                auto trigger = vc == PAD_LT ? TD_LEFT : TD_RIGHT;
+            if (action.type == PA_TRIGGER) {
                 /* Trigger data goes from ~ -32000 to +32000, so it's offset by 0x7FFF
                  * and then divided by 0xffff to convert it to a float (0.0 - 1.0) */
-                axis = (event->value + (0xffff / 2)) / ((float) 0xffff);
-                data->add_gamepad_data(pad_id, VC_TRIGGER_DATA, new element_data_trigger(trigger, axis));
-            } else {
-                axis = event->value / ((float) 0xffff);
-                stick_data_type sd;
-                if (vc == PAD_LY)
-                    sd = SD_LEFT_Y;
-                else if (vc == PAD_LX)
-                    sd = SD_LEFT_X;
-                else if (vc == PAD_RY)
-                    sd = SD_RIGHT_Y;
-                else
-                    sd = SD_RIGHT_X;
-
-                data->add_gamepad_data(pad_id, VC_STICK_DATA, new element_data_analog_stick(axis, sd));
+                const auto axis = (event->value + (0xffff / 2)) / ((float) 0xffff);
+                data->add_gamepad_data(pad_id, VC_TRIGGER_DATA,
+                                       element_data_trigger(static_cast<trigger_data>(action.arg), axis));
+            } else if (action.type == PA_STICK_AXIS) {
+                const auto axis = event->value / ((float) 0xffff);
+                data->add_gamepad_data(pad_id, VC_STICK_DATA,
+                                       element_data_analog_stick(axis, static_cast<stick_data_type>(action.arg)));
             }
         }
     }
 
-    pad_button_events gamepad_binding::get_button_event_by_id(uint8_t id)
+    pad_action gamepad_binding::button_action(const pad_button_events event)
+    {
+        switch (event) {
+            case PAD_L_STICK:
+                return {PA_STICK_BUTTON, ES_LEFT, 0};
+            case PAD_R_STICK:
+                return {PA_STICK_BUTTON, ES_RIGHT, 0};
+            case PAD_LEFT:
+                return {PA_DPAD, DD_LEFT, VC_PAD_DPAD_LEFT};
+            case PAD_RIGHT:
+                return {PA_DPAD, DD_RIGHT, VC_PAD_DPAD_RIGHT};
+            case PAD_UP:
+                return {PA_DPAD, DD_UP, VC_PAD_DPAD_UP};
+            case PAD_DOWN:
+                return {PA_DPAD, DD_DOWN, VC_PAD_DPAD_DOWN};
+            default:
+                return {PA_BUTTON, 0, static_cast<uint16_t>(PAD_TO_VC(event))};
+        }
+    }
+
+    pad_action gamepad_binding::axis_action(const pad_axis_events event)
     {
-        for (const auto &ev : m_button_bindings)
-            if (ev.first == id)
-                return ev.second;
-        return PAD_BUTTON_INVALID;
+        switch (event) {
+            case PAD_LT:
+                return {PA_TRIGGER, TD_LEFT, 0};
+            case PAD_RT:
+                return {PA_TRIGGER, TD_RIGHT, 0};
+            case PAD_LX:
+                return {PA_STICK_AXIS, SD_LEFT_X, 0};
+            case PAD_LY:
+                return {PA_STICK_AXIS, SD_LEFT_Y, 0};
+            case PAD_RX:
+                return {PA_STICK_AXIS, SD_RIGHT_X, 0};
+            case PAD_RY:
+                return {PA_STICK_AXIS, SD_RIGHT_Y, 0};
+            default:
+                return {PA_NONE, 0, 0};
+        }
     }
 
-    pad_axis_events gamepad_binding::get_axis_event_by_id(uint8_t id)
+    void gamepad_binding::build_tables()
     {
-        for (const auto &ev : m_axis_bindings)
-            if (ev.first == id)
-                return ev.second;
-        return PAD_AXIS_INVALID;
+        int i;
+        std::fill(std::begin(m_button_actions), std::end(m_button_actions), pad_action{PA_NONE, 0, 0});
+        std::fill(std::begin(m_axis_actions), std::end(m_axis_actions), pad_action{PA_NONE, 0, 0});
+
+        /* If two events share a raw number the later one wins, like it would when searching the bindings */
+        for (i = 0; i < PAD_BUTTON_EVENT_COUNT; i++)
+            m_button_actions[m_button_ids[i]] = button_action(static_cast<pad_button_events>(i));
+        for (i = 0; i < PAD_AXIS_EVENT_COUNT; i++)
+            m_axis_actions[m_axis_ids[i]] = axis_action(static_cast<pad_axis_events>(i));
     }
 
     gamepad_binding::gamepad_binding()
@@ -109,23 +130,23 @@ namespace gamepad
 
     void gamepad_binding::init_default()
     {
-        m_axis_bindings.clear();
-        m_button_bindings.clear();
         int i;
         for (i = 0; i < PAD_AXIS_EVENT_COUNT; i++)
-            m_axis_bindings[i] = static_cast<pad_axis_events>(i);
+            m_axis_ids[i] = static_cast<uint8_t>(i);
         for (i = 0; i < PAD_BUTTON_EVENT_COUNT; i++)
-            m_button_bindings[i] = static_cast<pad_button_events>(i);
+            m_button_ids[i] = static_cast<uint8_t>(i);
+        build_tables();
     }
 
     void gamepad_binding::set_binding(uint8_t id, uint8_t binding, bool axis_event)
     {
         if (axis_event) {
-            if (binding < PAD_AXIS_EVENT_COUNT)
-                m_axis_bindings[id] = static_cast<pad_axis_events>(binding);
+            if (id < PAD_AXIS_EVENT_COUNT)
+                m_axis_ids[id] = binding;
         } else {
-            if (binding < PAD_BUTTON_EVENT_COUNT)
-                m_button_bindings[id] = static_cast<pad_button_events>(binding);
+            if (id < PAD_BUTTON_EVENT_COUNT)
+                m_button_ids[id] = binding;
         }
+        build_tables();
     }
 }
@@ -7,7 +7,9 @@
 
 #pragma once
 
-#include <map>
+#include <stdint.h>
+
+#define PAD_ACTION_TABLE_SIZE 256 /* Raw numbers of js_events are one byte */
 
 /* On linux the gamepad inputs are read from /dev/js*
  * since this only provides direct input events some
@@ -58,22 +60,43 @@ namespace gamepad
         PAD_BUTTON_EVENT_COUNT
     };
 
+    enum pad_action_type
+    {
+        PA_NONE, PA_BUTTON, PA_DPAD, PA_STICK_BUTTON, PA_STICK_AXIS, PA_TRIGGER
+    };
+
+    /* What an event with a raw button or axis number does */
+    struct pad_action
+    {
+        uint8_t type; /* pad_action_type */
+        uint8_t arg; /* dpad_direction, element_side, stick_data_type or trigger_data, depending on type */
+        uint16_t vc; /* Keycode of buttons and dpad directions */
+    };
+
     class gamepad_binding
     {
-        std::map<uint8_t, pad_axis_events> m_axis_bindings;
-        std::map<uint8_t, pad_button_events> m_button_bindings;
+        /* Raw number of each event */
+        uint8_t m_button_ids[PAD_BUTTON_EVENT_COUNT];
+        uint8_t m_axis_ids[PAD_AXIS_EVENT_COUNT];
+
+        /* Built from the ids and indexed by the raw number, so events don't have to search their binding */
+        pad_action m_button_actions[PAD_ACTION_TABLE_SIZE];
+        pad_action m_axis_actions[PAD_ACTION_TABLE_SIZE];
+
+        void build_tables();
 
-        pad_button_events get_button_event_by_id(uint8_t id);
+        static pad_action button_action(pad_button_events event);
 
-        pad_axis_events get_axis_event_by_id(uint8_t id);
+        static pad_action axis_action(pad_axis_events event);
 
     public:
         gamepad_binding();
 
         void init_default();
 
+        /* Binds the event id to a raw number, call with gamepad::mutex held */
         void set_binding(uint8_t id, uint8_t binding, bool axis_event);
 
         void handle_event(uint8_t pad_id, element_data_holder* data, js_event* event);
     };
-}
+}
\ No newline at end of file
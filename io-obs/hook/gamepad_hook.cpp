@@ -13,6 +13,24 @@
 #include "../util/element/element_analog_stick.hpp"
 #include "../util/element/element_trigger.hpp"
 #include "../util/element/element_dpad.hpp"
+#include "../util/triple_buffer.hpp"
+#include "../util/config.hpp"
+
+#ifdef LINUX
+#include "evdev_pad.hpp"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <dirent.h>
+#include <algorithm>
+#include <cstring>
+#include <climits>
+#include <vector>
+
+#define PAD_BATCH_SIZE  64 /* Events read from one pad before the state is updated */
+#define TAG_WAKE_UP     PAD_COUNT /* epoll tags below are the pad ids */
+#define TAG_HOTPLUG     (PAD_COUNT + 1)
+#endif
 
 namespace gamepad
 {
@@ -20,6 +38,18 @@ namespace gamepad
     bool gamepad_hook_run_flag = true;
     GamepadState pad_states[PAD_COUNT];
     std::mutex mutex;
+
+    /* Only written by the gamepad thread, complete copies of it
+     * are handed to the video thread through pad_snapshots */
+    static element_data_holder pad_data;
+    static triple_buffer<element_data_holder> pad_snapshots;
+
+    static void publish_pad_data()
+    {
+        /* A full copy, so all snapshots share the press log of pad_data */
+        pad_snapshots.back().copy_from(pad_data);
+        pad_snapshots.publish();
+    }
 #ifdef _WIN32
     static HANDLE hook_thread;
 #else
@@ -27,6 +57,223 @@ namespace gamepad
     gamepad_binding bindings;
     uint8_t last_input = 0xff;
     static pthread_t game_pad_hook_thread;
+
+    /* Either evdev_pads or pad_states are used, depending on io_config::pad_evdev when the hook started */
+    static bool use_evdev = false;
+    static evdev_pad evdev_pads[PAD_COUNT];
+
+    /* The thread waits on all pads, hotplug events from /dev/input and
+     * the wake up event from end_pad_hook() at once */
+    static int epoll_fd = -1;
+    static int wake_fd = -1;
+    static int inotify_fd = -1;
+
+    static bool add_to_epoll(const int fd, const uint32_t tag)
+    {
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u32 = tag;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0)
+            return true;
+
+        blog(LOG_ERROR, "[input-overlay] Adding gamepad to epoll failed: %s", strerror(errno));
+        return false;
+    }
+
+    static void open_pad(GamepadState &pad, const uint8_t id)
+    {
+        if (pad.valid())
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, pad.fd(), nullptr);
+        pad.init(id);
+
+        if (pad.valid() && !add_to_epoll(pad.fd(), id))
+            pad.unload();
+    }
+
+    /* Also releases everything the pad still held, returns true if pad_data changed */
+    template<class T>
+    static bool close_pad(T &pad)
+    {
+        if (!pad.valid())
+            return false;
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, pad.fd(), nullptr);
+        pad.unload();
+        blog(LOG_INFO, "[input-overlay] Gamepad %i was disconnected", pad.get_player());
+
+        std::lock_guard<std::mutex> lock(mutex);
+        pad_data.clear_gamepad(pad.get_player());
+        return true;
+    }
+
+    /* Opens /dev/input/eventN if it is a gamepad that isn't open yet. The pad gets the
+     * slot it had before it was unplugged, otherwise the first one that was never used */
+    static bool open_evdev_pad(const std::string &path)
+    {
+        evdev_pad* free_slot = nullptr;
+        for (const auto &pad : evdev_pads) {
+            if (pad.valid() && pad.get_path() == path)
+                return false;
+        }
+
+        const auto identity = evdev_pad::identity(path);
+        for (auto &pad : evdev_pads) {
+            if (pad.valid())
+                continue;
+            if (!identity.empty() && pad.get_identity() == identity) {
+                free_slot = &pad;
+                break;
+            }
+            if (!free_slot || (!free_slot->get_identity().empty() && pad.get_identity().empty()))
+                free_slot = &pad;
+        }
+
+        if (!free_slot)
+            return false;
+
+        const auto id = static_cast<uint8_t>(free_slot - evdev_pads);
+        if (!free_slot->load(path, id))
+            return false;
+
+        if (!add_to_epoll(free_slot->fd(), id)) {
+            free_slot->unload();
+            return false;
+        }
+
+        /* Nothing is sent before the first change, so the current state is applied right away */
+        std::lock_guard<std::mutex> lock(mutex);
+        free_slot->apply(&pad_data);
+        return true;
+    }
+
+    static bool init_epoll()
+    {
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        inotify_fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+
+        if (epoll_fd < 0 || wake_fd < 0 || inotify_fd < 0) {
+            blog(LOG_ERROR, "[input-overlay] Creating gamepad epoll instance failed: %s", strerror(errno));
+            return false;
+        }
+
+        /* udev only sets the permissions after creating the device, so it can be opened after IN_ATTRIB */
+        if (inotify_add_watch(inotify_fd, "/dev/input", IN_CREATE | IN_ATTRIB | IN_DELETE) < 0)
+            blog(LOG_WARNING, "[input-overlay] Watching /dev/input failed, gamepads won't be hotplugged: %s",
+                 strerror(errno));
+
+        return add_to_epoll(wake_fd, TAG_WAKE_UP) && add_to_epoll(inotify_fd, TAG_HOTPLUG);
+    }
+
+    static void close_epoll()
+    {
+        for (auto &pad : pad_states)
+            pad.unload();
+        for (auto &pad : evdev_pads)
+            pad.unload();
+        for (auto fd : {epoll_fd, wake_fd, inotify_fd}) {
+            if (fd >= 0)
+                close(fd);
+        }
+        epoll_fd = wake_fd = inotify_fd = -1;
+    }
+
+    /* Number of a device name like js0 or event12, -1 if the name doesn't have the prefix */
+    static long device_number(const char* name, const char* prefix)
+    {
+        const auto length = strlen(prefix);
+        char* end = nullptr;
+
+        if (strncmp(name, prefix, length) != 0)
+            return -1;
+        const auto number = strtol(name + length, &end, 10);
+        return end == name + length || *end ? -1 : number;
+    }
+
+    /* Opens or closes /dev/input/eventN after it was plugged in or out,
+     * returns true if a pad was opened or closed */
+    static bool handle_evdev_hotplug(const inotify_event* event)
+    {
+        if (device_number(event->name, "event") < 0)
+            return false;
+
+        const auto path = std::string("/dev/input/") + event->name;
+        if (!(event->mask & IN_DELETE)) {
+            if (!open_evdev_pad(path))
+                return false;
+            blog(LOG_INFO, "[input-overlay] Gamepad %s was connected", path.c_str());
+            return true;
+        }
+
+        auto changed = false;
+        for (auto &pad : evdev_pads) {
+            if (pad.valid() && pad.get_path() == path)
+                changed = close_pad(pad) || changed;
+        }
+        return changed;
+    }
+
+    /* Opens or closes /dev/input/jsN after it was plugged in or out,
+     * returns true if the state of a pad changed without any events */
+    static bool handle_hotplug()
+    {
+        alignas(inotify_event) char buffer[sizeof(inotify_event) + NAME_MAX + 1];
+        ssize_t length;
+        auto changed = false;
+
+        while ((length = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+            for (auto pos = buffer; pos < buffer + length;) {
+                const auto event = reinterpret_cast<inotify_event*>(pos);
+                pos += sizeof(inotify_event) + event->len;
+
+                if (!event->len)
+                    continue;
+
+                if (use_evdev) {
+                    changed = handle_evdev_hotplug(event) || changed;
+                    continue;
+                }
+
+                const auto id = device_number(event->name, "js");
+                if (id < 0 || id >= PAD_COUNT)
+                    continue;
+
+                auto &pad = pad_states[id];
+                if (event->mask & IN_DELETE) {
+                    changed = close_pad(pad) || changed;
+                } else if (!pad.valid()) {
+                    open_pad(pad, static_cast<uint8_t>(id));
+                    if (pad.valid())
+                        blog(LOG_INFO, "[input-overlay] Gamepad %li was connected", id);
+                }
+            }
+        }
+        return changed;
+    }
+
+    /* Opens all gamepads in /dev/input/eventN in the order of N */
+    static bool init_evdev_pads()
+    {
+        const auto dir = opendir("/dev/input");
+        std::vector<long> numbers;
+        auto flag = false;
+
+        if (!dir) {
+            blog(LOG_ERROR, "[input-overlay] Opening /dev/input failed: %s", strerror(errno));
+            return false;
+        }
+
+        while (const auto entry = readdir(dir)) {
+            const auto number = device_number(entry->d_name, "event");
+            if (number >= 0)
+                numbers.emplace_back(number);
+        }
+        closedir(dir);
+
+        std::sort(numbers.begin(), numbers.end());
+        for (const auto number : numbers)
+            flag = open_evdev_pad("/dev/input/event" + std::to_string(number)) || flag;
+        return flag;
+    }
 #endif
 
     void start_pad_hook()
@@ -43,45 +290,75 @@ namespace gamepad
             return;
         }
 #endif
-        gamepad_hook_state = gamepad_hook_run_flag = init_pad_devices();
 
 #ifdef _WIN32
+        gamepad_hook_state = gamepad_hook_run_flag = init_pad_devices();
         hook_thread = CreateThread(nullptr, 0, static_cast<LPTHREAD_START_ROUTINE>(hook_method),
             nullptr, 0, nullptr);
         gamepad_hook_state = hook_thread;
 #else
+        if (!init_epoll()) {
+            close_epoll();
+            return;
+        }
+
+        /* Pads that are plugged in later are opened by the thread */
+        use_evdev = io_config::pad_evdev;
+        init_pad_devices();
+        publish_pad_data();
+        gamepad_hook_run_flag = true;
         gamepad_hook_state = pthread_create(&game_pad_hook_thread, nullptr, hook_method, nullptr) == 0;
+        if (!gamepad_hook_state)
+            close_epoll();
 #endif
     }
 
     bool init_pad_devices()
     {
+#ifdef LINUX
+        if (use_evdev)
+            return init_evdev_pads();
+#endif
         uint8_t id = 0;
         auto flag = false;
         for (auto &state : pad_states) {
+#ifdef _WIN32
             state.init(id++);
+#else
+            open_pad(state, id++);
+#endif
             if (state.valid())
                 flag = true;
         }
         return flag;
     }
 
+    void sync_pad_data(element_data_holder* target)
+    {
+        if (target && pad_snapshots.acquire())
+            target->copy_gamepad_data(pad_snapshots.front());
+    }
+
     void end_pad_hook()
     {
         gamepad_hook_run_flag = false;
 
 #ifdef _WIN32
         CloseHandle(hook_thread);
+#else
+        const uint64_t value = 1;
+        if (write(wake_fd, &value, sizeof(value)) == sizeof(value))
+            pthread_join(game_pad_hook_thread, nullptr);
+        else
+            blog(LOG_ERROR, "[input-overlay] Waking up gamepad thread failed: %s", strerror(errno));
+        close_epoll();
 #endif
+        gamepad_hook_state = false;
     }
 
     /* Background process for quering game pads */
 #ifdef _WIN32
     DWORD WINAPI hook_method(const LPVOID arg)
-#else
-
-    void* hook_method(void*)
-#endif
     {
         while (gamepad_hook_run_flag) {
             if (!hook::input_data)
@@ -92,24 +369,21 @@ namespace gamepad
                 if (!pad.valid())
                     continue;
 
-#ifdef _WIN32
                 dpad_direction dir[] = { dpad_direction::CENTER, dpad_direction::CENTER };
 
                 for (const auto& button : xinput_fix::all_codes)
                 {
                     const auto state = static_cast<button_state>(pressed(pad.get_xinput(), button));
-                    hook::input_data->add_gamepad_data(pad.get_id(), xinput_fix::to_vc(button),
-                        new element_data_button(state));
+                    pad_data.set_gamepad_button(pad.get_id(), xinput_fix::to_vc(button), state);
                 }
 
                 /* Dpad direction */
                 get_dpad(pad.get_xinput(), dir);
-                hook::input_data->add_gamepad_data(pad.get_id(), VC_DPAD_DATA,
-                    new element_data_dpad(dir[0], dir[1]));
+                pad_data.add_gamepad_data(pad.get_id(), VC_DPAD_DATA, element_data_dpad(dir[0], dir[1]));
 
                 /* Analog sticks */
-                hook::input_data->add_gamepad_data(pad.get_id(), VC_STICK_DATA,
-                    new element_data_analog_stick(
+                pad_data.add_gamepad_data(pad.get_id(), VC_STICK_DATA,
+                    element_data_analog_stick(
                         pressed(pad.get_xinput(), xinput_fix::CODE_LEFT_THUMB),
                         pressed(pad.get_xinput(), xinput_fix::CODE_RIGHT_THUMB),
                         stick_l_x(pad.get_xinput()), -stick_l_y(pad.get_xinput()),
@@ -117,47 +391,101 @@ namespace gamepad
                     ));
 
                 /* Trigger buttons */
-                hook::input_data->add_gamepad_data(pad.get_id(), VC_TRIGGER_DATA,
-                    new element_data_trigger(
+                pad_data.add_gamepad_data(pad.get_id(), VC_TRIGGER_DATA,
+                    element_data_trigger(
                         trigger_l(pad.get_xinput()), trigger_r(pad.get_xinput())
                     ));
+            }
+            mutex.unlock();
+            publish_pad_data();
+            os_sleep_ms(25);
+        }
+        return UIOHOOK_SUCCESS;
+    }
 #else
-                blog(LOG_DEBUG, "tick");
-                if (pad.read_event() == -1) {
-                    pad.unload();
+
+    void* hook_method(void*)
+    {
+        static js_event batch[PAD_COUNT][PAD_BATCH_SIZE]; /* Only used without evdev */
+        epoll_event events[PAD_COUNT + 2];
+
+        while (gamepad_hook_run_flag && hook::input_data) {
+            const auto count = epoll_wait(epoll_fd, events, PAD_COUNT + 2, -1);
+            if (count < 0) {
+                if (errno == EINTR)
                     continue;
-                }
+                blog(LOG_ERROR, "[input-overlay] Waiting for gamepads failed: %s", strerror(errno));
+                break;
+            }
+
+            int batch_size[PAD_COUNT] = {}; /* Events or with evdev completed frames */
+            auto pad_events = false;
 
-                /* js_event code from
-                   https://gist.github.com/jasonwhite/c5b2048c15993d285130
-                 */
-                switch (pad.get_event()->type) {
-                    case JS_EVENT_BUTTON:
-                        if (pad.get_event()->value)
-                            last_input = pad.get_event()->number;
-                        bindings.handle_event(pad.get_player(), hook::input_data, pad.get_event());
-                        break;
-                    case JS_EVENT_AXIS:
-                        last_input = pad.get_event()->number;
-                        bindings.handle_event(pad.get_player(), hook::input_data, pad.get_event());
-                        break;
-                    default:;
+            for (auto i = 0; i < count; i++) {
+                const auto tag = events[i].data.u32;
+
+                if (tag == TAG_WAKE_UP) {
+                    continue; /* end_pad_hook() cleared the run flag */
+                } else if (tag == TAG_HOTPLUG) {
+                    pad_events = handle_hotplug() || pad_events;
+                } else if (tag < PAD_COUNT && use_evdev) {
+                    /* Frames which aren't complete yet are finished by the next batch */
+                    batch_size[tag] = evdev_pads[tag].read_frames();
+                    if (batch_size[tag] < 0) {
+                        pad_events = close_pad(evdev_pads[tag]) || pad_events;
+                        batch_size[tag] = 0;
+                    }
+                    pad_events = pad_events || batch_size[tag] > 0;
+                } else if (tag < PAD_COUNT) {
+                    /* Anything beyond one batch is still pending and wakes up the next epoll_wait() */
+                    batch_size[tag] = pad_states[tag].read_events(batch[tag], PAD_BATCH_SIZE);
+                    if (batch_size[tag] < 0) {
+                        pad_events = close_pad(pad_states[tag]) || pad_events;
+                        batch_size[tag] = 0;
+                    }
+                    pad_events = pad_events || batch_size[tag] > 0;
                 }
+            }
+
+            if (!pad_events)
+                continue;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (auto id = 0; id < PAD_COUNT; id++) {
+                    if (use_evdev) {
+                        if (batch_size[id])
+                            evdev_pads[id].apply(&pad_data);
+                        continue;
+                    }
 
-#endif /* LINUX */
-                mutex.unlock();
+                    for (auto i = 0; i < batch_size[id]; i++) {
+                        auto &event = batch[id][i];
+
+                        /* The initial state is sent as JS_EVENT_INIT events after opening the device.
+                         * js_event code from https://gist.github.com/jasonwhite/c5b2048c15993d285130 */
+                        const auto initial = (event.type & JS_EVENT_INIT) != 0;
+                        event.type &= ~JS_EVENT_INIT;
+
+                        switch (event.type) {
+                            case JS_EVENT_BUTTON:
+                                if (event.value && !initial)
+                                    last_input = event.number;
+                                bindings.handle_event(static_cast<uint8_t>(id), &pad_data, &event);
+                                break;
+                            case JS_EVENT_AXIS:
+                                if (!initial)
+                                    last_input = event.number;
+                                bindings.handle_event(static_cast<uint8_t>(id), &pad_data, &event);
+                                break;
+                            default:;
+                        }
+                    }
+                }
             }
-#ifdef  _WIN32 /* Delay on linux results in buffered input */
-            os_sleep_ms(25);
-#endif
+            publish_pad_data();
         }
-
-        //for (auto& state : pad_states)
-        //    state.unload();
-#ifdef _WIN32
-        return UIOHOOK_SUCCESS;
-#else
-        pthread_exit(nullptr);
-#endif
+        return nullptr;
     }
+#endif
 }
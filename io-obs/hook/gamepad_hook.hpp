@@ -16,12 +16,15 @@
 #include <malloc.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <errno.h>
 #include <linux/joystick.h>
 #endif
 #include "util/util.hpp"
 #include <stdio.h>
 #include <mutex>
 
+class element_data_holder;
+
 namespace gamepad
 {
     /* Linux implementation */
@@ -39,12 +42,14 @@ namespace gamepad
 
         void unload()
         {
-            close(m_controller_id);
+            if (m_controller_id >= 0)
+                close(m_controller_id);
+            m_controller_id = -1;
         }
 
         void load()
         {
-            m_controller_id = open(m_path.c_str(), O_RDONLY);
+            m_controller_id = open(m_path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
             blog(LOG_DEBUG, "Gamepad %i present: %s", m_player, valid() ? "true" : "false");
         }
 
@@ -64,23 +69,25 @@ namespace gamepad
         uint8_t get_player() const
         { return m_player; }
 
-        int read_event()
-        {
-            ssize_t bytes;
-            bytes = read(m_controller_id, &m_event, sizeof(m_event));
-            if (bytes == sizeof(m_event))
-                return 0;
+        int fd() const
+        { return m_controller_id; }
 
-            /* Error, could not read full event. */
-            return -1;
+        /* Reads up to max pending events without blocking,
+         * returns -1 if the pad was disconnected */
+        int read_events(js_event* events, const int max)
+        {
+            const auto bytes = read(m_controller_id, events, max * sizeof(js_event));
+            if (bytes < 0)
+                return errno == EAGAIN || errno == EINTR ? 0 : -1;
+            if (bytes == 0)
+                return -1;
+            return static_cast<int>(bytes / sizeof(js_event));
         }
 
-        js_event* get_event() { return &m_event; }
     private:
         std::string m_path;
         int m_controller_id = -1; /* Id assigned by the open command */
         uint8_t m_player; /* 0 - 4 */
-        js_event m_event;
     };
 
 #endif /* LINUX */
@@ -162,7 +169,11 @@ namespace gamepad
 
     bool init_pad_devices();
 
-    /* Mutex for thread safety */
+    /* Copies the latest gamepad state published by the
+     * gamepad thread into target, call from the video thread */
+    void sync_pad_data(element_data_holder* target);
+
+    /* Protects the bindings and the gamepad state, taken once per batch of events */
     extern std::mutex mutex;
     /* Four structs containing info to query gamepads */
     extern GamepadState pad_states[PAD_COUNT];
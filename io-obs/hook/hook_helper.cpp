@@ -11,6 +11,8 @@
 #include "../util/element/element_mouse_wheel.hpp"
 #include "../util/element/element_button.hpp"
 #include "util/element/element_mouse_movement.hpp"
+#include "gamepad_hook.hpp"
+#include "press_queue.hpp"
 #include <cstdarg>
 #include <util/platform.h>
 #include <obs-module.h>
@@ -30,6 +32,11 @@ namespace hook
     bool hook_initialized = false;
     bool data_initialized = false;
     std::mutex mutex;
+    spsc_ring<input_event, HOOK_RING_SIZE> event_ring;
+    static uint64_t reported_overflow = 0;
+
+    /* Only used on the uiohook thread */
+    static press_queue<0x10000> queued_presses;
 
 
 #ifdef _WIN32
@@ -235,43 +242,94 @@ namespace hook
 
     void process_event(uiohook_event* const event)
     {
-        if (!input_data)
-            return;
-        mutex.lock();
-        check_wheel();
+        /* Runs on the uiohook thread, which only pushes events into the ring
+         * so it never has to wait for the video thread */
+        input_event e = {os_gettime_ns(), static_cast<uint16_t>(event->type), 0, 0, 0};
 
         switch (event->type) {
             case EVENT_KEY_PRESSED:
             case EVENT_KEY_RELEASED:/* Fallthrough */
-                input_data->add_data(event->data.keyboard.keycode, new element_data_button(
-                        event->type == EVENT_KEY_PRESSED ? BS_PRESSED : BS_RELEASED));
+                e.code = event->data.keyboard.keycode;
                 break;
             case EVENT_MOUSE_WHEEL:
-                last_wheel = os_gettime_ns();
-                if (event->data.wheel.rotation >= WHEEL_DOWN) {
-                    input_data->add_data(VC_MOUSE_WHEEL_DOWN, new element_data_button(BS_PRESSED));
-                    input_data->remove_data(VC_MOUSE_WHEEL_UP);
-                } else {
-                    input_data->add_data(VC_MOUSE_WHEEL_UP, new element_data_button(BS_PRESSED));
-                    input_data->remove_data(VC_MOUSE_WHEEL_DOWN);
-                }
+                e.code = event->data.wheel.rotation >= WHEEL_DOWN ? VC_MOUSE_WHEEL_DOWN : VC_MOUSE_WHEEL_UP;
                 break;
             case EVENT_MOUSE_PRESSED:
             case EVENT_MOUSE_RELEASED:
-                input_data->add_data(util_mouse_to_vc(event->data.mouse.button),
-                                     new element_data_button(event->type == EVENT_MOUSE_PRESSED
-                                                             ? BS_PRESSED : BS_RELEASED));
-                 break;
-
-                last_character = event->data.keyboard.keychar; break; case EVENT_MOUSE_DRAGGED:
+                e.code = util_mouse_to_vc(event->data.mouse.button);
+                break;
+            case EVENT_MOUSE_DRAGGED:
             case EVENT_MOUSE_MOVED:
-                input_data->add_data(VC_MOUSE_DATA,
-                                     new element_data_mouse_pos(event->data.mouse.x, event->data.mouse.y));
+                e.x = event->data.mouse.x;
+                e.y = event->data.mouse.y;
                 break;
-            default:;
+            default:
+                return;
         }
 
-        mutex.unlock();
+        switch (event->type) {
+            case EVENT_KEY_PRESSED:
+            case EVENT_MOUSE_PRESSED:
+                queued_presses.push(event_ring, e, e.code, PC_PRESS);
+                break;
+            case EVENT_KEY_RELEASED:
+            case EVENT_MOUSE_RELEASED:
+                queued_presses.push(event_ring, e, e.code, PC_RELEASE);
+                break;
+            default:
+                queued_presses.push(event_ring, e, e.code, PC_OTHER);
+        }
+    }
+
+    void drain_events()
+    {
+        input_event e{}, move{};
+        auto moved = false;
+
+        if (!input_data)
+            return;
+
+        while (event_ring.pop(e)) {
+            switch (e.type) {
+                case EVENT_KEY_PRESSED:
+                case EVENT_MOUSE_PRESSED:
+                    input_data->set_button(e.code, BS_PRESSED);
+                    break;
+                case EVENT_KEY_RELEASED:
+                case EVENT_MOUSE_RELEASED:
+                    input_data->set_button(e.code, BS_RELEASED);
+                    break;
+                case EVENT_MOUSE_WHEEL:
+                    last_wheel = e.time;
+                    input_data->set_button(e.code, BS_PRESSED);
+                    input_data->remove_data(e.code == VC_MOUSE_WHEEL_DOWN ? VC_MOUSE_WHEEL_UP : VC_MOUSE_WHEEL_DOWN);
+                    break;
+                case EVENT_MOUSE_DRAGGED:
+                case EVENT_MOUSE_MOVED:
+                    /* Only the last position is applied so mouse movement
+                     * is measured from one video frame to the next */
+                    move = e;
+                    moved = true;
+                    break;
+                default:;
+            }
+        }
+
+        if (moved)
+            input_data->set_mouse_pos(move.x, move.y);
+        else
+            input_data->stop_mouse_motion();
+
+        const auto overflow = event_ring.overflow();
+        if (overflow != reported_overflow) {
+            blog(LOG_WARNING, "[input-overlay] Input event queue was full, dropped %llu events (%llu total)",
+                 static_cast<unsigned long long>(overflow - reported_overflow),
+                 static_cast<unsigned long long>(overflow));
+            reported_overflow = overflow;
+        }
+
+        check_wheel();
+        gamepad::sync_pad_data(input_data);
     }
 
     int hook_enable()
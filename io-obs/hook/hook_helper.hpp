@@ -10,6 +10,7 @@
 #include <uiohook.h>
 #include <mutex>
 #include "../util/util.hpp"
+#include "../util/spsc_ring.hpp"
 
 #ifdef LINUX
 #include <stdint.h>
@@ -19,8 +20,21 @@
 
 class element_data_holder;
 
+/* Amount of events, that can be queued between two video ticks */
+#define HOOK_RING_SIZE 4096
+
 namespace hook
 {
+    /* Compact copy of the uiohook event data, that's needed
+     * to update the input state on the video thread */
+    struct input_event
+    {
+        uint64_t time;
+        uint16_t type;
+        uint16_t code;
+        int16_t x, y;
+    };
+
     extern element_data_holder* input_data;
 
     extern uint64_t last_wheel;
@@ -29,6 +43,7 @@ namespace hook
     extern bool hook_initialized;
     extern bool data_initialized;
     extern std::mutex mutex;
+    extern spsc_ring<input_event, HOOK_RING_SIZE> event_ring;
 
 #ifdef _WIN32
     DWORD WINAPI hook_thread_proc(LPVOID arg);
@@ -54,4 +69,8 @@ namespace hook
     int hook_enable();
 
     void process_event(uiohook_event* event);
+
+    /* Applies all queued events and the latest gamepad state to input_data.
+     * Should only be called through input_state::sync(), which runs every video frame */
+    void drain_events();
 };
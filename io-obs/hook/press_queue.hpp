@@ -0,0 +1,62 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include "../util/spsc_ring.hpp"
+#include <bitset>
+
+enum press_change
+{
+    PC_PRESS,
+    PC_RELEASE,
+    PC_OTHER /* Anything that isn't a key or button */
+};
+
+/* Pushes events into a spsc_ring on the producer side and keeps track of the codes
+ * whose last queued event was a press. As many slots as there are queued presses
+ * are kept free in the ring, so their releases always fit and a full ring never
+ * leaves a key stuck. Codes has to be bigger than every code that is pushed
+ */
+template<size_t Codes>
+class press_queue
+{
+public:
+    /* Returns false if the event was dropped */
+    template<class T, size_t Capacity>
+    bool push(spsc_ring<T, Capacity> &ring, const T &item, const uint16_t code, const press_change change)
+    {
+        switch (change) {
+            case PC_PRESS:
+                if (m_presses.test(code)) /* Key repeat */
+                    return ring.push(item, m_count);
+                if (!ring.push(item, m_count + 1))
+                    return false;
+                m_presses.set(code);
+                m_count++;
+                return true;
+            case PC_RELEASE:
+                if (!m_presses.test(code)) /* The press was dropped, so this one can be too */
+                    return ring.push(item, m_count);
+                m_presses.reset(code);
+                m_count--;
+                return ring.push(item);
+            default:
+                return ring.push(item, m_count);
+        }
+    }
+
+    /* Amount of presses whose release has a reserved slot */
+    size_t count() const
+    {
+        return m_count;
+    }
+
+private:
+    std::bitset<Codes> m_presses;
+    size_t m_count = 0;
+};
@@ -19,6 +19,7 @@
 #include "hook/gamepad_hook.hpp"
 #include "gui/io_settings_dialog.hpp"
 #include "network/remote_connection.hpp"
+#include "util/input_state.hpp"
 
 #ifdef LINUX
 
@@ -56,6 +57,8 @@ bool obs_module_load()
     if (io_config::control)
         io_config::io_window_filters.read_from_config(cfg);
 
+    input_state::start();
+
     /* UI registration from
     * https://github.com/Palakis/obs-websocket/
     */
@@ -77,6 +80,7 @@ void obs_module_unload()
     /* Save config values again */
     auto cfg = obs_frontend_get_global_config();
     io_config::save(cfg);
+    input_state::stop();
 
     if (gamepad::gamepad_hook_state)
         gamepad::end_pad_hook();
@@ -0,0 +1,142 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#include "client_worker.hpp"
+#include "io_server.hpp"
+#include "util/util.hpp"
+#include "util/config.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace network
+{
+    client_worker::client_worker(io_server* server) : m_server(server)
+    {
+    }
+
+    client_worker::~client_worker()
+    {
+        stop();
+    }
+
+    bool client_worker::start()
+    {
+        m_running = true;
+#ifdef _WIN32
+        m_thread = CreateThread(nullptr, 0, static_cast<LPTHREAD_START_ROUTINE>(thread_method), this, 0, nullptr);
+        m_started = m_thread != nullptr;
+#else
+        m_started = pthread_create(&m_thread, nullptr, thread_method, this) == 0;
+#endif
+        if (!m_started)
+            DEBUG_LOG(LOG_ERROR, "Creating network worker thread failed");
+        return m_started;
+    }
+
+    void client_worker::stop()
+    {
+        if (!m_started)
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running = false;
+        }
+        m_signal.notify_one();
+
+#ifdef _WIN32
+        WaitForSingleObject(m_thread, INFINITE);
+        CloseHandle(m_thread);
+        m_thread = nullptr;
+#else
+        pthread_join(m_thread, nullptr);
+#endif
+        m_started = false;
+    }
+
+    void client_worker::queue_receive(const std::shared_ptr<io_client> &client)
+    {
+        job j;
+        j.client = client;
+        j.size = 0;
+        queue(std::move(j));
+    }
+
+    void client_worker::queue_snapshot(const std::shared_ptr<io_client> &client, const uint8_t* data,
+                                       const uint8_t size)
+    {
+        if (!size)
+            return;
+
+        job j;
+        j.client = client;
+        j.size = size;
+        memcpy(j.data, data, size);
+        queue(std::move(j));
+    }
+
+    void client_worker::queue(job &&j)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobs.emplace_back(std::move(j));
+        }
+        m_signal.notify_one();
+    }
+
+    void client_worker::run()
+    {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_signal.wait(lock, [this] { return !m_jobs.empty() || !m_running; });
+                if (m_jobs.empty())
+                    break; /* Stopped and nothing left to do */
+                m_jobs.swap(m_current);
+            }
+
+            for (auto &j : m_current) {
+                const auto client = j.client.get();
+
+                if (!j.size) {
+                    if (!client->receive()) {
+                        DEBUG_LOG(LOG_ERROR, "Failed to receive data from %s. Closed connection", client->name());
+                        client->mark_invalid();
+                    }
+                    m_server->receive_done(client);
+                    continue;
+                }
+
+                auto view = wire::make_reader(j.data, j.size);
+
+                /* Each client is only published once for all of its snapshots */
+                if (client->read_snapshot(&view) &&
+                    std::find(m_updated.begin(), m_updated.end(), client) == m_updated.end())
+                    m_updated.emplace_back(client);
+            }
+
+            for (const auto client : m_updated)
+                client->publish();
+            m_updated.clear();
+            m_current.clear(); /* Drops the references to removed clients */
+        }
+    }
+
+#ifdef _WIN32
+    DWORD WINAPI client_worker::thread_method(const LPVOID arg)
+    {
+        static_cast<client_worker*>(arg)->run();
+        return 0;
+    }
+#else
+    void* client_worker::thread_method(void* arg)
+    {
+        static_cast<client_worker*>(arg)->run();
+        return nullptr;
+    }
+#endif
+}
@@ -0,0 +1,85 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include "io_client.hpp"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#define NETWORK_WORKERS_MAX 4
+
+namespace network
+{
+    class io_server;
+
+    /* Receives and decodes client data on its own thread. A client is always
+     * handled by the same worker, so its state only ever has one writer and
+     * a slow client only holds up the other clients of its worker
+     */
+    class client_worker
+    {
+    public:
+        explicit client_worker(io_server* server);
+
+        ~client_worker();
+
+        client_worker(const client_worker &) = delete;
+
+        client_worker &operator=(const client_worker &) = delete;
+
+        bool start();
+
+        /* Finishes all queued work and waits for the thread */
+        void stop();
+
+        /* The socket of the client has to be readable, io_server::receive_done()
+         * is called once everything was received */
+        void queue_receive(const std::shared_ptr<io_client> &client);
+
+        /* Data of a MSG_SNAPSHOT after its token */
+        void queue_snapshot(const std::shared_ptr<io_client> &client, const uint8_t* data, uint8_t size);
+
+    private:
+        struct job
+        {
+            std::shared_ptr<io_client> client;
+            uint8_t size; /* 0 to receive from the socket, otherwise the size of the snapshot */
+            uint8_t data[UDP_PACKET_SIZE];
+        };
+
+        void queue(job &&j);
+
+        void run();
+
+#ifdef _WIN32
+        static DWORD WINAPI thread_method(LPVOID arg);
+
+        HANDLE m_thread = nullptr;
+#else
+        static void* thread_method(void* arg);
+
+        pthread_t m_thread{};
+#endif
+        bool m_started = false;
+        bool m_running = false;
+        io_server* m_server;
+        std::mutex m_mutex;
+        std::condition_variable m_signal;
+        std::vector<job> m_jobs; /* Filled by the network thread */
+        std::vector<job> m_current; /* Jobs the worker is currently handling */
+        std::vector<io_client*> m_updated; /* Clients which received a snapshot in m_current */
+    };
+}
@@ -15,12 +15,20 @@
 #include "hook/xinput_fix.hpp"
 #include "util/util.hpp"
 #include "util/config.hpp"
+#include <util/platform.h>
 #include <uiohook.h>
 
+/* Every ping the best round trip time gets this much worse,
+ * so the clock offset follows clocks that drift apart */
+#define RTT_AGING_NS (1000 * 1000)
+
+/* Wheel direction in DE_WHEEL events is -1 (up), 0 or 1 (down) offset by one */
+static const direction wheel_directions[] = {DIR_UP, DIR_NONE, DIR_DOWN};
+
 namespace network
 {
     io_client::io_client(char* name, tcp_socket socket, uint8_t id)
-        : m_holder(true)
+        : m_holder(true), m_view(true)
     {
         m_name = name;
         m_socket = socket;
@@ -51,10 +59,135 @@ namespace network
 
     element_data_holder* io_client::get_data()
     {
-        return &m_holder;
+        return &m_view;
+    }
+
+    void io_client::sync()
+    {
+        if (!m_snapshots.acquire()) {
+            m_view.stop_mouse_motion(); /* No new samples, so the mouse stopped */
+            return;
+        }
+
+        const auto &state = m_snapshots.front();
+        m_view.copy_from(state.data);
+        if (state.input_time) {
+            m_view_input_time = state.input_time;
+            m_view_receive_time = state.receive_time;
+        }
+    }
+
+    void io_client::mark_drawn()
+    {
+        if (!m_view_input_time)
+            return;
+
+        const auto now = os_gettime_ns();
+        input_latency.record(now > m_view_input_time ? now - m_view_input_time : 0);
+        transport_latency.record(m_view_receive_time > m_view_input_time ?
+                                 m_view_receive_time - m_view_input_time : 0);
+        m_view_input_time = 0;
+    }
+
+    void io_client::publish()
+    {
+        auto &state = m_snapshots.back();
+        state.data.copy_from(m_holder);
+        m_holder.stop_mouse_motion(); /* Only the next snapshot with new samples moves the mouse again */
+        state.input_time = m_input_time;
+        state.receive_time = m_input_time ? os_gettime_ns() : 0;
+        m_snapshots.publish();
+        m_input_time = 0;
+    }
+
+    bool io_client::receive()
+    {
+        if (m_receive.receive(m_socket) <= 0)
+            return false;
+
+        auto received = false;
+        const auto handle = [this, &received](const uint8_t* data, const size_t size)
+        {
+            return handle_message(data, size, received);
+        };
+
+        while (m_receive.size() > 0) /* A read can end anywhere and contain multiple messages */
+        {
+            size_t length = 0;
+            const auto status = wire::message_length(m_receive.data(), m_receive.size(), &length);
+
+            if (status == wire::PS_INVALID)
+                return false;
+            if (status == wire::PS_INCOMPLETE) {
+                if (!m_receive.reserve(length)) {
+                    DEBUG_LOG(LOG_ERROR, "%s sent a message with more than %i bytes.", name(), RECEIVE_BUFFER_MAX);
+                    return false;
+                }
+                break;
+            }
+
+            if (!wire::for_each_message(m_receive.data(), length, handle))
+                return false;
+            m_receive.consume(length);
+        }
+
+        if (received)
+            publish();
+        return true;
     }
 
-    bool io_client::read_event(netlib_byte_buf* buffer, const message msg)
+    bool io_client::handle_message(const uint8_t* data, const size_t length, bool &received)
+    {
+        /* Messages are read where they are, so they can have any size */
+        auto view = wire::make_reader(data, length);
+        uint8_t id = 0;
+        if (!wire::read_uint8(&view, &id))
+            return false;
+
+        const auto msg = static_cast<message>(id);
+        uint32_t token = 0;
+
+        switch (msg) {
+            case MSG_MOUSE_DATA:
+            case MSG_BUTTON_DATA:
+            case MSG_GAMEPAD_DATA:
+            case MSG_INPUT_DELTA:
+                if (read_event(&view, msg))
+                    received = true;
+                else
+                    DEBUG_LOG(LOG_ERROR, "Failed to receive event data from %s.", name());
+                break;
+            case MSG_CLIENT_DC:
+                mark_invalid();
+                break;
+            case MSG_PUSH_MODE:
+                set_push_mode();
+                break;
+            case MSG_UDP_MODE:
+                if (!wire::read_varint(&view, &token))
+                    return false;
+                m_udp_token = token;
+                DEBUG_LOG(LOG_INFO, "%s is sending its input over udp.", name());
+                break;
+            case MSG_PONG:
+                if (!read_pong(&view))
+                    return false;
+                break;
+            case MSG_HELLO:
+                if (!read_hello(&view)) {
+                    DEBUG_LOG(LOG_ERROR, "Protocol handshake with %s failed.", name());
+                    return false;
+                }
+                break;
+            default:
+            case MSG_END_BUFFER:
+            case MSG_INVALID:
+                break;
+        }
+        return true;
+    }
+
+    bool io_client::read_event(wire::reader* buffer, const message msg)
     {
         auto flag = true;
 
@@ -62,18 +195,18 @@ namespace network
             uint8_t key_count = 0;
             uint16_t vc = 0;
 
-            if (!netlib_read_uint8(buffer, &key_count))
+            if (!wire::read_uint8(buffer, &key_count))
                 flag = false;
 
             if (flag) /* Only pressed buttons are sent */
             {
                 m_holder.clear_button_data();
                 for (int i = 0; i < key_count; i++) {
-                    if (!netlib_read_uint16(buffer, &vc)) {
+                    if (!wire::read_uint16(buffer, &vc)) {
                         flag = false;
                         break;
                     }
-                    m_holder.add_data(vc, new element_data_button(BS_PRESSED));
+                    m_holder.set_button(vc, BS_PRESSED);
                 }
             }
         } else if (msg == MSG_MOUSE_DATA) {
@@ -83,57 +216,234 @@ namespace network
             int16_t amount = 0;
             uint8_t pressed = 0;
 
-            flag = netlib_read_int16(buffer, &x) &&
-                   netlib_read_int16(buffer, &y) &&
-                   netlib_read_int8(buffer, &dir_read) &&
-                   netlib_read_int16(buffer, &amount) &&
-                   netlib_read_uint8(buffer, &pressed);
+            flag = wire::read_int16(buffer, &x) &&
+                   wire::read_int16(buffer, &y) &&
+                   wire::read_int8(buffer, &dir_read) &&
+                   wire::read_int16(buffer, &amount) &&
+                   wire::read_uint8(buffer, &pressed);
 
             if (flag) {
                 if (dir_read >= (int) DIR_NONE && dir_read <= (int) DIR_UP)
                     dir = (direction) dir_read;
 
-                m_holder.add_data(VC_MOUSE_DATA, new element_data_mouse_pos(x, y));
-                m_holder.add_data(VC_MOUSE_WHEEL,
-                                  new element_data_wheel(dir, pressed ? BS_PRESSED : BS_RELEASED));
+                m_mouse_x = x;
+                m_mouse_y = y;
+                m_holder.set_mouse_pos(x, y);
+                m_holder.add_data(VC_MOUSE_WHEEL, element_data_wheel(dir, pressed ? BS_PRESSED : BS_RELEASED));
             }
         } else if (msg == MSG_GAMEPAD_DATA) {
             uint8_t pad_id = 0;/*, trigger_l = 0, trigger_r = 0;
             float stick_l_x, stick_l_y, stick_r_x, stick_r_y; // TODO: unused? */
             uint16_t pad_buttons = 0;
 
-            flag = netlib_read_uint8(buffer, &pad_id) && netlib_read_uint16(buffer, &pad_buttons) && pad_id < 4;
+            flag = wire::read_uint8(buffer, &pad_id) && wire::read_uint16(buffer, &pad_buttons);
 
             if (flag) {
                 /* Add all buttons to the holder*/
                 for (auto &btn : xinput_fix::all_codes) {
-                    m_holder.add_gamepad_data(pad_id, xinput_fix::to_vc(btn), new element_data_button(
-                            (pad_buttons & btn) > 0 ? BS_PRESSED : BS_RELEASED));
+                    m_holder.set_gamepad_button(pad_id, xinput_fix::to_vc(btn),
+                                                (pad_buttons & btn) > 0 ? BS_PRESSED : BS_RELEASED);
                 }
 
                 /* Analog sticks are sent before triggers */
-                auto temp = element_data_analog_stick::from_buffer(buffer);
+                float axes[4] = {};
+                uint8_t triggers[2] = {};
 
-                if (temp) {
-                    temp->set_state((pad_buttons & xinput_fix::CODE_LEFT_THUMB) ? BS_PRESSED : BS_RELEASED,
-                                    (pad_buttons & xinput_fix::CODE_RIGHT_THUMB) ? BS_PRESSED : BS_RELEASED);
+                if (wire::read_float(buffer, &axes[0]) && wire::read_float(buffer, &axes[1]) &&
+                    wire::read_float(buffer, &axes[2]) && wire::read_float(buffer, &axes[3])) {
+                    m_holder.add_gamepad_data(pad_id, VC_STICK_DATA, element_data_analog_stick(
+                        (pad_buttons & xinput_fix::CODE_LEFT_THUMB) != 0,
+                        (pad_buttons & xinput_fix::CODE_RIGHT_THUMB) != 0, axes[0], axes[1], axes[2], axes[3]));
                 }
 
-                m_holder.add_gamepad_data(pad_id, VC_STICK_DATA, temp);
-
-
-                m_holder.add_gamepad_data(pad_id, VC_TRIGGER_DATA, element_data_trigger::from_buffer(buffer));
+                if (wire::read_uint8(buffer, &triggers[0]) && wire::read_uint8(buffer, &triggers[1]))
+                    m_holder.add_gamepad_data(pad_id, VC_TRIGGER_DATA,
+                                              element_data_trigger(triggers[0] / TRIGGER_MAX_VAL,
+                                                                   triggers[1] / TRIGGER_MAX_VAL));
             } else {
                 DEBUG_LOG(LOG_ERROR, "Couldn't read gamepad id from buffer");
             }
+        } else if (msg == MSG_INPUT_DELTA) {
+            flag = read_delta(buffer);
         }
 
         if (!flag)
-            DEBUG_LOG(LOG_ERROR, "Couldn't read event for client %s. Error: %s", name(), netlib_get_error());
+            DEBUG_LOG(LOG_ERROR, "Couldn't read event for client %s.", name());
 
         return flag;
     }
 
+    bool io_client::read_delta(wire::reader* buffer)
+    {
+        uint32_t sequence = 0, payload = 0;
+        uint8_t count = 0;
+        wire::delta_event type;
+
+        if (!wire::read_varint(buffer, &sequence) || !wire::read_varint(buffer, &m_timestamp) ||
+            !wire::read_uint8(buffer, &count))
+            return false;
+
+        /* Messages can't get lost over tcp, so this means the client state is out of sync */
+        if (sequence != m_sequence)
+            DEBUG_LOG(LOG_WARNING, "Expected message %u from %s, but got %u", m_sequence, name(), sequence);
+        m_sequence = sequence + 1;
+        note_input(m_timestamp);
+
+        for (auto i = 0; i < count; i++) {
+            if (!wire::read_event(buffer, &type, &payload) || !read_delta_event(buffer, type, payload))
+                return false;
+        }
+        return true;
+    }
+
+    bool io_client::read_delta_event(wire::reader* buffer, const wire::delta_event type, const uint32_t payload)
+    {
+        uint32_t values[4] = {};
+        uint8_t triggers[2] = {};
+        const auto pad_id = static_cast<uint8_t>(payload); /* Checked below for gamepad events */
+        const element_data* data = nullptr;
+
+        switch (type) {
+            case wire::DE_KEY_DOWN:
+                m_holder.set_button(static_cast<uint16_t>(payload), BS_PRESSED);
+                return true;
+            case wire::DE_KEY_UP:
+                m_holder.remove_data(static_cast<uint16_t>(payload)); /* Same as not being in MSG_BUTTON_DATA */
+                return true;
+            case wire::DE_MOUSE_POS:
+                if (!wire::read_varint(buffer, &values[0]) || !wire::read_varint(buffer, &values[1]))
+                    return false;
+                m_mouse_x += wire::unzigzag(values[0]);
+                m_mouse_y += wire::unzigzag(values[1]);
+                m_holder.set_mouse_pos(m_mouse_x, m_mouse_y);
+                return true;
+            case wire::DE_WHEEL:
+                if ((payload & 3) > 2)
+                    return false;
+                m_holder.add_data(VC_MOUSE_WHEEL, element_data_wheel(wheel_directions[payload & 3],
+                                                                     payload & 4 ? BS_PRESSED : BS_RELEASED));
+                return true;
+            case wire::DE_MOUSE_PATH:
+                return read_mouse_path(buffer, payload);
+            default:;
+        }
+
+        /* Gamepad events */
+        if (payload >= HOLDER_PAD_IDS)
+            return false;
+
+        if (type == wire::DE_PAD_BUTTONS) {
+            if (!wire::read_varint(buffer, &values[0]))
+                return false;
+
+            for (auto &btn : xinput_fix::all_codes) {
+                m_holder.set_gamepad_button(pad_id, xinput_fix::to_vc(btn),
+                                            (values[0] & btn) > 0 ? BS_PRESSED : BS_RELEASED);
+            }
+
+            /* Stick presses are stored with the stick data */
+            element_data_analog_stick stick;
+            data = m_holder.get_by_gamepad(pad_id, VC_STICK_DATA);
+            if (data && data->analog_stick())
+                stick = *data->analog_stick();
+            stick.set_state((values[0] & xinput_fix::CODE_LEFT_THUMB) ? BS_PRESSED : BS_RELEASED,
+                            (values[0] & xinput_fix::CODE_RIGHT_THUMB) ? BS_PRESSED : BS_RELEASED);
+            m_holder.add_gamepad_data(pad_id, VC_STICK_DATA, stick);
+        } else if (type == wire::DE_PAD_STICKS) {
+            for (auto &value : values) {
+                if (!wire::read_varint(buffer, &value))
+                    return false;
+            }
+
+            data = m_holder.get_by_gamepad(pad_id, VC_STICK_DATA);
+            const auto old = data ? data->analog_stick() : nullptr;
+            m_holder.add_gamepad_data(pad_id, VC_STICK_DATA, element_data_analog_stick(
+                old && old->left_pressed(), old && old->right_pressed(),
+                wire::dequantize_axis(static_cast<int16_t>(wire::unzigzag(values[0]))),
+                wire::dequantize_axis(static_cast<int16_t>(wire::unzigzag(values[1]))),
+                wire::dequantize_axis(static_cast<int16_t>(wire::unzigzag(values[2]))),
+                wire::dequantize_axis(static_cast<int16_t>(wire::unzigzag(values[3])))));
+        } else if (type == wire::DE_PAD_TRIGGERS) {
+            if (!wire::read_uint8(buffer, &triggers[0]) || !wire::read_uint8(buffer, &triggers[1]))
+                return false;
+            m_holder.add_gamepad_data(pad_id, VC_TRIGGER_DATA,
+                                      element_data_trigger(triggers[0] / TRIGGER_MAX_VAL,
+                                                           triggers[1] / TRIGGER_MAX_VAL));
+        }
+        return true;
+    }
+
+    void io_client::set_pad_state(const uint8_t pad_id, const uint16_t buttons, const float axes[4],
+                                  const uint8_t triggers[2])
+    {
+        for (auto &btn : xinput_fix::all_codes) {
+            m_holder.set_gamepad_button(pad_id, xinput_fix::to_vc(btn), (buttons & btn) > 0 ? BS_PRESSED : BS_RELEASED);
+        }
+
+        m_holder.add_gamepad_data(pad_id, VC_STICK_DATA, element_data_analog_stick(
+            (buttons & xinput_fix::CODE_LEFT_THUMB) > 0, (buttons & xinput_fix::CODE_RIGHT_THUMB) > 0,
+            axes[0], axes[1], axes[2], axes[3]));
+        m_holder.add_gamepad_data(pad_id, VC_TRIGGER_DATA,
+                                  element_data_trigger(triggers[0] / TRIGGER_MAX_VAL, triggers[1] / TRIGGER_MAX_VAL));
+    }
+
+    bool io_client::read_snapshot(wire::reader* buffer)
+    {
+        wire::snapshot snapshot;
+
+        if (!wire::read_snapshot(buffer, &snapshot) || !wire::accept_snapshot(&m_snapshot_order, snapshot.sequence))
+            return false;
+        if (snapshot.timestamp != m_timestamp) /* Repeated snapshots keep the timestamp of their input */
+            note_input(snapshot.timestamp);
+        m_timestamp = snapshot.timestamp;
+
+        m_holder.clear_button_data();
+        for (uint32_t i = 0; i < snapshot.key_count; i++)
+            m_holder.set_button(snapshot.keys[i], BS_PRESSED);
+
+        m_mouse_x = snapshot.mouse_x;
+        m_mouse_y = snapshot.mouse_y;
+        m_holder.set_mouse_pos(m_mouse_x, m_mouse_y);
+        m_holder.add_data(VC_MOUSE_WHEEL, element_data_wheel(wheel_directions[snapshot.wheel & 3],
+                                                             snapshot.wheel & 4 ? BS_PRESSED : BS_RELEASED));
+
+        for (auto pad = 0; pad < SNAPSHOT_MAX_PADS; pad++) {
+            /* Pads at rest aren't sent */
+            if (!(snapshot.pad_mask & (1u << pad)) && !m_holder.gamepad_data_exists(pad, VC_STICK_DATA))
+                continue;
+
+            float axes[4];
+            for (auto i = 0; i < 4; i++)
+                axes[i] = wire::dequantize_axis(snapshot.pad_axes[pad][i]);
+            set_pad_state(pad, snapshot.pad_buttons[pad], axes, snapshot.pad_triggers[pad]);
+        }
+        return true;
+    }
+
+    uint32_t io_client::udp_token() const
+    {
+        return m_udp_token;
+    }
+
+    bool io_client::read_hello(wire::reader* buffer)
+    {
+        uint8_t version = 0;
+        if (!wire::read_uint8(buffer, &version) || !version)
+            return false;
+
+        const uint8_t protocol = UTIL_MIN(version, PROTOCOL_VERSION);
+        m_protocol = protocol;
+        DEBUG_LOG(LOG_INFO, "%s is using protocol version %i.", name(), protocol);
+
+        const uint8_t reply[] = {MSG_HELLO, protocol};
+        return netlib_tcp_send(m_socket, reply, sizeof(reply)) >= static_cast<int>(sizeof(reply));
+    }
+
+    uint8_t io_client::protocol() const
+    {
+        return m_protocol;
+    }
+
     bool io_client::valid() const
     {
         return m_valid;
@@ -143,4 +453,137 @@ namespace network
     {
         m_valid = false;
     }
+
+    void io_client::set_push_mode()
+    {
+        if (!m_push_mode)
+            DEBUG_LOG(LOG_INFO, "%s is using push mode.", name());
+        m_push_mode = true;
+    }
+
+    bool io_client::push_mode() const
+    {
+        return m_push_mode;
+    }
+
+    bool io_client::queued() const
+    {
+        return m_queued;
+    }
+
+    void io_client::set_queued(const bool queued)
+    {
+        m_queued = queued;
+    }
+
+    bool* io_client::ready_flag()
+    {
+        return &m_ready;
+    }
+
+    void io_client::ping_sent(const uint64_t time)
+    {
+        m_ping_time = time;
+    }
+
+    bool io_client::read_pong(wire::reader* buffer)
+    {
+        uint32_t timestamp = 0;
+        const uint64_t sent = m_ping_time;
+        const auto now = os_gettime_ns();
+
+        if (!wire::read_varint(buffer, &timestamp))
+            return false;
+        if (!sent || now < sent)
+            return true;
+
+        /* The client answered somewhere in the middle of the round trip, the
+         * offset is most accurate for the ping which took the least time */
+        const auto rtt = now - sent;
+        m_best_rtt += RTT_AGING_NS;
+        if (!m_has_offset || rtt <= m_best_rtt) {
+            const auto middle = static_cast<int64_t>((sent + rtt / 2) / (1000 * 1000));
+            m_clock_offset = static_cast<int64_t>(timestamp) - middle;
+            m_best_rtt = rtt;
+            m_has_offset = true;
+        }
+        m_ping_time = 0;
+        return true;
+    }
+
+    void io_client::note_input(const uint32_t timestamp)
+    {
+        /* Only the oldest input until the next publish() counts */
+        if (!m_has_offset || m_input_time)
+            return;
+
+        const auto server_ms = static_cast<int64_t>(timestamp) - m_clock_offset;
+        const auto now = os_gettime_ns();
+        if (server_ms <= 0)
+            return;
+
+        /* The offset is only an estimate, input can't be from the future */
+        m_input_time = UTIL_MIN(static_cast<uint64_t>(server_ms) * 1000 * 1000, now);
+    }
+
+    bool io_client::read_mouse_path(wire::reader* buffer, const uint32_t count)
+    {
+        uint32_t time = 0, dd_x = 0, dd_y = 0;
+        int32_t v_x = 0, v_y = 0;
+
+        if (count > MOUSE_PATH_MAX)
+            return false;
+
+        for (uint32_t i = 0; i < count; i++) {
+            if (!wire::read_varint(buffer, &time) || !wire::read_varint(buffer, &dd_x) ||
+                !wire::read_varint(buffer, &dd_y))
+                return false;
+
+            v_x += wire::unzigzag(dd_x);
+            v_y += wire::unzigzag(dd_y);
+            m_mouse_x = static_cast<int16_t>(m_mouse_x + v_x);
+            m_mouse_y = static_cast<int16_t>(m_mouse_y + v_y);
+            m_mouse_time += time;
+
+            m_mouse_path[m_mouse_path_next] = {m_mouse_time, m_mouse_x, m_mouse_y};
+            m_mouse_path_next = (m_mouse_path_next + 1) % MOUSE_PATH_HISTORY;
+            m_mouse_path_size = UTIL_MIN(m_mouse_path_size + 1, MOUSE_PATH_HISTORY);
+        }
+
+        /* Older clients send positions once per refresh, so movement is measured over that
+         * interval. This keeps the mouse sensitivity of existing layouts the same */
+        int16_t from_x = 0, from_y = 0;
+        mouse_pos_at(m_mouse_time - io_config::refresh_rate, from_x, from_y);
+        m_holder.set_mouse_motion(from_x, from_y, m_mouse_x, m_mouse_y);
+        return true;
+    }
+
+    void io_client::mouse_pos_at(const uint32_t time, int16_t &x, int16_t &y) const
+    {
+        x = m_mouse_x;
+        y = m_mouse_y;
+
+        /* Newest to oldest, until a sample before the time is found */
+        for (auto i = 0; i < m_mouse_path_size; i++) {
+            const auto &sample = m_mouse_path[(m_mouse_path_next + MOUSE_PATH_HISTORY - 1 - i) % MOUSE_PATH_HISTORY];
+            const auto after = static_cast<int32_t>(time - sample.time);
+
+            if (after >= 0) {
+                if (i == 0 || after == 0) {
+                    x = sample.x;
+                    y = sample.y;
+                } else {
+                    /* Between this and the newer sample */
+                    const auto &newer =
+                        m_mouse_path[(m_mouse_path_next + MOUSE_PATH_HISTORY - i) % MOUSE_PATH_HISTORY];
+                    const auto f = static_cast<float>(after) / static_cast<int32_t>(newer.time - sample.time);
+                    x = static_cast<int16_t>(sample.x + (newer.x - sample.x) * f);
+                    y = static_cast<int16_t>(sample.y + (newer.y - sample.y) * f);
+                }
+                return;
+            }
+            x = sample.x;
+            y = sample.y; /* Oldest sample so far, used if none is old enough */
+        }
+    }
 }
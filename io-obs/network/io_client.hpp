@@ -8,11 +8,25 @@
 #pragma once
 
 #include "../util/element/element_data_holder.hpp"
+#include "../util/triple_buffer.hpp"
 #include "remote_connection.hpp"
+#include "receive_buffer.hpp"
+#include "wire_format.hpp"
 #include <netlib.h>
+#include <atomic>
+
+#define MOUSE_PATH_HISTORY 32
 
 namespace network
 {
+    /* Client state handed from its worker to the video thread */
+    struct client_state
+    {
+        element_data_holder data{true};
+        uint64_t input_time = 0; /* os_gettime_ns() of the oldest new input, 0 if unknown */
+        uint64_t receive_time = 0;
+    };
+
     class io_client
     {
     public:
@@ -26,20 +40,109 @@ namespace network
 
         uint8_t id() const;
 
+        /* State as of the last sync(), only use on the video thread */
         element_data_holder* get_data();
 
-        bool read_event(netlib_byte_buf* buffer, message msg);
+        /* Swaps in the newest published state, video thread only */
+        void sync();
+
+        /* Records the latency of the input shown since the last sync(), if it
+         * hasn't been drawn yet. Called by overlays after they were drawn */
+        void mark_drawn();
+
+        /* Makes all events read so far visible to sync(), only use on the client's worker */
+        void publish();
+
+        /* Receives once and handles all messages, which are complete.
+         * Returns false if the connection failed or the client sent invalid data */
+        bool receive();
+
+        bool read_event(wire::reader* buffer, message msg);
+
+        /* Reads the clients protocol version and answers with the one that will be used */
+        bool read_hello(wire::reader* buffer);
+
+        uint8_t protocol() const;
+
+        /* Reads a MSG_SNAPSHOT after its token, returns true if it was
+         * newer than the last one and replaced the current state */
+        bool read_snapshot(wire::reader* buffer);
+
+        uint32_t udp_token() const;
 
         void mark_invalid();
 
         bool valid() const;
 
+        /* Clients in push mode send their data on their own and only receive keepalives */
+        void set_push_mode();
+
+        bool push_mode() const;
+
+        /* Called by the network thread after sending MSG_PING_CLIENT */
+        void ping_sent(uint64_t time);
+
+        /* Set while a worker still has to receive from the socket, so it isn't handed out twice */
+        bool queued() const;
+
+        void set_queued(bool queued);
+
+        /* Set by the network thread when epoll reports the socket as readable, network thread only */
+        bool* ready_flag();
+
     private:
-        element_data_holder m_holder;
+        bool handle_message(const uint8_t* data, size_t length, bool &received);
+
+        bool read_delta(wire::reader* buffer);
+
+        bool read_delta_event(wire::reader* buffer, wire::delta_event type, uint32_t payload);
+
+        void set_pad_state(uint8_t pad_id, uint16_t buttons, const float axes[4], const uint8_t triggers[2]);
+
+        /* Uses the ping with the lowest round trip time to estimate the clock offset */
+        bool read_pong(wire::reader* buffer);
+
+        /* Remembers when the client received the input read last, in server time */
+        void note_input(uint32_t timestamp);
+
+        /* Replays the mouse positions of a DE_MOUSE_PATH */
+        bool read_mouse_path(wire::reader* buffer, uint32_t count);
+
+        /* Position along the replayed mouse path at a client time */
+        void mouse_pos_at(uint32_t time, int16_t &x, int16_t &y) const;
+
+        struct mouse_sample
+        {
+            uint32_t time; /* Client time in ms */
+            int16_t x, y;
+        };
+
+        receive_buffer m_receive;
+        element_data_holder m_holder; /* Written by the client's worker */
+        triple_buffer<client_state> m_snapshots;
+        element_data_holder m_view; /* Read by the video thread */
+        uint64_t m_view_input_time = 0, m_view_receive_time = 0; /* 0 once drawn */
         tcp_socket m_socket;
         uint8_t m_id;
         /* Set to false if this client should be disconnected on next roundtrip */
-        bool m_valid;
+        std::atomic<bool> m_valid;
+        std::atomic<bool> m_push_mode{false};
+        std::atomic<bool> m_queued{false};
+        bool m_ready = false;
+        std::atomic<uint8_t> m_protocol{1}; /* Read by the network thread */
+        uint32_t m_sequence = 0; /* Next expected MSG_INPUT_DELTA */
+        uint32_t m_timestamp = 0; /* Client time of the last MSG_INPUT_DELTA or MSG_SNAPSHOT */
+        int16_t m_mouse_x = 0, m_mouse_y = 0; /* Mouse deltas are relative to this */
+        mouse_sample m_mouse_path[MOUSE_PATH_HISTORY] = {}; /* Ring of the last replayed positions */
+        uint8_t m_mouse_path_next = 0, m_mouse_path_size = 0;
+        uint32_t m_mouse_time = 0; /* Time of the last DE_MOUSE_PATH sample */
+        std::atomic<uint32_t> m_udp_token{0}; /* 0 if the client doesn't use udp */
+        std::atomic<uint64_t> m_ping_time{0};
+        uint64_t m_input_time = 0; /* Oldest input since the last publish() */
+        uint64_t m_best_rtt = 0;
+        int64_t m_clock_offset = 0; /* Client time - server time in ms */
+        bool m_has_offset = false;
+        wire::snapshot_order m_snapshot_order;
         char* m_name;
     };
 }
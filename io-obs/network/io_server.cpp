@@ -12,27 +12,53 @@
 #include <obs-module.h>
 #include <util/platform.h>
 #include <algorithm>
+#include <thread>
 
+#ifdef _WIN32
 static netlib_socket_set sockets = nullptr;
+#else
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+#endif
 
 namespace network
 {
-    std::mutex mutex;
-
     io_server::io_server(const uint16_t port) : m_server(nullptr)
     {
+#ifdef _WIN32
         sockets = nullptr;
+#endif
         m_num_clients = 0;
         m_ip.port = port;
-        m_last_refresh = os_gettime_ns();
+        m_last_refresh = m_last_keepalive = m_last_latency_log = os_gettime_ns();
+        std::atomic_store(&m_published, std::make_shared<const client_list>());
     }
 
     io_server::~io_server()
     {
+        /* Workers are stopped first, so they don't
+         * refer to any clients or this server afterwards */
+        m_workers.clear();
+
         /* Smart pointer will delete 
          * and destructor will close socket
          */
         m_clients.clear();
+        m_frame_clients.reset();
+        std::atomic_store(&m_published, std::shared_ptr<const client_list>());
+        if (m_packets)
+            netlib_free_packets(m_packets);
+        if (m_udp)
+            netlib_udp_close(m_udp);
+#ifndef _WIN32
+        if (m_epoll >= 0)
+            close(m_epoll);
+        if (m_wake_fd >= 0)
+            close(m_wake_fd);
+#endif
     }
 
     bool io_server::init()
@@ -48,23 +74,99 @@ namespace network
                  ipaddr >> 8 & 0xff, ipaddr & 0xff, m_ip.port);
 
             m_server = netlib_tcp_open(&m_ip);
-            m_buffer = netlib_alloc_byte_buf(BUFFER_SIZE);
-
-            if (!m_buffer)
-                DEBUG_LOG(LOG_ERROR, "netlib_alloc_byte_buf failed; %s", netlib_get_error());
 
             if (!m_server) {
                 DEBUG_LOG(LOG_ERROR, "netlib_tcp_open failed: %s", netlib_get_error());
                 flag = false;
             }
         }
+
+        /* Decoding is spread over a few workers, so one slow client doesn't stall all others */
+        if (flag) {
+            const auto count = UTIL_CLAMP(1u, std::thread::hardware_concurrency() / 2, NETWORK_WORKERS_MAX);
+            for (auto i = 0u; i < count && flag; i++) {
+                m_workers.emplace_back(new client_worker(this));
+                flag = m_workers.back()->start();
+            }
+        }
+
+        /* Udp is optional, clients fall back to tcp if they don't get an answer */
+        if (flag) {
+            m_udp = netlib_udp_open(m_ip.port);
+            m_packets = m_udp ? netlib_alloc_packets(UDP_BATCH_SIZE, UDP_PACKET_SIZE) : nullptr;
+
+            if (!m_packets) {
+                DEBUG_LOG(LOG_WARNING, "Opening udp socket failed, only tcp is available: %s", netlib_get_error());
+                if (m_udp)
+                    netlib_udp_close(m_udp);
+                m_udp = nullptr;
+            }
+        }
+
+#ifndef _WIN32
+        if (flag) {
+            m_epoll = epoll_create1(EPOLL_CLOEXEC);
+            m_wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+            if (m_epoll < 0 || m_wake_fd < 0) {
+                DEBUG_LOG(LOG_ERROR, "Creating epoll instance failed: %s", strerror(errno));
+                flag = false;
+            } else {
+                epoll_event event = {};
+                event.events = EPOLLIN;
+                event.data.ptr = nullptr; /* nullptr marks the wake up event */
+                flag = epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wake_fd, &event) == 0 &&
+                       watch_socket(netlib_generic_socket(m_server), &m_server_ready, "server");
+            }
+
+            if (flag && m_udp && !watch_socket(netlib_generic_socket(m_udp), &m_udp_ready, "udp")) {
+                netlib_free_packets(m_packets);
+                netlib_udp_close(m_udp);
+                m_packets = nullptr;
+                m_udp = nullptr;
+            }
+        }
+#endif
         return flag;
     }
 
     void io_server::listen(int &numready)
     {
+#ifdef _WIN32
         if (create_sockets())
             numready = netlib_check_socket_set(sockets, LISTEN_TIMEOUT);
+#else
+        epoll_event events[EPOLL_MAX_EVENTS];
+        const auto count = epoll_wait(m_epoll, events, EPOLL_MAX_EVENTS, refresh_timeout());
+
+        if (count < 0) {
+            numready = errno == EINTR ? 0 : -1;
+            return;
+        }
+
+        numready = 0;
+        for (auto i = 0; i < count; i++) {
+            const auto ready = static_cast<bool*>(events[i].data.ptr);
+
+            if (ready) {
+                *ready = true;
+                numready++;
+            } else {
+                uint64_t value;
+                if (read(m_wake_fd, &value, sizeof(value)) < 0)
+                    DEBUG_LOG(LOG_ERROR, "Reading wake up event failed: %s", strerror(errno));
+            }
+        }
+#endif
+    }
+
+    void io_server::wake_up()
+    {
+#ifndef _WIN32
+        const uint64_t value = 1;
+        if (m_wake_fd >= 0 && write(m_wake_fd, &value, sizeof(value)) < 0)
+            DEBUG_LOG(LOG_ERROR, "Waking up network thread failed: %s", strerror(errno));
+#endif
     }
 
     tcp_socket io_server::socket() const
@@ -72,53 +174,110 @@ namespace network
         return m_server;
     }
 
-    void io_server::update_clients()
+    bool io_server::server_ready()
     {
-        mutex.lock();
+#ifdef _WIN32
+        return netlib_socket_ready(m_server);
+#else
+        const auto ready = m_server_ready;
+        m_server_ready = false;
+        return ready;
+#endif
+    }
 
+    void io_server::update_clients()
+    {
+        /* The client list is only modified on this thread, so no lock is needed to read it.
+         * Workers publish received data to the video thread through io_client::publish() */
+#ifdef _WIN32
+        const auto udp_ready = netlib_socket_ready(m_udp);
+#else
+        const auto udp_ready = m_udp_ready;
+        m_udp_ready = false;
+#endif
+        if (udp_ready)
+            receive_snapshots();
+
+        /* Queued clients are checked first, their worker could be receiving from the socket */
         for (const auto &client : m_clients) {
-            if (netlib_socket_ready(client->socket())) {
-                /* Receive input data */
-                m_buffer->read_pos = 0; /* Reset buffer */
-                const int read = netlib_tcp_recv_buf(client->socket(), m_buffer);
-
-                if (read < 0) {
-                    DEBUG_LOG(LOG_ERROR, "Failed to receive buffer from %s. Closed connection", client->name());
-                    client->mark_invalid();
+#ifdef _WIN32
+            if (!client->queued() && netlib_socket_ready(client->socket())) {
+#else
+            if (!client->queued() && *client->ready_flag()) {
+                *client->ready_flag() = false;
+#endif
+                client->set_queued(true);
+                worker(client.get())->queue_receive(client);
+            }
+        }
+    }
+
+    void io_server::receive_done(io_client* client)
+    {
+        /* Invalid clients stay queued until the next roundtrip removes them */
+        if (!client->valid()) {
+            wake_up();
+            return;
+        }
+
+        client->set_queued(false);
+#ifndef _WIN32
+        rearm_socket(client);
+#endif
+    }
+
+    client_worker* io_server::worker(const io_client* client) const
+    {
+        return m_workers[client->id() % m_workers.size()].get();
+    }
+
+    void io_server::publish_clients()
+    {
+        std::atomic_store(&m_published, std::make_shared<const client_list>(m_clients));
+        m_clients_changed = true;
+    }
+
+    void io_server::receive_snapshots()
+    {
+        /* Doesn't block, anything that's left will wake up the next listen() */
+        const auto count = netlib_udp_recv_packets(m_udp, m_packets);
+
+        for (auto i = 0; i < count; i++) {
+            const auto packet = m_packets[i];
+            auto view = wire::make_reader(packet->data, static_cast<size_t>(UTIL_MIN(packet->len, UDP_PACKET_SIZE)));
+            uint32_t token = 0;
+
+            if (!wire::read_snapshot_token(&view, &token))
+                continue;
+
+            /* The token alone could be guessed, so the packet also has to come from the client's host */
+            for (const auto &client : m_clients) {
+                if (client->udp_token() != token ||
+                    netlib_tcp_get_peer_address(client->socket())->host != packet->address.host)
                     continue;
-                }
 
-                while (m_buffer->read_pos < read) /* Buffer can contain multiple messages */
-                {
-                    const auto msg = read_msg_from_buffer(m_buffer);
-
-                    switch (msg) {
-                        case MSG_MOUSE_DATA:
-                        case MSG_BUTTON_DATA:
-                        case MSG_GAMEPAD_DATA:
-                            if (!client->read_event(m_buffer, msg))
-                                DEBUG_LOG(LOG_ERROR, "Failed to receive event data from %s.", client->name());
-                            break;
-                        case MSG_CLIENT_DC:
-                            client->mark_invalid();
-                            break;
-                        default:
-                        case MSG_END_BUFFER:
-                        case MSG_INVALID:
-                            break;
-                    }
-                }
+                worker(client.get())->queue_snapshot(client, view.data + view.pos,
+                                                     static_cast<uint8_t>(view.size - view.pos));
+                break;
             }
         }
-        mutex.unlock();
     }
 
-    void io_server::get_clients(std::vector<const char*> &v)
+    void io_server::sync_clients()
     {
-        for (const auto &client : m_clients) {
+        /* Disconnected clients are deleted here, if no worker still has them */
+        m_frame_clients = std::atomic_load(&m_published);
+        for (const auto &client : *m_frame_clients)
+            client->sync();
+    }
+
+    void io_server::get_clients(std::vector<std::string> &v)
+    {
+        m_clients_changed = false;
+        const auto clients = std::atomic_load(&m_published);
+        for (const auto &client : *clients) {
             v.emplace_back(client->name());
         }
-        m_clients_changed = false;
     }
 
     void io_server::get_clients(obs_property_t* prop, const bool enable_local)
@@ -128,7 +287,8 @@ namespace network
         if (enable_local)
             obs_property_list_add_int(prop, T_LOCAL_SOURCE, 0);
 
-        for (const auto &client : m_clients) {
+        const auto clients = std::atomic_load(&m_published);
+        for (const auto &client : *clients) {
             obs_property_list_add_int(prop, client->name(), client->id() + 1); /* 0 is for local input */
         }
     }
@@ -140,7 +300,9 @@ namespace network
 
     void io_server::ping_clients()
     {
-        for (auto &client : m_clients) {
+        /* Called from the settings dialog */
+        const auto clients = std::atomic_load(&m_published);
+        for (auto &client : *clients) {
             if (!send_message(client->socket(), MSG_PING_CLIENT))
                 client->mark_invalid(); /* Can't send data -> Connection is dead */
         }
@@ -148,46 +310,75 @@ namespace network
 
     void io_server::roundtrip()
     {
-        mutex.lock();
-
         if (!m_clients.empty()) {
             const auto old = server_instance->m_num_clients;
-            m_clients.erase(std::remove_if(m_clients.begin(), m_clients.end(), [](const std::unique_ptr<io_client> &o)
-            {
-                if (!o->valid()) {
-                    server_instance->m_num_clients--;
-                    DEBUG_LOG(LOG_INFO, "%s disconnected.", o->name());
-                    return true;
-                }
-                return false;
-            }), m_clients.end());
+            const auto it = std::stable_partition(m_clients.begin(), m_clients.end(),
+                                                  [](const std::shared_ptr<io_client> &o) { return o->valid(); });
+
+            for (auto i = it; i != m_clients.end(); ++i) {
+                server_instance->m_num_clients--;
+                DEBUG_LOG(LOG_INFO, "%s disconnected.", (*i)->name());
+#ifndef _WIN32
+                unwatch_socket(netlib_generic_socket((*i)->socket()));
+#endif
+            }
+            m_clients.erase(it, m_clients.end());
 
-            if ((os_gettime_ns() - m_last_refresh) / (1000 * 1000) > io_config::refresh_rate) {
+            const auto now = os_gettime_ns();
+            const auto refresh = (now - m_last_refresh) / (1000 * 1000) > io_config::refresh_rate;
+            const auto keepalive = (now - m_last_keepalive) / (1000 * 1000) > KEEPALIVE_INTERVAL;
+
+            if (refresh || keepalive) {
                 for (auto &client : m_clients) {
-                    if (!send_message(client->socket(), MSG_REFRESH))
+                    /* Clients in push mode don't need to be asked for data,
+                     * they only get pinged to check if they're still alive.
+                     * Newer clients answer pings, which is used to sync clocks */
+                    if (keepalive && (client->push_mode() || client->protocol() >= 5)) {
+                        if (send_message(client->socket(), MSG_PING_CLIENT))
+                            client->ping_sent(os_gettime_ns());
+                        else
+                            client->mark_invalid();
+                    }
+
+                    if (!client->push_mode() && refresh && !send_message(client->socket(), MSG_REFRESH))
                         client->mark_invalid();
                 }
-                m_last_refresh = os_gettime_ns();
             }
 
+            if (refresh)
+                m_last_refresh = now;
+            if (keepalive)
+                m_last_keepalive = now;
+
             if (old != server_instance->m_num_clients)
-                m_clients_changed = true;
+                publish_clients();
         }
 
-        mutex.unlock();
+        if ((os_gettime_ns() - m_last_latency_log) / (1000 * 1000) > LATENCY_LOG_INTERVAL)
+            log_latency();
+    }
+
+    void io_server::log_latency()
+    {
+        m_last_latency_log = os_gettime_ns();
+        if (input_latency.count() == m_logged_samples)
+            return;
+
+        m_logged_samples = input_latency.count();
+        blog(LOG_INFO, "[input-overlay] Remote input latency from %u inputs: p50 %i ms, p99 %i ms until drawn, "
+                       "p50 %i ms, p99 %i ms until received", m_logged_samples, input_latency.percentile(.5),
+             input_latency.percentile(.99), transport_latency.percentile(.5), transport_latency.percentile(.99));
     }
 
     io_client* io_server::get_client(const uint8_t id)
     {
-        if (id < m_clients.size())
-            return m_clients[id].get();
+        if (m_frame_clients && id < m_frame_clients->size())
+            return (*m_frame_clients)[id].get();
         return nullptr;
     }
 
     void io_server::add_client(tcp_socket socket, char* name)
     {
-        std::lock_guard<std::mutex> lock(mutex);
-
         fix_name(name);
 
         if (!strlen(name)) {
@@ -206,9 +397,15 @@ namespace network
 
         DEBUG_LOG(LOG_INFO, "Received connection from '%s'.", name);
 
-        m_clients_changed = true;
-        m_clients.emplace_back(new io_client(name, socket, m_num_clients));
+        m_clients.emplace_back(std::make_shared<io_client>(name, socket, m_num_clients));
         m_num_clients++;
+
+#ifndef _WIN32
+        /* Client will be removed on the next roundtrip */
+        if (!watch_socket(netlib_generic_socket(socket), m_clients.back()->ready_flag(), "client", true))
+            m_clients.back()->mark_invalid();
+#endif
+        publish_clients();
     }
 
     bool io_server::unique_name(char* name)
@@ -236,12 +433,13 @@ namespace network
         }
     }
 
+#ifdef _WIN32
     bool io_server::create_sockets()
     {
         if (sockets)
             netlib_free_socket_set(sockets);
 
-        sockets = netlib_alloc_socket_set(m_num_clients + 1);
+        sockets = netlib_alloc_socket_set(m_num_clients + 2);
         if (!sockets) {
             DEBUG_LOG(LOG_ERROR, "netlib_alloc_socket_set failed with %i clients.", m_num_clients + 1);
             network_flag = false;
@@ -249,10 +447,69 @@ namespace network
         }
 
         netlib_tcp_add_socket(sockets, m_server);
+        if (m_udp)
+            netlib_udp_add_socket(sockets, m_udp);
 
-        for (const auto &client : m_clients)
-            netlib_tcp_add_socket(sockets, client->socket());
+        /* Sockets that a worker still has to read from would be reported again */
+        for (const auto &client : m_clients) {
+            if (!client->queued())
+                netlib_tcp_add_socket(sockets, client->socket());
+        }
 
         return true;
     }
+#else
+    bool io_server::watch_socket(netlib_generic_socket socket, bool* ready, const char* type, const bool oneshot)
+    {
+        epoll_event event = {};
+        event.events = EPOLLIN | (oneshot ? EPOLLONESHOT : 0);
+        event.data.ptr = ready;
+
+        if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, netlib_socket_fd(socket), &event) != 0) {
+            DEBUG_LOG(LOG_ERROR, "Adding %s socket to epoll failed: %s", type, strerror(errno));
+            return false;
+        }
+        return true;
+    }
+
+    void io_server::rearm_socket(io_client* client)
+    {
+        epoll_event event = {};
+        event.events = EPOLLIN | EPOLLONESHOT;
+        event.data.ptr = client->ready_flag();
+
+        /* The client could have been removed in the meantime */
+        if (epoll_ctl(m_epoll, EPOLL_CTL_MOD, netlib_socket_fd(client->socket()), &event) != 0 && errno != ENOENT)
+            DEBUG_LOG(LOG_ERROR, "Rearming client socket failed: %s", strerror(errno));
+    }
+
+    void io_server::unwatch_socket(netlib_generic_socket socket)
+    {
+        epoll_ctl(m_epoll, EPOLL_CTL_DEL, netlib_socket_fd(socket), nullptr);
+    }
+
+    static int time_left(const uint64_t last, const uint64_t interval)
+    {
+        const auto elapsed = (os_gettime_ns() - last) / (1000 * 1000);
+        if (elapsed >= interval)
+            return 0;
+        return static_cast<int>(interval - elapsed + 1);
+    }
+
+    int io_server::refresh_timeout() const
+    {
+        /* Nothing to refresh, wait for new connections */
+        if (m_clients.empty())
+            return -1;
+
+        auto timeout = time_left(m_last_keepalive, KEEPALIVE_INTERVAL);
+        for (const auto &client : m_clients) {
+            if (!client->push_mode()) {
+                timeout = UTIL_MIN(timeout, time_left(m_last_refresh, io_config::refresh_rate));
+                break;
+            }
+        }
+        return timeout;
+    }
+#endif
 }
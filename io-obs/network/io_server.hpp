@@ -8,24 +8,33 @@
 #pragma once
 
 #include "io_client.hpp"
+#include "client_worker.hpp"
 #include <netlib.h>
 #include <vector>
 #include <memory>
 #include <obs-module.h>
-#include <mutex>
+#include <atomic>
+#include <string>
 
 #ifdef _WIN32
 #include <Windows.h>
 #endif
 
-#define BUFFER_SIZE 90
 #define LISTEN_TIMEOUT 25
+#define EPOLL_MAX_EVENTS 32
+#define KEEPALIVE_INTERVAL 1000 /* ms between pings to clients in push mode or with clock sync */
+#define LATENCY_LOG_INTERVAL 60000 /* ms between latency summaries in the log */
+#define UDP_BATCH_SIZE 32 /* Snapshots received with one call */
 enum message;
 
 namespace network
 {
-    extern std::mutex mutex;
+    typedef std::vector<std::shared_ptr<io_client>> client_list;
 
+    /* The client list is only changed by the network thread, which publishes
+     * a copy after every change. Other threads only read published copies, and
+     * a client is deleted once no copy or queued worker job refers to it anymore
+     */
     class io_server
     {
     public:
@@ -35,15 +44,31 @@ namespace network
 
         bool init();
 
+        /* Waits until a socket is readable, on linux this only times out
+         * when the next refresh request or keepalive has to be sent */
         void listen(int &numready);
 
+        /* Interrupts a listen() call from another thread */
+        void wake_up();
+
         tcp_socket socket() const;
 
+        /* True if a connection is waiting to be accepted, only reported once per listen() */
+        bool server_ready();
+
         void add_client(tcp_socket socket, char* name);
 
+        /* Hands ready clients to their worker */
         void update_clients();
 
-        void get_clients(std::vector<const char*> &v);
+        /* Called by a worker after it received from the socket of a client */
+        void receive_done(io_client* client);
+
+        /* Makes the newest client list and client data available to
+         * get_client(), call from the video thread once per frame */
+        void sync_clients();
+
+        void get_clients(std::vector<std::string> &v);
 
         void get_clients(obs_property_t* prop, bool enable_local);
 
@@ -51,11 +76,13 @@ namespace network
 
         void ping_clients();
 
-        /* Checks clients and removes them
-         * if necessary
+        /* Checks clients and removes them if necessary.
+         * Also asks clients, which don't push their data, for a refresh
+         * and sends keepalives to the ones that do
          */
         void roundtrip();
 
+        /* Client as of the last sync_clients(), video thread only */
         io_client* get_client(uint8_t id);
 
     private:
@@ -63,15 +90,51 @@ namespace network
 
         static void fix_name(char* name);
 
+        /* Hands all queued MSG_SNAPSHOT packets to the workers of their clients */
+        void receive_snapshots();
+
+        void publish_clients();
+
+        void log_latency();
+
+        client_worker* worker(const io_client* client) const;
+
+#ifdef _WIN32
         bool create_sockets();
+#else
+        /* Sockets stay registered with epoll until they're closed. listen() sets ready once
+         * the socket is readable. netlib's own ready flag isn't used, because netlib_tcp_recv()
+         * on the worker writes it */
+        bool watch_socket(netlib_generic_socket socket, bool* ready, const char* type, bool oneshot = false);
+
+        /* Client sockets are only reported once, until their worker is done with them */
+        void rearm_socket(io_client* client);
+
+        void unwatch_socket(netlib_generic_socket socket);
+
+        /* Milliseconds until the next refresh request or keepalive is due */
+        int refresh_timeout() const;
+
+        int m_epoll = -1;
+        int m_wake_fd = -1; /* eventfd used by wake_up() */
+        bool m_server_ready = false, m_udp_ready = false;
+#endif
 
         uint64_t m_last_refresh = 0;
-        netlib_byte_buf* m_buffer = nullptr; /* Used for temporarily storing sent data */
-        bool m_clients_changed = false; /* Set to true on connection/disconnect and false after get_clients() */
+        uint64_t m_last_keepalive = 0;
+        uint64_t m_last_latency_log = 0;
+        uint32_t m_logged_samples = 0;
+        /* Set to true on connection/disconnect and false after get_clients() */
+        std::atomic<bool> m_clients_changed{false};
         uint8_t m_num_clients;
         ip_address m_ip{};
         tcp_socket m_server;
-        std::vector<std::unique_ptr<io_client>> m_clients;
+        udp_socket m_udp = nullptr; /* Shares the port with m_server, nullptr if it couldn't be opened */
+        udp_packet** m_packets = nullptr;
+        std::vector<std::unique_ptr<client_worker>> m_workers;
+        client_list m_clients; /* Network thread only */
+        std::shared_ptr<const client_list> m_published; /* Only accessed with std::atomic_load/store */
+        std::shared_ptr<const client_list> m_frame_clients; /* Video thread only */
     };
 }
 
@@ -5,6 +5,8 @@
  * github.com/univrsal/input-overlay
  */
 
+#pragma once
+
 enum message
 {
     MSG_READ_ERROR = -2,
@@ -19,5 +21,12 @@ enum message
     MSG_CLIENT_DC,
     MSG_REFRESH,
     MSG_END_BUFFER,
+    MSG_PUSH_MODE, /* Client sends its data as soon as it changes and doesn't need MSG_REFRESH */
+    MSG_HELLO, /* Followed by a uint8 protocol version, see wire_format.hpp */
+    MSG_INPUT_DELTA,
+    MSG_FRAME, /* Followed by a varint length and that many bytes of messages */
+    MSG_UDP_MODE, /* Followed by a varint token, which identifies the clients MSG_SNAPSHOT packets */
+    MSG_SNAPSHOT, /* Only sent over udp */
+    MSG_PONG, /* Answer to MSG_PING_CLIENT, followed by the clients varint timestamp */
     MSG_LAST
 };
@@ -0,0 +1,74 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#include "receive_buffer.hpp"
+#include <cstring>
+
+/* Less free space than this is compacted or grown before receiving */
+#define RECEIVE_MIN_FREE 64
+
+receive_buffer::receive_buffer() : m_data(RECEIVE_BUFFER_SIZE)
+{
+}
+
+int receive_buffer::receive(tcp_socket socket)
+{
+    size_t free = 0;
+    const auto space = free_space(free);
+    if (!space)
+        return -1;
+
+    const auto read = netlib_tcp_recv(socket, space, static_cast<int>(free));
+    if (read > 0)
+        commit(static_cast<size_t>(read));
+    return read;
+}
+
+uint8_t* receive_buffer::free_space(size_t &free)
+{
+    if (m_data.size() - m_write < RECEIVE_MIN_FREE) {
+        compact();
+        if (m_data.size() - m_write < RECEIVE_MIN_FREE && !reserve(m_data.size() * 2))
+            return nullptr;
+    }
+
+    free = m_data.size() - m_write;
+    return m_data.data() + m_write;
+}
+
+void receive_buffer::commit(const size_t count)
+{
+    m_write += count;
+}
+
+void receive_buffer::consume(const size_t count)
+{
+    m_read += count;
+    if (m_read >= m_write) /* Everything was parsed, so the next read can start at the beginning */
+        m_read = m_write = 0;
+}
+
+bool receive_buffer::reserve(const size_t count)
+{
+    if (count > RECEIVE_BUFFER_MAX)
+        return false;
+
+    if (m_data.size() - m_read < count)
+        compact();
+    if (m_data.size() < count)
+        m_data.resize(count);
+    return true;
+}
+
+void receive_buffer::compact()
+{
+    if (!m_read)
+        return;
+    memmove(m_data.data(), m_data.data() + m_read, m_write - m_read);
+    m_write -= m_read;
+    m_read = 0;
+}
@@ -0,0 +1,58 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <netlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define RECEIVE_BUFFER_SIZE     256
+#define RECEIVE_BUFFER_MAX      (64 * 1024) /* Clients sending bigger messages are disconnected */
+
+/* Receive buffer of one client. Data is received directly behind
+ * the unparsed data and messages are parsed where they are. Only the
+ * unfinished message at the end is moved back to the start, once
+ * there isn't enough space left behind it
+ */
+class receive_buffer
+{
+public:
+    receive_buffer();
+
+    /* Receives once into the free space, same return values as netlib_tcp_recv */
+    int receive(tcp_socket socket);
+
+    /* Free space behind the unparsed data, which is compacted or grown first if there's
+     * too little. Returns nullptr if the buffer can't grow. Received data is added with commit() */
+    uint8_t* free_space(size_t &free);
+
+    void commit(size_t count);
+
+    /* Unparsed data */
+    const uint8_t* data() const
+    {
+        return m_data.data() + m_read;
+    }
+
+    size_t size() const
+    {
+        return m_write - m_read;
+    }
+
+    void consume(size_t count);
+
+    /* Makes room for a message of count bytes, returns false if it's too big */
+    bool reserve(size_t count);
+
+private:
+    void compact();
+
+    std::vector<uint8_t> m_data;
+    size_t m_read = 0, m_write = 0;
+};
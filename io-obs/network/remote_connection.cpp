@@ -22,11 +22,14 @@ namespace network
     char local_ip[16] = "127.0.0.1\0";
 
     io_server* server_instance = nullptr;
+    latency_histogram input_latency;
+    latency_histogram transport_latency;
 #ifdef _WIN32
     static HANDLE network_thread;
 #else
     static pthread_t network_thread;
 #endif
+    static bool thread_started = false;
 
     const char* get_status()
     {
@@ -68,6 +71,7 @@ namespace network
                     DEBUG_LOG(LOG_ERROR, "Server thread creation failed with code: %i", error);
                     failed = true;
                 }
+                thread_started = network_state;
             } else {
                 DEBUG_LOG(LOG_ERROR, "Server init failed");
                 failed = true;
@@ -87,7 +91,20 @@ namespace network
     {
         if (network_state) {
             network_flag = false;
+
+            /* Let the network thread leave listen() before the server is deleted */
+            if (thread_started) {
+                server_instance->wake_up();
+#ifdef _WIN32
+                WaitForSingleObject(network_thread, INFINITE);
+                CloseHandle(network_thread);
+#else
+                pthread_join(network_thread, nullptr);
+#endif
+                thread_started = false;
+            }
             delete server_instance;
+            server_instance = nullptr;
 
             netlib_quit();
         }
@@ -113,11 +130,13 @@ namespace network
             }
 
             if (!numready) {
+#ifdef _WIN32
                 os_sleep_ms(LISTEN_TIMEOUT); /* Should be fast enough */
+#endif
                 continue;
             }
 
-            if (netlib_socket_ready(server_instance->socket())) {
+            if (server_instance->server_ready()) {
                 numready--;
                 DEBUG_LOG(LOG_INFO, "Received connection...");
 
@@ -193,17 +212,4 @@ namespace network
 
         return *buf;
     }
-
-    message read_msg_from_buffer(netlib_byte_buf* buf)
-    {
-        uint8_t id = 0;
-        if (!netlib_read_uint8(buf, &id)) {
-            DEBUG_LOG(LOG_ERROR, "netlib_read_uint8: %s\n", netlib_get_error());
-            return MSG_READ_ERROR;
-        }
-
-        if (id <= MSG_LAST)
-            return message(id);
-        return MSG_INVALID;
-    }
 }
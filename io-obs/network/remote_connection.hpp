@@ -8,6 +8,7 @@
 #pragma once
 
 #include "messages.hpp"
+#include "../util/latency_histogram.hpp"
 #include <netlib.h>
 
 #ifdef _WIN32
@@ -41,11 +42,14 @@ namespace network
 
     char* read_text(tcp_socket sock, char** buf);
 
-    message read_msg_from_buffer(netlib_byte_buf* buf);
-
     int send_message(tcp_socket sock, message msg);
 
     extern io_server* server_instance;
+
+    /* Time from the hook of a client until the input was drawn or received by
+     * the server. Only clients with protocol version 5 or newer are measured */
+    extern latency_histogram input_latency;
+    extern latency_histogram transport_latency;
 }
 
 
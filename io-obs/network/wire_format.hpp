@@ -0,0 +1,562 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include "messages.hpp"
+#include <netlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Shared by the plugin and io-client
+ *
+ * Version 1 sends the full state (MSG_BUTTON_DATA, MSG_MOUSE_DATA, MSG_GAMEPAD_DATA).
+ * Version 2 adds MSG_INPUT_DELTA, which only contains what changed since the last message:
+ *  uint8   MSG_INPUT_DELTA
+ *  varint  sequence number, incremented with every message
+ *  varint  timestamp, milliseconds since the client connected
+ *  uint8   event count
+ *  events  varint header (payload << DELTA_TYPE_BITS | delta_event) followed by their data
+ *
+ * Version 3 wraps everything the client sends in MSG_FRAME, so the server knows how
+ * much data belongs together before parsing any of it. Unframed messages are still
+ * accepted, message_length() finds their end without parsing them.
+ *
+ * Version 4 lets clients send MSG_SNAPSHOT over udp instead, after they sent MSG_UDP_MODE
+ * over tcp, which stays open for everything else. Every packet contains the full state, so
+ * a lost packet is fixed by the next one and the newest sequence number always wins:
+ *  uint8   MSG_SNAPSHOT
+ *  varint  token from MSG_UDP_MODE
+ *  varint  sequence number, varint timestamp
+ *  varint  key count, followed by varint keycodes
+ *  zigzag varint mouse x and y, uint8 wheel like DE_WHEEL
+ *  varint  mask of included pads, each one has a varint button word,
+ *          four zigzag varint axes and two trigger bytes. Missing pads are in their rest state.
+ *          The mask was a byte before, which is the same as long as the eighth pad isn't included
+ *
+ * Version 5 answers MSG_PING_CLIENT with MSG_PONG and the current client time, which lets
+ * the server estimate the offset between both clocks. The timestamp of MSG_INPUT_DELTA and
+ * MSG_SNAPSHOT is the time the oldest input in it was received by the hook. Snapshots without
+ * new input repeat the timestamp of the last one
+ *
+ * Version 6 sends every mouse position the hook received since the last message with
+ * DE_MOUSE_PATH, so the server can replay the movement in between
+ *
+ * Clients start with version 1 and send MSG_HELLO with their version after their name.
+ * The server answers with MSG_HELLO and the version both sides support. Older servers
+ * don't answer, so those clients just keep using version 1
+ */
+#define PROTOCOL_VERSION    6
+#define UDP_PACKET_SIZE     255 /* Snapshots are written with netlib buffers, so they can't be bigger */
+#define SNAPSHOT_INTERVAL   100 /* ms after which the client repeats its snapshot if nothing changed */
+#define SNAPSHOT_MAX_KEYS   32 /* Leaves room for mouse and all pads in one packet */
+#define SNAPSHOT_MAX_PADS   32 /* Bits in the pad mask */
+#define FRAME_HEADER_MAX    3 /* MSG_FRAME and a two byte varint, enough for frames from netlib buffers */
+#define DELTA_TYPE_BITS     3
+#define MOUSE_PATH_MAX      12 /* Mouse positions per DE_MOUSE_PATH, older ones are thinned out to stay below */
+#define AXIS_MAX_VAL        32767.f
+
+namespace wire
+{
+    enum delta_event
+    {
+        DE_KEY_DOWN,        /* Payload is the keycode */
+        DE_KEY_UP,          /* Payload is the keycode */
+        DE_MOUSE_POS,       /* zigzag varint x and y offset to the last position */
+        DE_WHEEL,           /* Payload is (direction + 1) | pressed << 2, direction is -1 (up), 0 or 1 (down) */
+        DE_PAD_BUTTONS,     /* Payload is the pad id, varint button word */
+        DE_PAD_STICKS,      /* Payload is the pad id, zigzag varint left x, y and right x, y */
+        DE_PAD_TRIGGERS,    /* Payload is the pad id, uint8 left and right */
+        /* Payload is the sample count, each one is a varint time in ms since the sample before and
+         * the zigzag varint change in x and y movement (delta of delta). The first one continues
+         * from the last position and the time of the last sample, which starts at 0 */
+        DE_MOUSE_PATH,
+        DE_LAST
+    };
+
+    inline bool write_varint(netlib_byte_buf* buffer, uint32_t val)
+    {
+        while (val >= 0x80) {
+            if (!netlib_write_uint8(buffer, static_cast<uint8_t>(val | 0x80)))
+                return false;
+            val >>= 7;
+        }
+        return netlib_write_uint8(buffer, static_cast<uint8_t>(val)) != 0;
+    }
+
+    inline bool read_varint(netlib_byte_buf* buffer, uint32_t* val)
+    {
+        uint8_t byte = 0;
+        *val = 0;
+        for (auto shift = 0; shift < 35; shift += 7) {
+            if (!netlib_read_uint8(buffer, &byte))
+                return false;
+            *val |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false; /* More than five bytes can't be a 32 bit value */
+    }
+
+    /* Maps signed values to unsigned ones, so small negative values stay small */
+    inline uint32_t zigzag(const int32_t val)
+    {
+        return (static_cast<uint32_t>(val) << 1) ^ static_cast<uint32_t>(val >> 31);
+    }
+
+    inline int32_t unzigzag(const uint32_t val)
+    {
+        return static_cast<int32_t>(val >> 1) ^ -static_cast<int32_t>(val & 1);
+    }
+
+    inline uint8_t varint_size(uint32_t val)
+    {
+        uint8_t size = 1;
+        while (val >= 0x80) {
+            val >>= 7;
+            size++;
+        }
+        return size;
+    }
+
+    inline bool write_event(netlib_byte_buf* buffer, const delta_event type, const uint32_t payload)
+    {
+        return write_varint(buffer, payload << DELTA_TYPE_BITS | type);
+    }
+
+    inline bool read_event(netlib_byte_buf* buffer, delta_event* type, uint32_t* payload)
+    {
+        uint32_t header = 0;
+        if (!read_varint(buffer, &header) || (header & ((1 << DELTA_TYPE_BITS) - 1)) >= DE_LAST)
+            return false;
+        *type = static_cast<delta_event>(header & ((1 << DELTA_TYPE_BITS) - 1));
+        *payload = header >> DELTA_TYPE_BITS;
+        return true;
+    }
+
+    /* Stick axes are sent as int16 instead of floats */
+    inline int16_t quantize_axis(const float val)
+    {
+        const auto clamped = val < -1.f ? -1.f : (val > 1.f ? 1.f : val);
+        return static_cast<int16_t>(clamped * AXIS_MAX_VAL);
+    }
+
+    inline float dequantize_axis(const int16_t val)
+    {
+        return val / AXIS_MAX_VAL;
+    }
+
+    /* Writes DE_KEY_DOWN and DE_KEY_UP for the difference between two maps of
+     * pressed keycodes, sorted like std::map. count is increased per event */
+    template<class Keys>
+    inline bool write_key_delta(netlib_byte_buf* buffer, const Keys &keys, const Keys &sent_keys, uint8_t &count)
+    {
+        /* Both maps are sorted, so all presses and releases are found in one pass */
+        auto key = keys.begin();
+        auto sent = sent_keys.begin();
+
+        while (key != keys.end() || sent != sent_keys.end()) {
+            if (sent == sent_keys.end() || (key != keys.end() && key->first < sent->first)) {
+                if (!write_event(buffer, DE_KEY_DOWN, key->first))
+                    return false;
+                ++key;
+                ++count;
+            } else if (key == keys.end() || sent->first < key->first) {
+                if (!write_event(buffer, DE_KEY_UP, sent->first))
+                    return false;
+                ++sent;
+                ++count;
+            } else {
+                ++key;
+                ++sent;
+            }
+        }
+        return true;
+    }
+
+    /* State of a pad the way it is sent */
+    struct pad_values
+    {
+        uint16_t buttons;
+        int16_t axes[4]; /* Quantized left x, y and right x, y */
+        uint8_t triggers[2];
+    };
+
+    /* Writes the DE_PAD_* events for the parts of a pad that changed, count is increased per event */
+    inline bool write_pad_delta(netlib_byte_buf* buffer, const uint8_t pad, const pad_values &values,
+                                const pad_values &sent, uint8_t &count)
+    {
+        if (values.buttons != sent.buttons) {
+            if (!write_event(buffer, DE_PAD_BUTTONS, pad) || !write_varint(buffer, values.buttons))
+                return false;
+            count++;
+        }
+
+        if (memcmp(values.axes, sent.axes, sizeof(values.axes)) != 0) {
+            if (!write_event(buffer, DE_PAD_STICKS, pad))
+                return false;
+            for (const auto axis : values.axes) {
+                if (!write_varint(buffer, zigzag(axis)))
+                    return false;
+            }
+            count++;
+        }
+
+        if (values.triggers[0] != sent.triggers[0] || values.triggers[1] != sent.triggers[1]) {
+            if (!write_event(buffer, DE_PAD_TRIGGERS, pad) || !netlib_write_uint8(buffer, values.triggers[0]) ||
+                !netlib_write_uint8(buffer, values.triggers[1]))
+                return false;
+            count++;
+        }
+        return true;
+    }
+
+    /* A mouse position of DE_MOUSE_PATH */
+    struct path_sample
+    {
+        uint32_t time; /* Client time in ms */
+        int16_t x, y;
+    };
+
+    /* Appends a position to a path of at most MOUSE_PATH_MAX samples. A full path keeps every
+     * second sample if the server doesn't ask for data often enough, so it still covers all
+     * movement with less detail and the message size stays the same at any polling rate */
+    inline void add_path_sample(path_sample* path, uint8_t &size, const path_sample &sample)
+    {
+        if (size == MOUSE_PATH_MAX) {
+            for (auto i = 0; i < MOUSE_PATH_MAX / 2; i++)
+                path[i] = path[i * 2 + 1];
+            size = MOUSE_PATH_MAX / 2;
+        }
+        path[size++] = sample;
+    }
+
+    /* Writes DE_MOUSE_PATH, the first sample continues from the position the server has.
+     * last_time is the time of the last sample sent before and is updated */
+    inline bool write_mouse_path(netlib_byte_buf* buffer, const path_sample* path, const uint8_t size,
+                                 const int16_t from_x, const int16_t from_y, uint32_t &last_time)
+    {
+        /* Mouse movement is mostly smooth, so the change in movement stays small */
+        int32_t last_x = from_x, last_y = from_y;
+        int32_t v_x = 0, v_y = 0;
+
+        if (!write_event(buffer, DE_MOUSE_PATH, size))
+            return false;
+
+        for (auto i = 0; i < size; i++) {
+            const auto &sample = path[i];
+            const auto new_v_x = static_cast<int16_t>(sample.x - last_x);
+            const auto new_v_y = static_cast<int16_t>(sample.y - last_y);
+
+            if (!write_varint(buffer, sample.time - last_time) || !write_varint(buffer, zigzag(new_v_x - v_x)) ||
+                !write_varint(buffer, zigzag(new_v_y - v_y)))
+                return false;
+
+            v_x = new_v_x;
+            v_y = new_v_y;
+            last_x = sample.x;
+            last_y = sample.y;
+            last_time = sample.time;
+        }
+        return true;
+    }
+
+    enum parse_status
+    {
+        PS_COMPLETE,
+        PS_INCOMPLETE, /* More data has to be received first */
+        PS_INVALID
+    };
+
+    /* Reads a varint from raw data, pos is moved past it */
+    inline parse_status scan_varint(const uint8_t* data, const size_t size, size_t &pos, uint32_t* val)
+    {
+        *val = 0;
+        for (auto shift = 0; shift < 35; shift += 7) {
+            if (pos >= size)
+                return PS_INCOMPLETE;
+            const auto byte = data[pos++];
+            *val |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return PS_COMPLETE;
+        }
+        return PS_INVALID;
+    }
+
+    /* Reads a received message where it is. Unlike netlib_byte_buf, whose
+     * length is a byte, it works for messages of any size. Values are
+     * read in the same byte order as the netlib buffer functions write them */
+    struct reader
+    {
+        const uint8_t* data;
+        size_t size;
+        size_t pos;
+    };
+
+    inline reader make_reader(const uint8_t* data, const size_t size)
+    {
+        return {data, size, 0};
+    }
+
+    inline bool read_uint8(reader* buffer, uint8_t* val)
+    {
+        if (buffer->pos + 1 > buffer->size)
+            return false;
+        *val = buffer->data[buffer->pos++];
+        return true;
+    }
+
+    inline bool read_int8(reader* buffer, int8_t* val)
+    {
+        return read_uint8(buffer, reinterpret_cast<uint8_t*>(val));
+    }
+
+    /* Big endian, like netlib_read_uint16() */
+    inline bool read_uint16(reader* buffer, uint16_t* val)
+    {
+        if (buffer->pos + 2 > buffer->size)
+            return false;
+        *val = static_cast<uint16_t>(buffer->data[buffer->pos] << 8 | buffer->data[buffer->pos + 1]);
+        buffer->pos += 2;
+        return true;
+    }
+
+    inline bool read_int16(reader* buffer, int16_t* val)
+    {
+        return read_uint16(buffer, reinterpret_cast<uint16_t*>(val));
+    }
+
+    /* Native byte order, like netlib_read_float() */
+    inline bool read_float(reader* buffer, float* val)
+    {
+        if (buffer->pos + sizeof(float) > buffer->size)
+            return false;
+        memcpy(val, buffer->data + buffer->pos, sizeof(float));
+        buffer->pos += sizeof(float);
+        return true;
+    }
+
+    inline bool read_varint(reader* buffer, uint32_t* val)
+    {
+        return scan_varint(buffer->data, buffer->size, buffer->pos, val) == PS_COMPLETE;
+    }
+
+    inline bool read_event(reader* buffer, delta_event* type, uint32_t* payload)
+    {
+        uint32_t header = 0;
+        if (!read_varint(buffer, &header) || (header & ((1 << DELTA_TYPE_BITS) - 1)) >= DE_LAST)
+            return false;
+        *type = static_cast<delta_event>(header & ((1 << DELTA_TYPE_BITS) - 1));
+        *payload = header >> DELTA_TYPE_BITS;
+        return true;
+    }
+
+    /* Reads the message id and token in front of a udp packet's snapshot, false if it isn't one */
+    inline bool read_snapshot_token(reader* buffer, uint32_t* token)
+    {
+        uint8_t msg = 0;
+        return read_uint8(buffer, &msg) && msg == MSG_SNAPSHOT && read_varint(buffer, token) && *token;
+    }
+
+    /* Contents of a MSG_SNAPSHOT after its token */
+    struct snapshot
+    {
+        uint32_t sequence, timestamp;
+        uint32_t key_count;
+        uint16_t keys[SNAPSHOT_MAX_KEYS];
+        int16_t mouse_x, mouse_y;
+        uint8_t wheel; /* Like the payload of DE_WHEEL */
+        uint32_t pad_mask;
+        /* Pads which aren't in the mask are zero, axes still have to be dequantized */
+        uint16_t pad_buttons[SNAPSHOT_MAX_PADS];
+        int16_t pad_axes[SNAPSHOT_MAX_PADS][4];
+        uint8_t pad_triggers[SNAPSHOT_MAX_PADS][2];
+    };
+
+    inline bool read_snapshot(reader* buffer, snapshot* out)
+    {
+        uint32_t value = 0, mouse[2] = {};
+
+        *out = snapshot();
+        if (!read_varint(buffer, &out->sequence) || !read_varint(buffer, &out->timestamp) ||
+            !read_varint(buffer, &out->key_count) || out->key_count > SNAPSHOT_MAX_KEYS)
+            return false;
+
+        for (uint32_t i = 0; i < out->key_count; i++) {
+            if (!read_varint(buffer, &value))
+                return false;
+            out->keys[i] = static_cast<uint16_t>(value);
+        }
+
+        if (!read_varint(buffer, &mouse[0]) || !read_varint(buffer, &mouse[1]) || !read_uint8(buffer, &out->wheel) ||
+            !read_varint(buffer, &out->pad_mask) || (out->wheel & 3) > 2)
+            return false;
+        out->mouse_x = static_cast<int16_t>(unzigzag(mouse[0]));
+        out->mouse_y = static_cast<int16_t>(unzigzag(mouse[1]));
+
+        for (auto pad = 0; pad < SNAPSHOT_MAX_PADS; pad++) {
+            if (!(out->pad_mask & (1u << pad)))
+                continue;
+            if (!read_varint(buffer, &value))
+                return false;
+            out->pad_buttons[pad] = static_cast<uint16_t>(value);
+            for (auto &axis : out->pad_axes[pad]) {
+                if (!read_varint(buffer, &value))
+                    return false;
+                axis = static_cast<int16_t>(unzigzag(value));
+            }
+            if (!read_uint8(buffer, &out->pad_triggers[pad][0]) || !read_uint8(buffer, &out->pad_triggers[pad][1]))
+                return false;
+        }
+        return true;
+    }
+
+    /* Newest snapshot sequence of a client. Packets can arrive late or twice, so
+     * only snapshots newer than all accepted ones count. Sequences wrap around */
+    struct snapshot_order
+    {
+        uint32_t newest = 0;
+        bool any = false;
+    };
+
+    inline bool accept_snapshot(snapshot_order* order, const uint32_t sequence)
+    {
+        if (order->any && static_cast<int32_t>(sequence - order->newest) <= 0)
+            return false;
+        order->newest = sequence;
+        order->any = true;
+        return true;
+    }
+
+    /* Length of the message at the start of data, see message_length() */
+    inline parse_status scan_message(const uint8_t* data, const size_t size, size_t* length)
+    {
+        size_t pos = 1;
+        uint32_t value = 0;
+        auto status = PS_COMPLETE;
+
+        *length = 1;
+        if (!size)
+            return PS_INCOMPLETE;
+
+        switch (data[0]) {
+            case MSG_HELLO:
+                *length = 2;
+                break;
+            case MSG_BUTTON_DATA: /* Key count and keycodes */
+                *length = size < 2 ? 2 : 2 + 2 * static_cast<size_t>(data[1]);
+                break;
+            case MSG_MOUSE_DATA: /* Position, wheel direction, amount and state */
+                *length = 9;
+                break;
+            case MSG_GAMEPAD_DATA: /* Pad id, buttons, four float axes and two triggers */
+                *length = 22;
+                break;
+            case MSG_INPUT_DELTA:
+                for (auto i = 0; i < 2 && status == PS_COMPLETE; i++) /* Sequence number and timestamp */
+                    status = scan_varint(data, size, pos, &value);
+                if (status != PS_COMPLETE)
+                    return status;
+                if (pos >= size)
+                    return PS_INCOMPLETE;
+
+                for (auto count = data[pos++]; count > 0; count--) {
+                    auto varints = 0, bytes = 0;
+                    if ((status = scan_varint(data, size, pos, &value)) != PS_COMPLETE)
+                        return status;
+
+                    switch (value & ((1 << DELTA_TYPE_BITS) - 1)) {
+                        case DE_KEY_DOWN:
+                        case DE_KEY_UP:
+                        case DE_WHEEL:
+                            break;
+                        case DE_MOUSE_POS:
+                            varints = 2;
+                            break;
+                        case DE_PAD_BUTTONS:
+                            varints = 1;
+                            break;
+                        case DE_PAD_STICKS:
+                            varints = 4;
+                            break;
+                        case DE_PAD_TRIGGERS:
+                            bytes = 2;
+                            break;
+                        case DE_MOUSE_PATH:
+                            if ((value >> DELTA_TYPE_BITS) > MOUSE_PATH_MAX)
+                                return PS_INVALID;
+                            varints = 3 * static_cast<int>(value >> DELTA_TYPE_BITS);
+                            break;
+                        default:
+                            return PS_INVALID;
+                    }
+
+                    for (; varints > 0; varints--) {
+                        if ((status = scan_varint(data, size, pos, &value)) != PS_COMPLETE)
+                            return status;
+                    }
+                    pos += bytes;
+                    if (pos > size)
+                        return PS_INCOMPLETE;
+                }
+                *length = pos;
+                break;
+            case MSG_UDP_MODE:
+            case MSG_PONG:
+                if ((status = scan_varint(data, size, pos, &value)) != PS_COMPLETE)
+                    return status;
+                *length = pos;
+                break;
+            case MSG_FRAME:
+                if ((status = scan_varint(data, size, pos, &value)) != PS_COMPLETE)
+                    return status;
+                *length = pos + value;
+                break;
+            default:
+                if (data[0] >= MSG_LAST) /* Parsing on would only resync onto garbage */
+                    return PS_INVALID;
+                break; /* Everything else doesn't have any data */
+        }
+        return *length <= size ? PS_COMPLETE : PS_INCOMPLETE;
+    }
+
+    /* Finds the length of the message at the start of data without parsing it, so
+     * messages split across multiple reads are only handled once they're complete.
+     * If the data is incomplete, length is the size needed as far as it is known yet,
+     * which is always more than what was received */
+    inline parse_status message_length(const uint8_t* data, const size_t size, size_t* length)
+    {
+        const auto status = scan_message(data, size, length);
+        if (status == PS_INCOMPLETE && *length <= size)
+            *length = size + 1;
+        return status;
+    }
+
+    /* Calls handle(data, length) for a complete message from message_length(), or for
+     * each message in it if it is a MSG_FRAME. Frames only contain complete messages and
+     * can't be nested. Returns false if the frame is invalid or handle() returned false */
+    template<class F>
+    bool for_each_message(const uint8_t* data, const size_t length, F handle)
+    {
+        if (data[0] != MSG_FRAME)
+            return handle(data, length);
+
+        size_t pos = 1, inner = 0;
+        uint32_t frame_length = 0;
+        if (scan_varint(data, length, pos, &frame_length) != PS_COMPLETE || pos + frame_length != length)
+            return false;
+
+        while (pos < length) {
+            if (data[pos] == MSG_FRAME || message_length(data + pos, length - pos, &inner) != PS_COMPLETE ||
+                !handle(data + pos, inner))
+                return false;
+            pos += inner;
+        }
+        return true;
+    }
+}
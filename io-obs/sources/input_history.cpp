@@ -13,6 +13,7 @@
 #include "util/history/input_queue.hpp"
 #include "util/config-file.h"
 #include "network/io_server.hpp"
+#include "util/input_state.hpp"
 #include <iomanip>
 #include <obs-frontend-api.h>
 #include <util/config.hpp>
@@ -44,14 +45,8 @@ namespace sources
 
     inline void input_history_source::update(obs_data_t* settings)
     {
-        /* Get the input source */
-        if (hook::data_initialized || network::network_flag) {
-            uint8_t source_id = obs_data_get_int(settings, S_INPUT_SOURCE);
-            if (source_id > 0)
-                m_settings.data = network::server_instance->get_client(source_id)->get_data();
-            else
-                m_settings.data = hook::input_data;
-        }
+        /* Input data itself is fetched every tick */
+        m_settings.selected_source = obs_data_get_int(settings, S_INPUT_SOURCE);
 
         SET_FLAG((int) history_flags::INCLUDE_MOUSE, obs_data_get_bool(settings, S_HISTORY_INCLUDE_MOUSE));
         SET_FLAG((int) history_flags::REPEAT_KEYS, obs_data_get_bool(settings, S_HISTORY_ENABLE_REPEAT_KEYS));
@@ -97,6 +92,7 @@ namespace sources
             return; /* No input collection if it's blocked */
 
         m_settings.queue->tick(seconds);
+        m_settings.data = input_state::get(m_settings.selected_source);
 
         if (GET_FLAG((int) history_flags::AUTO_CLEAR)) {
             m_clear_timer += seconds;
@@ -110,6 +106,9 @@ namespace sources
             }
         }
 
+        if (!m_settings.data)
+            return;
+
         m_collect_timer += seconds;
         if (m_collect_timer >= m_settings.update_interval) {
             m_collect_timer = 0.f;
@@ -289,7 +288,7 @@ namespace sources
         if (io_config::gamepad) {
             const auto include_pad = obs_properties_add_bool(props, S_HISTORY_INCLUDE_PAD, T_HISTORY_INCLUDE_PAD);
             obs_property_set_modified_callback(include_pad, include_pad_changed);
-            obs_properties_add_int(props, S_CONTROLLER_ID, T_CONTROLLER_ID, 0, 3, 1);
+            obs_properties_add_int(props, S_CONTROLLER_ID, T_CONTROLLER_ID, 0, HOLDER_PAD_IDS - 1, 1);
         }
 
         /* Auto clear */
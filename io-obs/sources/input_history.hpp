@@ -56,7 +56,8 @@ namespace sources
         const char* icon_cfg_path = nullptr;    /* Path to icon config file */
 
         /* General values */
-        element_data_holder* data = nullptr;    /* Points to selected input source */
+        element_data_holder* data = nullptr;    /* Points to selected input source, updated every tick */
+        uint8_t selected_source = 0;            /* 0 = Local input */
         obs_source_t* source = nullptr;         /* input-history source */
         obs_data_t* settings = nullptr;         /* input-history settings (includes text source settings) */
         uint16_t flags = 0x0;                   /* Contains all settings flags */
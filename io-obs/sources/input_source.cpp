@@ -10,7 +10,8 @@
 #include "../hook/gamepad_hook.hpp"
 #include "../util/element/element_data_holder.hpp"
 #include "../util/util.hpp"
-#include "../../ccl/ccl.hpp"
+#include "../util/layout_file.hpp"
+#include "../util/resource_cache.hpp"
 #include "util/layout_constants.hpp"
 #include "util/config-file.h"
 #include "network/remote_connection.hpp"
@@ -38,12 +39,14 @@ namespace sources
         m_settings.right_dz = obs_data_get_int(settings, S_CONTROLLER_R_DEAD_ZONE) / STICK_MAX_VAL;
 #endif
         m_settings.mouse_sens = obs_data_get_int(settings, S_MOUSE_SENS);
+        m_settings.render_cached = obs_data_get_bool(settings, S_RENDER_CACHED);
 
         if ((m_settings.use_center = obs_data_get_bool(settings, S_MONITOR_USE_CENTER))) {
             m_settings.monitor_h = obs_data_get_int(settings, S_MONITOR_H_CENTER);
             m_settings.monitor_w = obs_data_get_int(settings, S_MONITOR_V_CENTER);
             m_settings.mouse_deadzone = obs_data_get_int(settings, S_MOUSE_DEAD_ZONE);
         }
+        m_overlay->invalidate();
     }
 
     inline void input_source::tick(float seconds)
@@ -70,10 +73,8 @@ namespace sources
     bool path_changed(obs_properties_t* props, obs_property_t* p, obs_data_t* s)
     {
         UNUSED_PARAMETER(p);
-        const std::string cfg = obs_data_get_string(s, S_LAYOUT_FILE);
-        auto temp = ccl_config(cfg, "");
-
-        const auto flags = temp.get_int(CFG_FLAGS, true);
+        const auto layout = resource_cache::get_layout(obs_data_get_string(s, S_LAYOUT_FILE));
+        const auto flags = layout ? layout->header()->layout_flags : 0;
 
         obs_property_set_visible(GET_PROPS(S_CONTROLLER_L_DEAD_ZONE), flags & (int)
                                  OF_LEFT_STICK);
@@ -115,16 +116,6 @@ namespace sources
         return true;
     }
 
-    bool reload_pads(obs_properties_t* props, obs_property_t* property, void* data)
-    {
-        UNUSED_PARAMETER(props);
-        UNUSED_PARAMETER(property);
-        UNUSED_PARAMETER(data);
-
-        gamepad::init_pad_devices();
-        return true;
-    }
-
     obs_properties_t* get_properties_for_overlay(void* data)
     {
         UNUSED_PARAMETER(data);
@@ -155,6 +146,8 @@ namespace sources
 
         obs_property_set_modified_callback(cfg, path_changed);
 
+        obs_properties_add_bool(props, S_RENDER_CACHED, T_RENDER_CACHED);
+
         /* Mouse stuff */
         obs_property_set_visible(obs_properties_add_int_slider(props, S_MOUSE_SENS, T_MOUSE_SENS, 1, 500, 1), false);
 
@@ -169,7 +162,8 @@ namespace sources
                                  false);
 
         /* Gamepad stuff */
-        obs_property_set_visible(obs_properties_add_int(props, S_CONTROLLER_ID, T_CONTROLLER_ID, 0, 3, 1), false);
+        obs_property_set_visible(obs_properties_add_int(props, S_CONTROLLER_ID, T_CONTROLLER_ID, 0,
+                                                        HOLDER_PAD_IDS - 1, 1), false);
 
 #if _WIN32 /* Linux only allows analog stick values 0 - 127 -> No reason for a deadzone */
         obs_property_set_visible(obs_properties_add_int_slider(props, S_CONTROLLER_L_DEAD_ZONE,
@@ -178,8 +172,6 @@ namespace sources
         obs_property_set_visible(obs_properties_add_int_slider(props, S_CONTROLLER_R_DEAD_ZONE,
             T_CONROLLER_R_DEADZONE, 1,
             STICK_MAX_VAL - 1, 1), false);
-#else
-        obs_properties_add_button(props, S_RELOAD_PAD_DEVICES, T_RELOAD_PAD_DEVICES, reload_pads);
 #endif
 
         return props;
@@ -38,6 +38,7 @@ namespace sources
 #endif
         uint8_t selected_source = 0;            /* 0 = Local input */
         uint8_t layout_flags = 0;               /* See overlay_flags in layout_constants.hpp */
+        bool render_cached = false;             /* Only redraw into a cached texture if input changed */
         obs_data_t* data = nullptr;             /* Pointer to source property data */
     };
 
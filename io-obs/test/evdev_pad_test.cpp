@@ -0,0 +1,154 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#include "hook/evdev_pad.hpp"
+#include "hook/gamepad_binding.hpp"
+#include "util/element/element_data_holder.hpp"
+#include "util/util.hpp"
+#include <cstdio>
+#include <vector>
+
+/* Feeds evdev events into an evdev_pad without a device and checks
+ * what apply() writes into element_data_holder */
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                    \
+    do {                                                    \
+        if (!(cond)) {                                      \
+            fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                   \
+            fputc('\n', stderr);                            \
+            failures++;                                     \
+        }                                                   \
+    } while (0)
+
+static input_event make_event(const uint16_t type, const uint16_t code, const int32_t value, const long usec)
+{
+    input_event event = {};
+    event.input_event_sec = 10;
+    event.input_event_usec = usec;
+    event.type = type;
+    event.code = code;
+    event.value = value;
+    return event;
+}
+
+/* Collects the press log entries after index from */
+static std::vector<press_event> presses_since(const element_data_holder &data, const uint64_t from)
+{
+    std::vector<press_event> result;
+    for (auto i = from; i < data.get_press_count(); i++) {
+        if (const auto event = data.get_press(i))
+            result.emplace_back(*event);
+    }
+    return result;
+}
+
+/* A tap shorter than the time between two reads arrives as press, SYN, release, SYN in one batch */
+static void test_tap_in_one_batch()
+{
+    gamepad::evdev_pad pad;
+    element_data_holder data;
+    const auto button = PAD_TO_VC(gamepad::PAD_A);
+
+    pad.apply(&data); /* The first apply() writes the whole state */
+    const auto start = data.get_press_count();
+
+    const input_event events[] = {make_event(EV_KEY, BTN_SOUTH, 1, 1000), make_event(EV_SYN, SYN_REPORT, 0, 1000),
+                                  make_event(EV_KEY, BTN_SOUTH, 0, 9000), make_event(EV_SYN, SYN_REPORT, 0, 9000)};
+    const auto frames = pad.handle_events(events, 4);
+    CHECK(frames == 2, "expected 2 frames, got %i", frames);
+    pad.apply(&data);
+
+    const auto presses = presses_since(data, start);
+    CHECK(presses.size() == 2, "expected a press and a release, got %zu events", presses.size());
+    if (presses.size() == 2) {
+        CHECK(presses[0].keycode == button && presses[0].pressed && presses[0].gamepad == 0,
+              "first event isn't the press");
+        CHECK(presses[1].keycode == button && !presses[1].pressed && presses[1].gamepad == 0,
+              "second event isn't the release");
+    }
+
+    const auto state = data.get_by_gamepad(0, button);
+    CHECK(state && state->button() && state->button()->get_state() == BS_RELEASED, "button should end up released");
+    CHECK(data.get_last_input() == 10001000000ull, "last input should be the time of the press, is %llu",
+          static_cast<unsigned long long>(data.get_last_input()));
+}
+
+/* Events after the last SYN_REPORT belong to a frame that isn't complete yet */
+static void test_incomplete_frame()
+{
+    gamepad::evdev_pad pad;
+    element_data_holder data;
+    const auto button = PAD_TO_VC(gamepad::PAD_B);
+
+    pad.apply(&data);
+    const auto start = data.get_press_count();
+
+    const input_event first[] = {make_event(EV_KEY, BTN_EAST, 1, 100)};
+    CHECK(pad.handle_events(first, 1) == 0, "frame without SYN_REPORT counted as complete");
+    pad.apply(&data);
+    CHECK(presses_since(data, start).empty(), "incomplete frame was applied");
+
+    const input_event second[] = {make_event(EV_SYN, SYN_REPORT, 0, 200)};
+    CHECK(pad.handle_events(second, 1) == 1, "SYN_REPORT didn't complete the frame");
+    pad.apply(&data);
+
+    const auto presses = presses_since(data, start);
+    CHECK(presses.size() == 1 && presses[0].keycode == button && presses[0].pressed, "press wasn't applied");
+}
+
+/* After SYN_DROPPED everything up to the next SYN_REPORT is ignored */
+static void test_dropped_events()
+{
+    gamepad::evdev_pad pad;
+    element_data_holder data;
+
+    pad.apply(&data);
+    const auto start = data.get_press_count();
+
+    const input_event events[] = {make_event(EV_SYN, SYN_DROPPED, 0, 100), make_event(EV_KEY, BTN_NORTH, 1, 100),
+                                  make_event(EV_SYN, SYN_REPORT, 0, 100), make_event(EV_KEY, BTN_WEST, 1, 200),
+                                  make_event(EV_SYN, SYN_REPORT, 0, 200)};
+    CHECK(pad.handle_events(events, 5) == 2, "expected 2 frames");
+    pad.apply(&data);
+
+    const auto presses = presses_since(data, start);
+    CHECK(presses.size() == 1 && presses[0].keycode == PAD_TO_VC(gamepad::PAD_X), "only X should be pressed");
+}
+
+/* More frames than the queue holds keep the newest state */
+static void test_full_queue()
+{
+    gamepad::evdev_pad pad;
+    element_data_holder data;
+    const auto button = PAD_TO_VC(gamepad::PAD_Y);
+
+    pad.apply(&data);
+    for (auto i = 0; i < EVDEV_FRAME_QUEUE * 2 + 1; i++) {
+        const input_event events[] = {make_event(EV_KEY, BTN_NORTH, (i + 1) % 2, i),
+                                      make_event(EV_SYN, SYN_REPORT, 0, i)};
+        pad.handle_events(events, 2);
+    }
+    pad.apply(&data);
+
+    const auto state = data.get_by_gamepad(0, button);
+    CHECK(state && state->button() && state->button()->get_state() == BS_PRESSED, "newest frame wasn't applied");
+}
+
+int main()
+{
+    test_tap_in_one_batch();
+    test_incomplete_frame();
+    test_dropped_events();
+    test_full_queue();
+
+    if (failures)
+        fprintf(stderr, "%d checks failed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,281 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#include "util/element/element_data_holder.hpp"
+#include <uiohook.h>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+
+/* Per frame cost of a layout with 100 keys, once with element_data_holder and once
+ * with a copy of the holder from before element data became a tagged value type,
+ * which kept one heap object with virtual methods per slot. A frame applies the
+ * events since the last one, copies the state like the gamepad hook does for the
+ * video thread and then looks up the data of every element like overlay::update_batch().
+ * Build with -DIO_TEST_SANITIZER= for numbers that mean anything */
+
+#define LAYOUT_KEYS      100
+#define EVENTS_PER_FRAME 16 /* A 1000 Hz mouse at 60 fps */
+#define WARMUP_FRAMES    100
+#define BENCH_FRAMES     5000
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                    \
+    do {                                                    \
+        if (!(cond)) {                                      \
+            fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                   \
+            fputc('\n', stderr);                            \
+            failures++;                                     \
+        }                                                   \
+    } while (0)
+
+namespace virtual_design
+{
+    class data
+    {
+    public:
+        explicit data(const element_type type) : m_type(type)
+        {
+        }
+
+        virtual ~data() = default;
+
+        element_type get_type() const
+        {
+            return m_type;
+        }
+
+        virtual bool merge(data* other)
+        {
+            UNUSED_PARAMETER(other);
+            return false;
+        }
+
+    protected:
+        element_type m_type;
+    };
+
+    class data_button : public data
+    {
+    public:
+        explicit data_button(const button_state state) : data(ET_BUTTON), m_state(state)
+        {
+        }
+
+        button_state get_state() const
+        {
+            return m_state;
+        }
+
+        bool set_state(const button_state state)
+        {
+            const auto pressed = m_state == BS_RELEASED && state == BS_PRESSED;
+            m_state = state;
+            return pressed;
+        }
+
+        bool merge(data* other) override
+        {
+            const auto button = dynamic_cast<data_button*>(other);
+            return button && set_state(button->m_state);
+        }
+
+    private:
+        button_state m_state;
+    };
+
+    class data_mouse_pos : public data
+    {
+    public:
+        data_mouse_pos(const int16_t x, const int16_t y) : data(ET_MOUSE_STATS), m_x(x), m_y(y)
+        {
+        }
+
+        void set_pos(const int16_t x, const int16_t y)
+        {
+            m_x = x;
+            m_y = y;
+        }
+
+        bool merge(data* other) override
+        {
+            const auto pos = dynamic_cast<data_mouse_pos*>(other);
+            if (pos)
+                set_pos(pos->m_x, pos->m_y);
+            return false;
+        }
+
+    private:
+        int16_t m_x, m_y;
+    };
+
+    template<class T>
+    static void copy_as(std::unique_ptr<data> &dst, const data* src)
+    {
+        if (dst && dst->get_type() == src->get_type())
+            *static_cast<T*>(dst.get()) = *static_cast<const T*>(src);
+        else
+            dst = std::unique_ptr<data>(new T(*static_cast<const T*>(src)));
+    }
+
+    /* Only the parts of the old element_data_holder the frame needs, same slot layout */
+    class holder
+    {
+    public:
+        void add_data(const uint16_t keycode, data* d)
+        {
+            m_version++;
+            const auto slot = slot_of(keycode);
+            auto &entry = m_data[slot];
+            if (entry) {
+                entry->merge(d);
+                delete d;
+            } else {
+                entry = std::unique_ptr<data>(d);
+            }
+        }
+
+        void set_button(const uint16_t keycode, const button_state state)
+        {
+            auto* d = m_data[slot_of(keycode)].get();
+            if (d && d->get_type() == ET_BUTTON) {
+                m_version++;
+                static_cast<data_button*>(d)->set_state(state);
+            } else {
+                add_data(keycode, new data_button(state));
+            }
+        }
+
+        void set_mouse_pos(const int16_t x, const int16_t y)
+        {
+            auto* d = m_data[slot_of(VC_MOUSE_DATA)].get();
+            if (d && d->get_type() == ET_MOUSE_STATS) {
+                static_cast<data_mouse_pos*>(d)->set_pos(x, y);
+                m_version++;
+            } else {
+                add_data(VC_MOUSE_DATA, new data_mouse_pos(x, y));
+            }
+        }
+
+        data* get_by_code(const uint16_t keycode) const
+        {
+            return m_data[slot_of(keycode)].get();
+        }
+
+        void copy_from(const holder &other)
+        {
+            m_version++;
+            for (auto slot = 0; slot < HOLDER_BUTTON_SLOTS; slot++) {
+                const auto &src = other.m_data[slot];
+                if (!src)
+                    m_data[slot].reset();
+                else if (src->get_type() == ET_BUTTON)
+                    copy_as<data_button>(m_data[slot], src.get());
+                else
+                    copy_as<data_mouse_pos>(m_data[slot], src.get());
+            }
+        }
+
+    private:
+        /* Keys are on page 0, the mouse data on page 4 */
+        static int slot_of(const uint16_t keycode)
+        {
+            return (keycode >> 8 ? 4 * HOLDER_PAGE_SIZE : 0) + (keycode & 0xff);
+        }
+
+        std::unique_ptr<data> m_data[HOLDER_BUTTON_SLOTS];
+        uint64_t m_version = 0;
+    };
+}
+
+/* The layout uses the first LAYOUT_KEYS keycodes, events hit a third of them */
+static uint16_t layout_key(const int i)
+{
+    return static_cast<uint16_t>(1 + i);
+}
+
+template<class Holder>
+static void apply_events(Holder &holder, std::minstd_rand &rng)
+{
+    static int16_t x = 0, y = 0;
+
+    for (auto i = 0; i < EVENTS_PER_FRAME; i++) {
+        if (rng() % 4) {
+            x = static_cast<int16_t>(x + static_cast<int>(rng() % 9) - 4);
+            y = static_cast<int16_t>(y + static_cast<int>(rng() % 9) - 4);
+            holder.set_mouse_pos(x, y);
+        } else {
+            holder.set_button(layout_key(rng() % (LAYOUT_KEYS / 3)), rng() % 2 ? BS_PRESSED : BS_RELEASED);
+        }
+    }
+}
+
+static int count_pressed(const element_data_holder &view)
+{
+    auto pressed = 0;
+    for (auto i = 0; i < LAYOUT_KEYS; i++) {
+        const auto data = view.get_by_code(layout_key(i));
+        const auto button = data ? data->button() : nullptr;
+        if (button && button->get_state() == BS_PRESSED)
+            pressed++;
+    }
+    return pressed;
+}
+
+static int count_pressed(const virtual_design::holder &view)
+{
+    auto pressed = 0;
+    for (auto i = 0; i < LAYOUT_KEYS; i++) {
+        const auto button = dynamic_cast<virtual_design::data_button*>(view.get_by_code(layout_key(i)));
+        if (button && button->get_state() == BS_PRESSED)
+            pressed++;
+    }
+    return pressed;
+}
+
+/* Returns the time per frame in ns, pressed adds up the pressed elements of every frame */
+template<class Holder>
+static double run_frames(Holder &holder, Holder &view, const int frames, long long &pressed)
+{
+    std::minstd_rand rng(6);
+    const auto start = std::chrono::steady_clock::now();
+
+    for (auto i = 0; i < frames; i++) {
+        apply_events(holder, rng);
+        view.copy_from(holder);
+        pressed += count_pressed(view);
+    }
+
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    return static_cast<double>(ns.count()) / frames;
+}
+
+int main()
+{
+    element_data_holder holder, view;
+    virtual_design::holder old_holder, old_view;
+
+    long long pressed = 0, old_pressed = 0;
+    run_frames(holder, view, WARMUP_FRAMES, pressed);
+    run_frames(old_holder, old_view, WARMUP_FRAMES, old_pressed);
+
+    pressed = old_pressed = 0;
+    const auto ns = run_frames(holder, view, BENCH_FRAMES, pressed);
+    const auto old_ns = run_frames(old_holder, old_view, BENCH_FRAMES, old_pressed);
+
+    printf("%d keys, %d events per frame: %.0f ns per frame, %.0f ns with virtual data (%.2fx)\n", LAYOUT_KEYS,
+           EVENTS_PER_FRAME, ns, old_ns, old_ns / ns);
+    CHECK(pressed == old_pressed, "holders disagree on pressed keys: %lld and %lld", pressed, old_pressed);
+    CHECK(pressed > 0, "no key was ever pressed");
+
+    if (failures)
+        fprintf(stderr, "%d checks failed\n", failures);
+    return failures ? 1 : 0;
+}
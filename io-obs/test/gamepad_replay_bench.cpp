@@ -0,0 +1,116 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#include "hook/gamepad_binding.hpp"
+#include "util/element/element_data_holder.hpp"
+#include "util/util.hpp"
+#include <linux/joystick.h>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+/* Replays a js_event stream, as read from /dev/input/jsN, through gamepad_binding's
+ * action tables the way the gamepad hook does and reports the time per event.
+ * The stream is given as the first argument, fixtures/xpad_session.js is half a
+ * minute of an xpad driven pad: initial state, stick movement, trigger pulls,
+ * button taps and hat axes which aren't bound. A new stream can be captured
+ * with "cat /dev/input/js0 > stream.js" */
+
+#define REPLAY_PASSES 200
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                    \
+    do {                                                    \
+        if (!(cond)) {                                      \
+            fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                   \
+            fputc('\n', stderr);                            \
+            failures++;                                     \
+        }                                                   \
+    } while (0)
+
+static bool load_stream(const char* path, std::vector<js_event> &events)
+{
+    const auto file = fopen(path, "rb");
+    if (!file)
+        return false;
+
+    js_event event;
+    while (fread(&event, sizeof(event), 1, file) == 1)
+        events.emplace_back(event);
+    fclose(file);
+    return !events.empty();
+}
+
+static void replay(gamepad::gamepad_binding &bindings, element_data_holder &data, const std::vector<js_event> &events)
+{
+    for (auto event : events) {
+        /* Same as the gamepad hook, which only strips the flag */
+        event.type &= ~JS_EVENT_INIT;
+        bindings.handle_event(0, &data, &event);
+    }
+}
+
+/* With the default bindings raw button numbers are the pad_button_events */
+static void check_final_state(const element_data_holder &data, const std::vector<js_event> &events)
+{
+    bool pressed[gamepad::PAD_BUTTON_EVENT_COUNT] = {};
+    auto seen = 0;
+
+    for (const auto &event : events) {
+        if ((event.type & ~JS_EVENT_INIT) == JS_EVENT_BUTTON && event.number < gamepad::PAD_BUTTON_EVENT_COUNT) {
+            pressed[event.number] = event.value != 0;
+            seen |= 1 << event.number;
+        }
+    }
+
+    for (auto i = 0; i < gamepad::PAD_BUTTON_EVENT_COUNT; i++) {
+        /* Stick buttons are part of the stick data */
+        if (!(seen & 1 << i) || i == gamepad::PAD_L_STICK || i == gamepad::PAD_R_STICK)
+            continue;
+        const auto state = data.get_by_gamepad(0, PAD_TO_VC(i));
+        const auto button = state ? state->button() : nullptr;
+        CHECK(button, "no data for button %i", i);
+        if (button)
+            CHECK((button->get_state() == BS_PRESSED) == pressed[i], "button %i has the wrong state", i);
+    }
+
+    const auto stick = data.get_by_gamepad(0, VC_STICK_DATA);
+    CHECK(stick && stick->analog_stick(), "no stick data");
+    const auto trigger = data.get_by_gamepad(0, VC_TRIGGER_DATA);
+    CHECK(trigger && trigger->trigger(), "no trigger data");
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<js_event> events;
+    if (argc < 2 || !load_stream(argv[1], events)) {
+        fprintf(stderr, "usage: %s <js_event stream>\n", argv[0]);
+        return 1;
+    }
+
+    gamepad::gamepad_binding bindings;
+    element_data_holder data;
+
+    replay(bindings, data, events);
+    check_final_state(data, events);
+
+    const auto presses = data.get_press_count();
+    const auto start = std::chrono::steady_clock::now();
+    for (auto i = 0; i < REPLAY_PASSES; i++)
+        replay(bindings, data, events);
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+    CHECK(data.get_press_count() > presses, "replaying didn't log any presses");
+    printf("%zu events, %i passes: %.1f ns per event\n", events.size(), REPLAY_PASSES,
+           static_cast<double>(ns.count()) / (events.size() * REPLAY_PASSES));
+
+    if (failures)
+        fprintf(stderr, "%d checks failed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,127 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#include "util/element/element_data_holder.hpp"
+#include <uiohook.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+
+/* Feeds a mix of key, mouse, wheel and gamepad events into element_data_holder
+ * the way hook::drain_events() and the gamepad hook do, and counts heap
+ * allocations with a replaced operator new. Once every key was seen once,
+ * events and the copy made for every video frame have to work in place */
+
+#define WARMUP_EVENTS   100000
+#define BENCH_EVENTS    2000000
+#define BENCH_COPIES    20000
+
+static int failures = 0;
+static std::atomic<uint64_t> allocations{0};
+
+#define CHECK(cond, ...)                                    \
+    do {                                                    \
+        if (!(cond)) {                                      \
+            fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                   \
+            fputc('\n', stderr);                            \
+            failures++;                                     \
+        }                                                   \
+    } while (0)
+
+void* operator new(const size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (const auto ptr = malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+static const uint16_t keys[] = {VC_W, VC_A, VC_S, VC_D, VC_SPACE, VC_SHIFT_L, VC_CONTROL_L, VC_E, VC_Q, VC_R,
+                                VC_1, VC_2, VC_3, VC_4, VC_TAB, VC_ESCAPE, VC_ENTER, VC_UP, VC_DOWN, VC_LEFT,
+                                VC_RIGHT, VC_F1, VC_F5, VC_MOUSE_MASK | MOUSE_BUTTON1, VC_MOUSE_MASK | MOUSE_BUTTON2};
+
+/* Mostly mouse movement, like a 1000 Hz mouse with a few key presses in between */
+static void feed(element_data_holder &holder, std::minstd_rand &rng, const int count)
+{
+    int16_t x = 0, y = 0;
+
+    for (auto i = 0; i < count; i++) {
+        const auto pick = rng() % 16;
+        if (pick < 10) {
+            x = static_cast<int16_t>(x + static_cast<int>(rng() % 9) - 4);
+            y = static_cast<int16_t>(y + static_cast<int>(rng() % 9) - 4);
+            holder.set_mouse_pos(x, y);
+        } else if (pick < 13) {
+            holder.set_button(keys[rng() % (sizeof(keys) / sizeof(*keys))], rng() % 2 ? BS_PRESSED : BS_RELEASED);
+        } else if (pick < 14) {
+            holder.add_data(VC_MOUSE_WHEEL, element_data_wheel(rng() % 2 ? DIR_UP : DIR_DOWN));
+        } else if (pick < 15) {
+            holder.set_gamepad_button(rng() % 2, PAD_TO_VC(rng() % 16), rng() % 2 ? BS_PRESSED : BS_RELEASED);
+        } else {
+            const auto axis = static_cast<float>(rng() % 200) / 100.f - 1.f;
+            holder.add_gamepad_data(rng() % 2, VC_STICK_DATA,
+                                    element_data_analog_stick(false, false, axis, -axis, 0.f, axis));
+        }
+    }
+}
+
+static double elapsed_ns(const std::chrono::steady_clock::time_point start)
+{
+    return static_cast<double>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+int main()
+{
+    element_data_holder holder, view;
+    std::minstd_rand rng(2);
+
+    /* Gamepad pages are allocated the first time a pad sends anything */
+    feed(holder, rng, WARMUP_EVENTS);
+    view.copy_from(holder);
+
+    auto before = allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    feed(holder, rng, BENCH_EVENTS);
+    auto ns = elapsed_ns(start);
+    auto count = allocations.load() - before;
+
+    printf("events: %.1f ns each, %llu allocations in %d\n", ns / BENCH_EVENTS, static_cast<unsigned long long>(count),
+           BENCH_EVENTS);
+    CHECK(count == 0, "%llu allocations while handling events", static_cast<unsigned long long>(count));
+
+    before = allocations.load();
+    start = std::chrono::steady_clock::now();
+    for (auto i = 0; i < BENCH_COPIES; i++) {
+        holder.set_mouse_pos(static_cast<int16_t>(i), 0);
+        view.copy_from(holder);
+    }
+    ns = elapsed_ns(start);
+    count = allocations.load() - before;
+
+    printf("frame copies: %.1f ns each, %llu allocations in %d\n", ns / BENCH_COPIES,
+           static_cast<unsigned long long>(count), BENCH_COPIES);
+    CHECK(count == 0, "%llu allocations while copying the state", static_cast<unsigned long long>(count));
+
+    if (failures)
+        fprintf(stderr, "%d checks failed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,295 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#include "util/history/input_queue.hpp"
+#include "util/history/icon_handler.hpp"
+#include "util/history/text_handler.hpp"
+#include "util/element/element_data_holder.hpp"
+#include <cstdio>
+#include <vector>
+
+/* Feeds presses into element_data_holder and checks the entries input_queue builds from
+ * its press log with collect_input(), including the cases in which it has to resync. The
+ * display side of input history isn't part of this, the handlers below only record which
+ * entries were swapped in */
+
+typedef std::vector<uint16_t> keys;
+
+static int failures = 0;
+static std::vector<keys> swapped; /* Inputs of every entry text_handler::swap() got */
+
+#define CHECK(cond, ...)                                    \
+    do {                                                    \
+        if (!(cond)) {                                      \
+            fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                   \
+            fputc('\n', stderr);                            \
+            failures++;                                     \
+        }                                                   \
+    } while (0)
+
+text_handler::text_handler(sources::history_settings* settings) : handler(settings)
+{
+}
+
+text_handler::~text_handler() = default;
+
+void text_handler::update()
+{
+}
+
+void text_handler::tick(const float seconds)
+{
+    UNUSED_PARAMETER(seconds);
+}
+
+void text_handler::swap(input_entry &current)
+{
+    swapped.emplace_back(current.get_inputs());
+}
+
+void text_handler::render(const gs_effect_t* effect)
+{
+    UNUSED_PARAMETER(effect);
+}
+
+void text_handler::clear()
+{
+}
+
+obs_source_t* text_handler::get_text_source() const
+{
+    return nullptr;
+}
+
+icon_handler::icon_handler(sources::history_settings* settings) : handler(settings)
+{
+}
+
+icon_handler::~icon_handler() = default;
+
+void icon_handler::update()
+{
+}
+
+void icon_handler::tick(const float seconds)
+{
+    UNUSED_PARAMETER(seconds);
+}
+
+void icon_handler::swap(input_entry &current)
+{
+    UNUSED_PARAMETER(current);
+}
+
+void icon_handler::render(const gs_effect_t* effect)
+{
+    UNUSED_PARAMETER(effect);
+}
+
+void icon_handler::clear()
+{
+}
+
+history_icons::~history_icons() = default;
+
+void history_icons::draw(const uint16_t vc, vec2* pos, input_entry* parent)
+{
+    UNUSED_PARAMETER(vc);
+    UNUSED_PARAMETER(pos);
+    UNUSED_PARAMETER(parent);
+}
+
+bool key_names::empty() const
+{
+    return true;
+}
+
+const char* key_names::get_name(const uint16_t vc)
+{
+    UNUSED_PARAMETER(vc);
+    return nullptr;
+}
+
+const char* key_to_text(const int key_code)
+{
+    UNUSED_PARAMETER(key_code);
+    return nullptr;
+}
+
+/* A history source in text mode reading from data */
+struct history
+{
+    sources::history_settings settings;
+    input_queue queue;
+
+    explicit history(element_data_holder* data, const uint16_t flags = 0) : queue(&settings)
+    {
+        settings.data = data;
+        settings.flags = flags;
+        queue.update(sources::history_mode::TEXT);
+    }
+
+    /* Collects and returns the inputs of the entry that gets displayed */
+    keys next_entry()
+    {
+        const auto count = swapped.size();
+        queue.collect_input();
+        queue.swap();
+        return swapped.size() > count ? swapped.back() : keys();
+    }
+};
+
+static void press(element_data_holder &data, const uint16_t keycode)
+{
+    data.set_button(keycode, BS_PRESSED);
+}
+
+static void release(element_data_holder &data, const uint16_t keycode)
+{
+    data.set_button(keycode, BS_RELEASED);
+}
+
+static void print_keys(const char* name, const keys &k)
+{
+    fprintf(stderr, "    %s:", name);
+    for (const auto key : k)
+        fprintf(stderr, " 0x%04x", key);
+    fputc('\n', stderr);
+}
+
+#define CHECK_KEYS(actual, ...)                                   \
+    do {                                                          \
+        const keys expected = {__VA_ARGS__};                      \
+        const auto result = (actual);                             \
+        CHECK(result == expected, "entry doesn't match");         \
+        if (result != expected) {                                 \
+            print_keys("expected", expected);                     \
+            print_keys("got", result);                            \
+        }                                                         \
+    } while (0)
+
+/* Modifiers come first in the order Ctrl, Shift, Alt, Meta, the other keys in the order they were pressed */
+static void test_modifier_order()
+{
+    element_data_holder data;
+    history h(&data);
+
+    h.next_entry(); /* First collect resyncs with an empty holder */
+    press(data, VC_B);
+    press(data, VC_META_L);
+    press(data, VC_A);
+    press(data, VC_SHIFT_R);
+    press(data, VC_ALT_L);
+    press(data, VC_CONTROL_L);
+    press(data, VC_1);
+    CHECK_KEYS(h.next_entry(), VC_CONTROL_L, VC_SHIFT_R, VC_ALT_L, VC_META_L, VC_B, VC_A, VC_1);
+}
+
+/* Tapping a key again or holding it across collects doesn't add it twice */
+static void test_dedupe()
+{
+    element_data_holder data;
+    history h(&data);
+
+    h.next_entry();
+    press(data, VC_A);
+    release(data, VC_A);
+    press(data, VC_A);
+    press(data, VC_S);
+    h.queue.collect_input();
+    release(data, VC_A);
+    press(data, VC_A);
+    press(data, VC_S); /* Key repeat */
+    CHECK_KEYS(h.next_entry(), VC_A, VC_S);
+}
+
+/* Keys that are still held when an entry is swapped in start the next one, released ones don't */
+static void test_held_keys()
+{
+    element_data_holder data;
+    history h(&data);
+
+    h.next_entry();
+    press(data, VC_SHIFT_L);
+    press(data, VC_A);
+    release(data, VC_A);
+    CHECK_KEYS(h.next_entry(), VC_SHIFT_L, VC_A);
+
+    press(data, VC_B);
+    release(data, VC_B);
+    CHECK_KEYS(h.next_entry(), VC_SHIFT_L, VC_B);
+
+    release(data, VC_SHIFT_L);
+    CHECK_KEYS(h.next_entry(), VC_SHIFT_L);
+    CHECK(h.next_entry().empty(), "entry without any presses was swapped in");
+}
+
+/* More events than the log holds and a new source make the queue start over with what is pressed */
+static void test_resync()
+{
+    element_data_holder data, other;
+    history h(&data);
+
+    h.next_entry();
+    for (auto i = 0; i < HOLDER_PRESS_LOG; i++) {
+        press(data, VC_Q);
+        release(data, VC_Q);
+    }
+    press(data, VC_Z);
+    press(data, VC_SHIFT_L);
+    CHECK_KEYS(h.next_entry(), VC_SHIFT_L, VC_Z);
+
+    release(data, VC_Z);
+    release(data, VC_SHIFT_L);
+    h.next_entry();
+    CHECK(h.next_entry().empty(), "released keys are still held");
+
+    press(other, VC_X);
+    press(other, VC_CONTROL_R);
+    h.settings.data = &other;
+    CHECK_KEYS(h.next_entry(), VC_CONTROL_R, VC_X);
+
+    /* Back to the first source, keys held on the other one aren't carried over */
+    press(data, VC_W);
+    h.settings.data = &data;
+    CHECK_KEYS(h.next_entry(), VC_W);
+}
+
+/* Mouse buttons and gamepads are only included if the settings say so */
+static void test_filters()
+{
+    const auto mouse = static_cast<uint16_t>(VC_MOUSE_MASK | MOUSE_BUTTON1);
+    element_data_holder data;
+    history keys_only(&data);
+    history with_pad(&data, static_cast<uint16_t>(sources::history_flags::INCLUDE_MOUSE) |
+                                static_cast<uint16_t>(sources::history_flags::INCLUDE_PAD));
+
+    with_pad.settings.target_gamepad = 1;
+    keys_only.next_entry();
+    with_pad.next_entry();
+
+    press(data, VC_E);
+    press(data, mouse);
+    data.set_gamepad_button(0, VC_PAD_A, BS_PRESSED);
+    data.set_gamepad_button(1, VC_PAD_B, BS_PRESSED);
+    CHECK_KEYS(keys_only.next_entry(), VC_E);
+    CHECK_KEYS(with_pad.next_entry(), VC_E, mouse, VC_PAD_B);
+}
+
+int main()
+{
+    test_modifier_order();
+    test_dedupe();
+    test_held_keys();
+    test_resync();
+    test_filters();
+
+    if (failures)
+        fprintf(stderr, "%d checks failed\n", failures);
+    return failures ? 1 : 0;
+}
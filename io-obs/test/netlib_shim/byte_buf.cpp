@@ -0,0 +1,50 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#include <netlib.h>
+#include <cstdlib>
+
+/* The bundled linux build of netlib predates the buffer API, so the tests that
+ * encode messages get these from here. Same layout and behaviour as netlib */
+
+netlib_byte_buf* netlib_alloc_byte_buf(const uint8_t size)
+{
+    const auto buf = static_cast<netlib_byte_buf*>(calloc(1, sizeof(netlib_byte_buf)));
+    if (!buf)
+        return nullptr;
+
+    buf->data = static_cast<uint8_t*>(calloc(size, 1));
+    if (!buf->data) {
+        free(buf);
+        return nullptr;
+    }
+    buf->length = size;
+    return buf;
+}
+
+void netlib_free_byte_buf(netlib_byte_buf* buf)
+{
+    if (buf)
+        free(buf->data);
+    free(buf);
+}
+
+int netlib_write_uint8(netlib_byte_buf* buf, const uint8_t val)
+{
+    if (!buf || buf->write_pos >= buf->length)
+        return 0;
+    buf->data[buf->write_pos++] = val;
+    return 1;
+}
+
+int netlib_read_uint8(netlib_byte_buf* buf, uint8_t* val)
+{
+    if (!buf || buf->read_pos >= buf->write_pos)
+        return 0;
+    *val = buf->data[buf->read_pos++];
+    return 1;
+}
@@ -0,0 +1,12 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include "vec2.h"
+
+typedef struct gs_image_file gs_image_file_t;
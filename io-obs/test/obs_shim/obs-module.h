@@ -0,0 +1,43 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+/* The standalone tests don't link against obs, this is the
+ * part of its api the plugin code they use needs, see obs_shim.cpp */
+
+#include <stdint.h>
+
+#define UNUSED_PARAMETER(param) (void) param
+
+#define LOG_ERROR   100
+#define LOG_WARNING 200
+#define LOG_INFO    300
+#define LOG_DEBUG   400
+
+extern "C" {
+typedef struct obs_source obs_source_t;
+typedef struct obs_data obs_data_t;
+typedef struct obs_properties obs_properties_t;
+typedef struct obs_property obs_property_t;
+typedef struct gs_effect gs_effect_t;
+
+void blog(int log_level, const char* format, ...);
+
+const char* obs_module_text(const char* lookup_string);
+
+/* Sources and their settings don't exist in the tests, these do nothing */
+uint32_t obs_source_get_width(obs_source_t* source);
+
+uint32_t obs_source_get_height(obs_source_t* source);
+
+void obs_source_update(obs_source_t* source, obs_data_t* settings);
+
+void obs_source_video_render(obs_source_t* source);
+
+void obs_data_set_string(obs_data_t* data, const char* name, const char* val);
+}
@@ -0,0 +1,66 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#include <obs-module.h>
+#include <util/platform.h>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+
+/* Only warnings and errors are printed, so test output stays readable */
+void blog(const int log_level, const char* format, ...)
+{
+    if (log_level > LOG_WARNING)
+        return;
+
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+const char* obs_module_text(const char* lookup_string)
+{
+    return lookup_string;
+}
+
+uint64_t os_gettime_ns(void)
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint32_t obs_source_get_width(obs_source_t* source)
+{
+    UNUSED_PARAMETER(source);
+    return 0;
+}
+
+uint32_t obs_source_get_height(obs_source_t* source)
+{
+    UNUSED_PARAMETER(source);
+    return 0;
+}
+
+void obs_source_update(obs_source_t* source, obs_data_t* settings)
+{
+    UNUSED_PARAMETER(source);
+    UNUSED_PARAMETER(settings);
+}
+
+void obs_source_video_render(obs_source_t* source)
+{
+    UNUSED_PARAMETER(source);
+}
+
+void obs_data_set_string(obs_data_t* data, const char* name, const char* val)
+{
+    UNUSED_PARAMETER(data);
+    UNUSED_PARAMETER(name);
+    UNUSED_PARAMETER(val);
+}
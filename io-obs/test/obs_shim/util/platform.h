@@ -0,0 +1,14 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+extern "C" {
+uint64_t os_gettime_ns(void);
+}
@@ -0,0 +1,259 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#include "wire_format.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* Sends MSG_SNAPSHOT packets over udp on the loopback interface, reordered, repeated,
+ * partly dropped and with packets of other clients in between. The receiving side
+ * does what io_server::receive_snapshots() and io_client::read_snapshot() do, so in
+ * the end it has to hold the newest snapshot which arrived and may never go back
+ * to an older one. Plain sockets are used, so the test decides which packets are lost */
+
+#define TOKEN           0x2f41
+#define FOREIGN_TOKEN   0x2f42
+#define SNAPSHOTS       300
+#define IDLE_TIMEOUT    50 /* ms without packets after which everything sent has arrived */
+
+typedef std::vector<uint8_t> bytes;
+
+static int failures = 0;
+static std::mt19937 rng(15);
+
+#define CHECK(cond, ...)                                    \
+    do {                                                    \
+        if (!(cond)) {                                      \
+            fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                   \
+            fputc('\n', stderr);                            \
+            failures++;                                     \
+        }                                                   \
+    } while (0)
+
+static void put_varint(bytes &out, uint32_t val)
+{
+    while (val >= 0x80) {
+        out.push_back(static_cast<uint8_t>(val | 0x80));
+        val >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(val));
+}
+
+/* The pressed key and mouse position tell which snapshot the state came from */
+static uint16_t key_of(const uint32_t sequence)
+{
+    return static_cast<uint16_t>(1 + sequence % 200);
+}
+
+static bytes make_snapshot(const uint32_t token, const uint32_t sequence)
+{
+    bytes out;
+    out.push_back(MSG_SNAPSHOT);
+    put_varint(out, token);
+    put_varint(out, sequence);
+    put_varint(out, sequence * 10); /* Timestamp */
+    put_varint(out, 1);
+    put_varint(out, key_of(sequence));
+    put_varint(out, wire::zigzag(static_cast<int16_t>(sequence)));
+    put_varint(out, wire::zigzag(-static_cast<int16_t>(sequence)));
+    out.push_back(1); /* No wheel movement */
+    put_varint(out, 1); /* First pad */
+    put_varint(out, sequence & 0xffff);
+    for (auto i = 0; i < 4; i++)
+        put_varint(out, wire::zigzag(i * 1000));
+    out.push_back(0);
+    out.push_back(255);
+    return out;
+}
+
+struct loopback
+{
+    int server = -1, sender = -1;
+    sockaddr_in address = {};
+    int loss = 0; /* Percentage of packets which are dropped instead of sent */
+
+    bool open()
+    {
+        socklen_t length = sizeof(address);
+
+        server = socket(AF_INET, SOCK_DGRAM, 0);
+        sender = socket(AF_INET, SOCK_DGRAM, 0);
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+        return server >= 0 && sender >= 0 &&
+               bind(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0 &&
+               getsockname(server, reinterpret_cast<sockaddr*>(&address), &length) == 0;
+    }
+
+    void close()
+    {
+        if (sender >= 0)
+            ::close(sender);
+        if (server >= 0)
+            ::close(server);
+    }
+
+    void send(const bytes &data)
+    {
+        if (loss && static_cast<int>(rng() % 100) < loss)
+            return;
+        sendto(sender, data.data(), data.size(), 0, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+    }
+};
+
+/* What the server knows about the client */
+struct receiver
+{
+    wire::snapshot_order order;
+    wire::snapshot state = {};
+    std::vector<uint32_t> accepted;
+    uint32_t newest_received = 0; /* Of the client's packets, for the checks */
+    bool any_received = false;
+    int received = 0, foreign = 0, invalid = 0;
+
+    void handle(const uint8_t* data, const size_t length)
+    {
+        auto view = wire::make_reader(data, std::min(length, static_cast<size_t>(UDP_PACKET_SIZE)));
+        wire::snapshot snapshot;
+        uint32_t token = 0;
+
+        if (!wire::read_snapshot_token(&view, &token)) {
+            invalid++;
+            return;
+        }
+        if (token != TOKEN) {
+            foreign++;
+            return;
+        }
+
+        CHECK(wire::read_snapshot(&view, &snapshot), "valid snapshot couldn't be read");
+        received++;
+        if (!any_received || static_cast<int32_t>(snapshot.sequence - newest_received) > 0)
+            newest_received = snapshot.sequence;
+        any_received = true;
+
+        if (wire::accept_snapshot(&order, snapshot.sequence)) {
+            accepted.emplace_back(snapshot.sequence);
+            state = snapshot;
+        }
+    }
+
+    /* Receives until nothing arrived for IDLE_TIMEOUT ms */
+    void drain(const loopback &net)
+    {
+        uint8_t data[UDP_PACKET_SIZE];
+        pollfd fd = {net.server, POLLIN, 0};
+
+        while (poll(&fd, 1, IDLE_TIMEOUT) > 0) {
+            const auto length = recv(net.server, data, sizeof(data), 0);
+            if (length >= 0)
+                handle(data, static_cast<size_t>(length));
+        }
+    }
+
+    void check_newest(const char* name) const
+    {
+        CHECK(any_received, "%s: nothing arrived", name);
+        CHECK(state.sequence == newest_received, "%s: state is from snapshot %u, newest one was %u", name,
+              state.sequence, newest_received);
+        CHECK(state.key_count == 1 && state.keys[0] == key_of(state.sequence) &&
+              state.mouse_x == static_cast<int16_t>(state.sequence), "%s: state doesn't match its sequence", name);
+
+        for (size_t i = 1; i < accepted.size(); i++) {
+            CHECK(static_cast<int32_t>(accepted[i] - accepted[i - 1]) > 0, "%s: went back from %u to %u", name,
+                  accepted[i - 1], accepted[i]);
+        }
+    }
+};
+
+/* Snapshots of a client which are shuffled, partly repeated and mixed with other clients' ones */
+static void test_reordered(loopback &net, const uint32_t first, const char* name)
+{
+    receiver client;
+    std::vector<bytes> packets;
+
+    for (uint32_t i = 0; i < SNAPSHOTS; i++) {
+        packets.emplace_back(make_snapshot(TOKEN, first + i));
+        if (i % 10 == 0) /* Repeated after SNAPSHOT_INTERVAL */
+            packets.emplace_back(make_snapshot(TOKEN, first + i));
+        if (i % 7 == 0) /* Another client, which is further ahead */
+            packets.emplace_back(make_snapshot(FOREIGN_TOKEN, first + SNAPSHOTS + i));
+    }
+    packets.push_back({MSG_SNAPSHOT, 0}); /* Token 0 is never used */
+    packets.push_back({MSG_PING_CLIENT});
+    std::shuffle(packets.begin(), packets.end(), rng);
+
+    for (const auto &packet : packets)
+        net.send(packet);
+    client.drain(net);
+
+    client.check_newest(name);
+    CHECK(client.foreign > 0, "%s: packets of other clients didn't arrive", name);
+    CHECK(client.invalid == 2, "%s: expected 2 packets which aren't snapshots, got %i", name, client.invalid);
+    CHECK(client.accepted.size() < static_cast<size_t>(client.received), "%s: nothing was rejected", name);
+
+    /* Late and repeated packets after the newest one */
+    const auto newest = client.state.sequence;
+    const auto accepted = client.accepted.size();
+    net.send(make_snapshot(TOKEN, newest - 1));
+    net.send(make_snapshot(TOKEN, newest));
+    net.send(make_snapshot(TOKEN, newest - SNAPSHOTS / 2));
+    client.drain(net);
+    CHECK(client.accepted.size() == accepted && client.state.sequence == newest, "%s: stale snapshot was accepted",
+          name);
+
+    net.send(make_snapshot(TOKEN, newest + 1));
+    client.drain(net);
+    CHECK(client.state.sequence == newest + 1, "%s: newer snapshot wasn't accepted", name);
+}
+
+/* Lost packets, in order otherwise */
+static void test_lossy(loopback &net)
+{
+    receiver client;
+
+    net.loss = 40;
+    for (uint32_t i = 1; i <= SNAPSHOTS; i++) {
+        net.send(make_snapshot(TOKEN, i));
+        if (i % 3 == 0)
+            net.send(make_snapshot(TOKEN, i - 2));
+    }
+    net.loss = 0;
+    client.drain(net);
+
+    client.check_newest("lossy");
+    CHECK(client.received < SNAPSHOTS + SNAPSHOTS / 3, "no packet was dropped");
+}
+
+int main()
+{
+    loopback net;
+
+    if (!net.open()) {
+        perror("Couldn't open udp sockets on the loopback interface");
+        net.close();
+        return 1;
+    }
+
+    test_reordered(net, 1, "reordered");
+    test_reordered(net, 0xffffffffu - SNAPSHOTS / 2, "wrapping around");
+    test_lossy(net);
+    net.close();
+
+    if (failures)
+        fprintf(stderr, "%d checks failed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,166 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#include "spsc_ring.hpp"
+#include "press_queue.hpp"
+#include <atomic>
+#include <bitset>
+#include <cstdio>
+#include <random>
+#include <thread>
+
+/* Drives millions of items from one thread to another through a small ring,
+ * so it overflows regularly, and checks that nothing is lost, duplicated or
+ * reordered apart from what was counted as overflow */
+
+#define STRESS_ITEMS    5000000
+#define RING_SIZE       1024
+#define KEY_COUNT       64
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                    \
+    do {                                                    \
+        if (!(cond)) {                                      \
+            fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                   \
+            fputc('\n', stderr);                            \
+            failures++;                                     \
+        }                                                   \
+    } while (0)
+
+/* Keeps the consumer slower than the producer now and then */
+static void stall(std::minstd_rand &rng)
+{
+    if (rng() % 4096 == 0)
+        std::this_thread::yield();
+}
+
+static void test_order()
+{
+    static spsc_ring<uint64_t, RING_SIZE> ring;
+    std::atomic<bool> done{false};
+    uint64_t pushed = 0, popped = 0, last = 0, out_of_order = 0;
+
+    std::thread producer([&]
+    {
+        for (uint64_t i = 1; i <= STRESS_ITEMS; i++) {
+            if (ring.push(i))
+                pushed++;
+            if (i % RING_SIZE == 0) /* Gives the consumer a chance to keep up */
+                std::this_thread::yield();
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    std::minstd_rand rng(1);
+    uint64_t item = 0;
+    for (;;) {
+        const auto finished = done.load(std::memory_order_acquire);
+        while (ring.pop(item)) {
+            if (item <= last)
+                out_of_order++;
+            last = item;
+            popped++;
+            stall(rng);
+        }
+        if (finished)
+            break;
+    }
+    producer.join();
+
+    CHECK(!out_of_order, "%llu items arrived out of order", (unsigned long long) out_of_order);
+    CHECK(popped == pushed, "pushed %llu items, but popped %llu", (unsigned long long) pushed,
+          (unsigned long long) popped);
+    CHECK(pushed + ring.overflow() == STRESS_ITEMS, "%llu items pushed and %llu dropped out of %d",
+          (unsigned long long) pushed, (unsigned long long) ring.overflow(), STRESS_ITEMS);
+    printf("order: %llu items passed, %llu dropped\n", (unsigned long long) popped,
+           (unsigned long long) ring.overflow());
+}
+
+static void test_reserve()
+{
+    spsc_ring<int, 8> ring;
+    int item = 0;
+
+    /* Two slots have to stay free after each push */
+    for (auto i = 0; i < 6; i++)
+        CHECK(ring.push(i, 2), "push %d with two reserved slots failed", i);
+    CHECK(!ring.push(6, 2), "push into the reserved slots succeeded");
+    CHECK(ring.overflow() == 1, "overflow is %llu instead of 1", (unsigned long long) ring.overflow());
+    CHECK(ring.push(6, 1) && ring.push(7), "push into the reserved slots with a smaller reserve failed");
+    CHECK(!ring.push(8), "ring holds more than its capacity");
+
+    for (auto i = 0; i < 8; i++)
+        CHECK(ring.pop(item) && item == i, "popped %d instead of %d", item, i);
+    CHECK(!ring.pop(item), "popped from an empty ring");
+}
+
+/* Goes through the same press_queue as hook::process_event(), a release is
+ * never dropped if its press was queued, so no key stays pressed on the other side */
+struct key_event
+{
+    uint16_t key;
+    bool pressed;
+};
+
+static void test_releases()
+{
+    static spsc_ring<key_event, RING_SIZE> ring;
+    std::atomic<bool> done{false};
+    std::bitset<KEY_COUNT> held, applied;
+    uint64_t lost_releases = 0;
+
+    std::thread producer([&]
+    {
+        press_queue<KEY_COUNT> queue;
+        std::bitset<KEY_COUNT> queued;
+        std::minstd_rand rng(2);
+
+        for (auto i = 0; i < STRESS_ITEMS; i++) {
+            const key_event e = {static_cast<uint16_t>(rng() % KEY_COUNT), rng() % 2 == 0};
+            held.set(e.key, e.pressed);
+
+            const auto pushed = queue.push(ring, e, e.key, e.pressed ? PC_PRESS : PC_RELEASE);
+            if (!e.pressed && queued.test(e.key) && !pushed)
+                lost_releases++;
+            if (pushed)
+                queued.set(e.key, e.pressed);
+            else if (!e.pressed)
+                queued.reset(e.key);
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    std::minstd_rand rng(3);
+    key_event e{};
+    for (;;) {
+        const auto finished = done.load(std::memory_order_acquire);
+        while (ring.pop(e)) {
+            applied.set(e.key, e.pressed);
+            stall(rng);
+        }
+        if (finished)
+            break;
+    }
+    producer.join();
+
+    CHECK(!lost_releases, "%llu releases were dropped", (unsigned long long) lost_releases);
+    CHECK((applied & ~held).none(), "%zu released keys are still pressed", (applied & ~held).count());
+    printf("releases: %llu events dropped, no key stuck\n", (unsigned long long) ring.overflow());
+}
+
+int main()
+{
+    test_reserve();
+    test_order();
+    test_releases();
+
+    if (failures)
+        fprintf(stderr, "%d checks failed\n", failures);
+    return failures ? 1 : 0;
+}
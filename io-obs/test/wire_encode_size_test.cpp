@@ -0,0 +1,412 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#include "network/wire_format.hpp"
+#include "util/util.hpp"
+#include <uiohook.h>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <vector>
+
+/* Encodes a keyboard burst, a gamepad burst and the path of a 1000 Hz mouse with the
+ * MSG_INPUT_DELTA writers io-client uses, one message per flush, and compares the size to
+ * what version 1 sent for the same flushes: MSG_BUTTON_DATA with every pressed key
+ * (2 + 2 * keys bytes), MSG_GAMEPAD_DATA for every changed pad (22 bytes) and MSG_MOUSE_DATA
+ * with only the last position (9 bytes). Every message is decoded again and has to result in
+ * the state that was encoded. The sequence number and timestamp version 1 didn't have take
+ * five to six bytes per message, so a flush with a single key change can be bigger than
+ * before. The events alone always have to be smaller */
+
+#define START_TIME      60000 /* ms since the client connected, the timestamp takes three bytes */
+#define FLUSH_INTERVAL  8
+#define PAD_ID          1
+#define V1_PAD_MESSAGE  22
+#define V1_MOUSE_MESSAGE 9
+#define MOUSE_DURATION  2000 /* ms of movement, one position per ms */
+#define PATH_SAMPLE_MAX 5 /* Bytes per DE_MOUSE_PATH sample: time and two 16 bit changes in movement */
+
+typedef std::map<uint16_t, bool> key_map;
+
+struct key_change
+{
+    uint16_t keycode;
+    bool pressed;
+};
+
+/* Flushes of one burst and the bytes they took */
+struct burst
+{
+    const char* name;
+    int messages = 0;
+    size_t headers = 0, events = 0, v1 = 0;
+};
+
+static int failures = 0;
+static netlib_byte_buf* buffer = nullptr;
+static uint32_t sequence = 0;
+
+#define CHECK(cond, ...)                                    \
+    do {                                                    \
+        if (!(cond)) {                                      \
+            fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                   \
+            fputc('\n', stderr);                            \
+            failures++;                                     \
+        }                                                   \
+    } while (0)
+
+static void reset_buffer()
+{
+    buffer->write_pos = 0;
+    buffer->read_pos = 0;
+}
+
+/* The part of MSG_INPUT_DELTA in front of the events, see write_input_delta() in io-client */
+static size_t header_size()
+{
+    return 1 + wire::varint_size(sequence) + wire::varint_size(START_TIME + sequence * FLUSH_INTERVAL) + 1;
+}
+
+static void add_message(burst &b, const size_t v1)
+{
+    b.messages++;
+    b.headers += header_size();
+    b.events += buffer->write_pos;
+    b.v1 += v1;
+    sequence++;
+}
+
+static void print_burst(const burst &b)
+{
+    printf("%s: %i messages, %zu bytes of events + %zu bytes of headers, version 1: %zu bytes (%.1fx of the "
+           "events, %.1fx of the messages)\n",
+           b.name, b.messages, b.events, b.headers, b.v1, static_cast<double>(b.v1) / b.events,
+           static_cast<double>(b.v1) / (b.events + b.headers));
+}
+
+/* Reads the key events back and applies them to the state the server had */
+static void check_key_events(const key_map &keys, key_map sent, const uint8_t count, const char* name)
+{
+    for (auto i = 0; i < count; i++) {
+        wire::delta_event type;
+        uint32_t payload = 0;
+        const auto start = buffer->read_pos;
+
+        if (!wire::read_event(buffer, &type, &payload)) {
+            CHECK(false, "%s: event %i couldn't be read", name, i);
+            return;
+        }
+
+        const auto size = buffer->read_pos - start;
+        CHECK(size <= (payload < 0x100 ? 2 : 3), "%s: event for key 0x%x takes %i bytes", name, payload, size);
+        CHECK(type == wire::DE_KEY_DOWN || type == wire::DE_KEY_UP, "%s: unexpected event %i", name, type);
+        if (type == wire::DE_KEY_DOWN)
+            sent[static_cast<uint16_t>(payload)] = true;
+        else
+            sent.erase(static_cast<uint16_t>(payload));
+    }
+    CHECK(buffer->read_pos == buffer->write_pos, "%s: data left after the events", name);
+    CHECK(sent == keys, "%s: decoded keys don't match", name);
+}
+
+/* Every step is one flush, all changes in it happened since the flush before */
+static void run_key_burst(burst &b, const std::vector<std::vector<key_change>> &steps)
+{
+    key_map keys, sent;
+
+    for (const auto &step : steps) {
+        for (const auto &change : step) {
+            if (change.pressed)
+                keys[change.keycode] = true;
+            else
+                keys.erase(change.keycode);
+        }
+
+        uint8_t count = 0;
+        reset_buffer();
+        CHECK(wire::write_key_delta(buffer, keys, sent, count), "%s: writing failed", b.name);
+        CHECK(count == step.size(), "%s: %i events for %zu changes", b.name, count, step.size());
+        check_key_events(keys, sent, count, b.name);
+
+        add_message(b, 2 + 2 * keys.size());
+        sent = keys;
+    }
+}
+
+static std::vector<key_change> tap(const uint16_t keycode, const bool pressed)
+{
+    return {{keycode, pressed}};
+}
+
+static void test_unchanged()
+{
+    key_map keys = {{VC_W, true}, {VC_SHIFT_L, true}};
+    wire::pad_values pad = {0x1000, {100, -100, 0, 0}, {0, 255}};
+    uint8_t count = 0;
+
+    reset_buffer();
+    CHECK(wire::write_key_delta(buffer, keys, keys, count) && wire::write_pad_delta(buffer, PAD_ID, pad, pad, count),
+          "writing nothing failed");
+    CHECK(count == 0 && buffer->write_pos == 0, "unchanged state wrote %i events, %i bytes", count,
+          buffer->write_pos);
+}
+
+static void test_keyboard_burst()
+{
+    static const uint16_t word[] = {VC_E, VC_L, VC_L, VC_O, VC_SPACE, VC_W, VC_O, VC_R, VC_L, VC_D, VC_ENTER};
+    std::vector<std::vector<key_change>> steps = {tap(VC_SHIFT_L, true), tap(VC_H, true), tap(VC_H, false),
+                                                  tap(VC_SHIFT_L, false)};
+    burst typing, game;
+
+    /* Typing "Hello world", one change per flush since nobody types faster than that */
+    for (const auto key : word) {
+        steps.emplace_back(tap(key, true));
+        steps.emplace_back(tap(key, false));
+    }
+    typing.name = "typing";
+    run_key_burst(typing, steps);
+
+    /* Running and shooting, keys are held while others are tapped */
+    const auto mouse1 = static_cast<uint16_t>(VC_MOUSE_MASK | MOUSE_BUTTON1);
+    game.name = "game";
+    run_key_burst(game, {tap(VC_W, true),
+                         tap(VC_SHIFT_L, true),
+                         tap(mouse1, true),
+                         tap(VC_A, true),
+                         tap(mouse1, false),
+                         tap(VC_A, false),
+                         {{VC_SPACE, true}, {VC_D, true}},
+                         tap(VC_SPACE, false),
+                         tap(mouse1, true),
+                         tap(VC_R, true),
+                         {{mouse1, false}, {VC_R, false}},
+                         tap(VC_D, false),
+                         tap(VC_SHIFT_L, false),
+                         tap(VC_W, false),
+                         {{VC_CONTROL_L, true}, {VC_SHIFT_L, true}, {VC_ESCAPE, true}},
+                         {{VC_CONTROL_L, false}, {VC_SHIFT_L, false}, {VC_ESCAPE, false}}});
+
+    print_burst(typing);
+    print_burst(game);
+    CHECK(typing.events < typing.v1, "typing takes more bytes than version 1");
+    CHECK(game.events * 2 < game.v1, "game keys take more than half of version 1");
+}
+
+/* Axes as io-client sends them after apply_deadzones() rounded them to STICK_STEPS */
+static int16_t axis(const float val)
+{
+    return wire::quantize_axis(std::round(val * 128) / 128);
+}
+
+static void check_pad_events(const wire::pad_values &values, wire::pad_values sent, const uint8_t count)
+{
+    for (auto i = 0; i < count; i++) {
+        wire::delta_event type;
+        uint32_t payload = 0, val = 0;
+        uint8_t triggers[2] = {};
+
+        if (!wire::read_event(buffer, &type, &payload)) {
+            CHECK(false, "pad event %i couldn't be read", i);
+            return;
+        }
+        CHECK(payload == PAD_ID, "event is for pad %u", payload);
+
+        if (type == wire::DE_PAD_BUTTONS) {
+            CHECK(wire::read_varint(buffer, &val), "button word couldn't be read");
+            sent.buttons = static_cast<uint16_t>(val);
+        } else if (type == wire::DE_PAD_STICKS) {
+            for (auto &a : sent.axes) {
+                CHECK(wire::read_varint(buffer, &val), "axis couldn't be read");
+                a = static_cast<int16_t>(wire::unzigzag(val));
+            }
+        } else if (type == wire::DE_PAD_TRIGGERS) {
+            CHECK(netlib_read_uint8(buffer, &triggers[0]) && netlib_read_uint8(buffer, &triggers[1]),
+                  "triggers couldn't be read");
+            sent.triggers[0] = triggers[0];
+            sent.triggers[1] = triggers[1];
+        } else {
+            CHECK(false, "unexpected event %i", type);
+        }
+    }
+    CHECK(buffer->read_pos == buffer->write_pos, "data left after the pad events");
+    CHECK(memcmp(&values, &sent, sizeof(values)) == 0, "decoded pad doesn't match");
+}
+
+static void test_pad_burst()
+{
+    std::vector<wire::pad_values> steps;
+    wire::pad_values values = {};
+    burst pad;
+
+    /* Left stick pushed to the right and back, with a bit of up and down */
+    for (auto i = 1; i <= 10; i++) {
+        values.axes[0] = axis(i / 10.f);
+        values.axes[1] = axis(i % 3 * 0.05f);
+        steps.emplace_back(values);
+    }
+    values.axes[0] = values.axes[1] = 0;
+    steps.emplace_back(values);
+
+    /* A, B and the shoulder button tapped, Y held while the trigger is pulled */
+    for (const uint16_t button : {0x1000, 0x2000, 0x0100}) {
+        values.buttons = button;
+        steps.emplace_back(values);
+        values.buttons = 0;
+        steps.emplace_back(values);
+    }
+    values.buttons = 0x8000;
+    for (auto i = 1; i <= 5; i++) {
+        values.triggers[1] = static_cast<uint8_t>(i * 51);
+        steps.emplace_back(values);
+    }
+    values.buttons = 0;
+    values.triggers[1] = 0;
+    steps.emplace_back(values);
+
+    /* Right stick flicked while aiming */
+    values.axes[2] = axis(-0.7f);
+    values.axes[3] = axis(0.3f);
+    steps.emplace_back(values);
+    values.axes[2] = values.axes[3] = 0;
+    steps.emplace_back(values);
+
+    wire::pad_values sent = {};
+    pad.name = "gamepad";
+    for (const auto &step : steps) {
+        uint8_t count = 0;
+        reset_buffer();
+        CHECK(wire::write_pad_delta(buffer, PAD_ID, step, sent, count), "writing pad failed");
+        CHECK(count > 0, "changed pad wrote nothing");
+        CHECK(buffer->write_pos <= 1 + 4 * 3, "pad events take %i bytes", buffer->write_pos);
+        check_pad_events(step, sent, count);
+        add_message(pad, V1_PAD_MESSAGE);
+        sent = step;
+    }
+
+    print_burst(pad);
+    CHECK(pad.events * 3 < pad.v1, "pad events take more than a third of version 1");
+    CHECK(pad.events + pad.headers < pad.v1, "pad messages take more bytes than version 1");
+}
+
+/* Moves in overlapping arcs like a hand does, with the odd pixel of sensor noise */
+static wire::path_sample mouse_at(const uint32_t time)
+{
+    const auto t = static_cast<double>(time);
+    const auto noise = time % 7 == 0 ? 1 : 0;
+    return {time, static_cast<int16_t>(std::lround(600 * std::sin(t / 350) + 150 * std::sin(t / 90)) + noise),
+            static_cast<int16_t>(std::lround(300 * std::sin(t / 200)) - noise)};
+}
+
+/* Reads DE_MOUSE_PATH back like io_client::read_mouse_path() */
+static void check_mouse_path(const wire::path_sample* path, const uint8_t size, int16_t &x, int16_t &y,
+                             uint32_t &time)
+{
+    wire::delta_event type;
+    uint32_t payload = 0, dt = 0, dd_x = 0, dd_y = 0;
+    int32_t v_x = 0, v_y = 0;
+
+    if (!wire::read_event(buffer, &type, &payload) || type != wire::DE_MOUSE_PATH || payload != size) {
+        CHECK(false, "no DE_MOUSE_PATH with %i samples", size);
+        return;
+    }
+
+    for (auto i = 0; i < size; i++) {
+        if (!wire::read_varint(buffer, &dt) || !wire::read_varint(buffer, &dd_x) || !wire::read_varint(buffer, &dd_y)) {
+            CHECK(false, "sample %i couldn't be read", i);
+            return;
+        }
+        v_x += wire::unzigzag(dd_x);
+        v_y += wire::unzigzag(dd_y);
+        x = static_cast<int16_t>(x + v_x);
+        y = static_cast<int16_t>(y + v_y);
+        time += dt;
+        CHECK(time == path[i].time && x == path[i].x && y == path[i].y,
+              "sample %i decoded as %i, %i at %u instead of %i, %i at %u", i, x, y, time, path[i].x, path[i].y,
+              path[i].time);
+    }
+    CHECK(buffer->read_pos == buffer->write_pos, "data left after the mouse path");
+}
+
+/* Returns the bytes per second of DE_MOUSE_PATH messages when the client flushes every interval ms */
+static double run_mouse_path(const uint32_t interval)
+{
+    wire::path_sample path[MOUSE_PATH_MAX];
+    uint8_t size = 0;
+    int16_t sent_x = 0, sent_y = 0, server_x = 0, server_y = 0;
+    uint32_t sent_time = 0, server_time = 0;
+    size_t samples = 0;
+    burst mouse;
+    char name[32];
+
+    snprintf(name, sizeof(name), "mouse every %u ms", interval);
+    mouse.name = name;
+    for (uint32_t time = 1; time <= MOUSE_DURATION; time++) {
+        wire::add_path_sample(path, size, mouse_at(time));
+        if (time % interval)
+            continue;
+
+        reset_buffer();
+        CHECK(wire::write_mouse_path(buffer, path, size, sent_x, sent_y, sent_time), "%s: writing failed", name);
+        CHECK(buffer->write_pos <= 2 + size * PATH_SAMPLE_MAX, "%s: %i samples take %i bytes", name, size,
+              buffer->write_pos);
+        check_mouse_path(path, size, server_x, server_y, server_time);
+        CHECK(server_x == path[size - 1].x && server_y == path[size - 1].y && server_time == time,
+              "%s: server didn't end up at the newest position", name);
+
+        add_message(mouse, V1_MOUSE_MESSAGE);
+        samples += size;
+        sent_x = path[size - 1].x;
+        sent_y = path[size - 1].y;
+        size = 0;
+    }
+
+    /* Without the one byte event header of every message */
+    const auto sample_bytes = mouse.events - mouse.messages;
+    const auto per_second = (mouse.events + mouse.headers) * 1000.0 / MOUSE_DURATION;
+    print_burst(mouse);
+    printf("    %.0f bytes/s, %zu of %u positions at %.2f bytes each\n", per_second, samples, MOUSE_DURATION,
+           static_cast<double>(sample_bytes) / samples);
+
+    /* Three bytes is one byte for the time and each change in movement */
+    CHECK(sample_bytes * 2 <= samples * 7, "%s: %zu bytes for %zu samples, delta of delta doesn't keep them small",
+          name, sample_bytes, samples);
+    return per_second;
+}
+
+/* However often the client flushes, a message never holds more than MOUSE_PATH_MAX positions,
+ * so the bandwidth follows the flush rate and not the polling rate of the mouse */
+static void test_mouse_path()
+{
+    static const uint32_t intervals[] = {1, 4, 8, 16, 33, 100};
+    const auto bound = 1000.0 * (1 + 3 + 3 + 1 + 2 + MOUSE_PATH_MAX * PATH_SAMPLE_MAX);
+
+    for (const auto interval : intervals) {
+        const auto per_second = run_mouse_path(interval);
+        CHECK(per_second <= bound / interval, "%u ms: %.0f bytes/s is above %.0f", interval, per_second,
+              bound / interval);
+    }
+}
+
+int main()
+{
+    buffer = netlib_alloc_byte_buf(UDP_PACKET_SIZE);
+    if (!buffer) {
+        fprintf(stderr, "Couldn't allocate a buffer\n");
+        return 1;
+    }
+
+    test_unchanged();
+    test_keyboard_burst();
+    test_pad_burst();
+    test_mouse_path();
+    netlib_free_byte_buf(buffer);
+
+    if (failures)
+        fprintf(stderr, "%d checks failed\n", failures);
+    return failures ? 1 : 0;
+}
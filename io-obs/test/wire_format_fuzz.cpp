@@ -0,0 +1,324 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#include "receive_buffer.hpp"
+#include "wire_format.hpp"
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+/* Feeds random message streams through receive_buffer, message_length() and
+ * for_each_message() the same way io_client::receive() does, split at random
+ * points. Valid streams have to come out exactly as they went in, corrupted
+ * ones may be rejected at any point, but no message may be handled twice or
+ * read past the data that was received. Build with sanitizers to catch the latter */
+
+#define VALID_STREAMS       500
+#define CORRUPT_STREAMS     2000
+#define MAX_MESSAGES        100
+#define MAX_CHUNK           300
+
+typedef std::vector<uint8_t> bytes;
+
+static int failures = 0;
+static std::mt19937 rng(14);
+
+#define CHECK(cond, ...)                                    \
+    do {                                                    \
+        if (!(cond)) {                                      \
+            fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                   \
+            fputc('\n', stderr);                            \
+            failures++;                                     \
+        }                                                   \
+    } while (0)
+
+static uint32_t random(const uint32_t max)
+{
+    return std::uniform_int_distribution<uint32_t>(0, max)(rng);
+}
+
+static void put_varint(bytes &out, uint32_t val)
+{
+    while (val >= 0x80) {
+        out.push_back(static_cast<uint8_t>(val | 0x80));
+        val >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(val));
+}
+
+/* Small values most of the time, so all varint sizes show up */
+static uint32_t random_value()
+{
+    static const uint32_t limits[] = {0x7f, 0x3fff, 0x1fffff, 0xffffffff};
+    return random(limits[random(3)]);
+}
+
+static void put_random(bytes &out, size_t count)
+{
+    for (; count > 0; count--)
+        out.push_back(static_cast<uint8_t>(random(0xff)));
+}
+
+static void put_delta_event(bytes &out)
+{
+    const auto type = static_cast<wire::delta_event>(random(wire::DE_LAST - 1));
+    auto payload = random(0xffff);
+    auto varints = 0;
+
+    switch (type) {
+        case wire::DE_MOUSE_POS:
+            varints = 2;
+            break;
+        case wire::DE_PAD_BUTTONS:
+            varints = 1;
+            break;
+        case wire::DE_PAD_STICKS:
+            varints = 4;
+            break;
+        case wire::DE_MOUSE_PATH:
+            payload = random(MOUSE_PATH_MAX);
+            varints = 3 * static_cast<int>(payload);
+            break;
+        default:;
+    }
+
+    put_varint(out, payload << DELTA_TYPE_BITS | type);
+    for (; varints > 0; varints--)
+        put_varint(out, random_value());
+    if (type == wire::DE_PAD_TRIGGERS)
+        put_random(out, 2);
+}
+
+/* Any message except MSG_FRAME */
+static bytes random_message()
+{
+    static const uint8_t simple[] = {MSG_SERVER_SHUTDOWN, MSG_PING_CLIENT, MSG_CLIENT_DC, MSG_REFRESH,
+                                     MSG_END_BUFFER, MSG_PUSH_MODE};
+    bytes msg;
+    uint32_t count = 0;
+
+    switch (random(7)) {
+        case 0:
+            msg.push_back(MSG_HELLO);
+            put_random(msg, 1);
+            break;
+        case 1:
+            count = random(0xff);
+            msg.push_back(MSG_BUTTON_DATA);
+            msg.push_back(static_cast<uint8_t>(count));
+            put_random(msg, 2 * count);
+            break;
+        case 2:
+            msg.push_back(MSG_MOUSE_DATA);
+            put_random(msg, 8);
+            break;
+        case 3:
+            msg.push_back(MSG_GAMEPAD_DATA);
+            put_random(msg, 21);
+            break;
+        case 4:
+            count = random(20);
+            msg.push_back(MSG_INPUT_DELTA);
+            put_varint(msg, random_value());
+            put_varint(msg, random_value());
+            msg.push_back(static_cast<uint8_t>(count));
+            for (; count > 0; count--)
+                put_delta_event(msg);
+            break;
+        case 5:
+            msg.push_back(random(1) ? MSG_UDP_MODE : MSG_PONG);
+            put_varint(msg, random_value());
+            break;
+        default:
+            msg.push_back(simple[random(sizeof(simple) - 1)]);
+    }
+    return msg;
+}
+
+/* Returns the stream and the messages for_each_message() should find in it */
+static bytes random_stream(std::vector<bytes> &expected)
+{
+    bytes stream;
+    const auto count = random(MAX_MESSAGES);
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (random(3) == 0) {
+            bytes frame;
+            for (auto inner = random(40); inner > 0; inner--) {
+                const auto msg = random_message();
+                frame.insert(frame.end(), msg.begin(), msg.end());
+                expected.push_back(msg);
+            }
+            stream.push_back(MSG_FRAME);
+            put_varint(stream, static_cast<uint32_t>(frame.size()));
+            stream.insert(stream.end(), frame.begin(), frame.end());
+        } else {
+            const auto msg = random_message();
+            stream.insert(stream.end(), msg.begin(), msg.end());
+            expected.push_back(msg);
+        }
+    }
+    return stream;
+}
+
+/* Flips, inserts or removes a few bytes or cuts the stream short */
+static void corrupt(bytes &stream)
+{
+    for (auto changes = random(3) + 1; changes > 0 && !stream.empty(); changes--) {
+        const auto pos = random(static_cast<uint32_t>(stream.size() - 1));
+        switch (random(3)) {
+            case 0:
+                stream[pos] ^= static_cast<uint8_t>(1 << random(7));
+                break;
+            case 1:
+                stream[pos] = static_cast<uint8_t>(random(0xff));
+                break;
+            case 2:
+                stream.insert(stream.begin() + pos, static_cast<uint8_t>(random(0xff)));
+                break;
+            default:
+                stream.resize(pos);
+        }
+    }
+}
+
+/* Parses the stream like io_client::receive(), returns false if it was rejected */
+static bool parse(const bytes &stream, std::vector<bytes> &handled)
+{
+    receive_buffer buffer;
+    size_t fed = 0, consumed = 0, last_offset = 0;
+    auto first = true, ok = true;
+
+    const auto handle = [&](const uint8_t* data, const size_t size)
+    {
+        const auto start = data - buffer.data();
+        CHECK(start >= 0 && start + size <= buffer.size(), "message at %ld with %zu bytes is outside of the %zu "
+              "received bytes", static_cast<long>(start), size, buffer.size());
+        CHECK(size > 0, "empty message");
+
+        /* Messages are handled in stream order, so every one has to start behind the last */
+        const auto offset = consumed + static_cast<size_t>(start);
+        CHECK(first || offset > last_offset, "message at %zu handled after the one at %zu", offset, last_offset);
+        first = false;
+        last_offset = offset;
+
+        handled.emplace_back(data, data + size);
+        return true;
+    };
+
+    while (ok && fed < stream.size()) {
+        size_t free = 0;
+        const auto space = buffer.free_space(free);
+        if (!space)
+            return false;
+
+        auto chunk = static_cast<size_t>(random(MAX_CHUNK - 1)) + 1;
+        chunk = std::min(chunk, std::min(free, stream.size() - fed));
+        memcpy(space, stream.data() + fed, chunk);
+        buffer.commit(chunk);
+        fed += chunk;
+
+        while (buffer.size() > 0) {
+            size_t length = 0;
+            const auto status = wire::message_length(buffer.data(), buffer.size(), &length);
+
+            if (status == wire::PS_INVALID)
+                return false;
+            if (status == wire::PS_INCOMPLETE) {
+                CHECK(length > buffer.size(), "incomplete message of %zu bytes fits into %zu", length,
+                      buffer.size());
+                ok = buffer.reserve(length);
+                break;
+            }
+
+            CHECK(length > 0 && length <= buffer.size(), "complete message of %zu bytes with %zu received",
+                  length, buffer.size());
+            if (!wire::for_each_message(buffer.data(), length, handle))
+                return false;
+            consumed += length;
+            buffer.consume(length);
+        }
+    }
+
+    CHECK(consumed <= fed, "consumed %zu of %zu bytes", consumed, fed);
+    return ok && buffer.size() == 0;
+}
+
+static void test_valid()
+{
+    size_t messages = 0;
+
+    for (auto i = 0; i < VALID_STREAMS; i++) {
+        std::vector<bytes> expected, handled;
+        const auto stream = random_stream(expected);
+
+        CHECK(parse(stream, handled), "valid stream %d with %zu bytes was rejected", i, stream.size());
+        CHECK(handled == expected, "stream %d: handled %zu of %zu messages or changed them", i, handled.size(),
+              expected.size());
+        messages += handled.size();
+    }
+    printf("valid: %d streams with %zu messages\n", VALID_STREAMS, messages);
+}
+
+static void test_corrupt()
+{
+    auto rejected = 0;
+
+    for (auto i = 0; i < CORRUPT_STREAMS; i++) {
+        std::vector<bytes> expected, handled;
+        auto stream = random_stream(expected);
+        corrupt(stream);
+
+        if (!parse(stream, handled))
+            rejected++;
+    }
+    printf("corrupt: %d streams, %d rejected\n", CORRUPT_STREAMS, rejected);
+}
+
+static void test_nested_frame()
+{
+    std::vector<bytes> handled;
+    const bytes inner = {MSG_FRAME, 1, MSG_REFRESH};
+    bytes stream = {MSG_FRAME, static_cast<uint8_t>(inner.size())};
+    stream.insert(stream.end(), inner.begin(), inner.end());
+
+    CHECK(!parse(stream, handled), "nested frame was accepted");
+    CHECK(handled.empty(), "message from a nested frame was handled");
+
+    /* A frame with a cut off message at its end */
+    handled.clear();
+    stream = {MSG_FRAME, 3, MSG_REFRESH, MSG_MOUSE_DATA, 0};
+    CHECK(!parse(stream, handled), "frame with an incomplete message was accepted");
+}
+
+/* Unknown ids have to end the stream instead of being skipped as one byte messages */
+static void test_unknown_id()
+{
+    std::vector<bytes> handled;
+    bytes stream = {MSG_REFRESH, MSG_LAST, MSG_REFRESH};
+
+    CHECK(!parse(stream, handled), "message with an unknown id was accepted");
+    CHECK(handled.size() == 1, "handled %zu messages around an unknown id instead of 1", handled.size());
+
+    handled.clear();
+    stream = {MSG_FRAME, 2, MSG_REFRESH, 0xff};
+    CHECK(!parse(stream, handled), "frame with an unknown id was accepted");
+}
+
+int main()
+{
+    test_nested_frame();
+    test_unknown_id();
+    test_valid();
+    test_corrupt();
+
+    if (failures)
+        fprintf(stderr, "%d checks failed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -20,6 +20,7 @@ namespace io_config
     extern bool control;
     extern bool remote;
     extern bool gamepad;
+    extern bool pad_evdev; /* Linux only, read gamepads from /dev/input/event* instead of /dev/input/js* */
     extern bool uiohook;
     extern bool overlay;
     extern bool history;
@@ -6,19 +6,10 @@
  */
 
 #include "element.hpp"
-#include "../../../ccl/ccl.hpp"
+#include "element_data.hpp"
+#include "../layout_file.hpp"
 #include "util/layout_constants.hpp"
 
-element_data::element_data(const element_type type)
-{
-    m_type = type;
-}
-
-element_type element_data::get_type() const
-{
-    return m_type;
-}
-
 element::element() : m_keycode(0)
 {
     m_type = ET_INVALID;
@@ -44,18 +35,16 @@ data_source element::get_source()
     return DS_NONE;
 }
 
-void element::read_mapping(ccl_config* cfg, const std::string &id)
+void element::read_mapping(const element_record* record)
 {
-    const auto r = cfg->get_rect(id + CFG_MAPPING);
-    m_mapping.x = r.x;
-    m_mapping.y = r.y;
-    m_mapping.cx = r.w;
-    m_mapping.cy = r.h;
+    m_mapping.x = record->map_x;
+    m_mapping.y = record->map_y;
+    m_mapping.cx = record->map_w;
+    m_mapping.cy = record->map_h;
 }
 
-void element::read_pos(ccl_config* cfg, const std::string &id)
+void element::read_pos(const element_record* record)
 {
-    const auto p = cfg->get_point(id + CFG_POS);
-    m_pos.x = p.x;
-    m_pos.y = p.y;
+    m_pos.x = record->pos_x;
+    m_pos.y = record->pos_y;
 }
@@ -10,8 +10,6 @@
 #include "graphics/vec2.h"
 #include "graphics/graphics.h"
 
-typedef struct gs_image_file gs_image_file_t;
-
 /**
  * Which data holder to read element
  * data from
@@ -26,7 +24,7 @@ namespace sources
     class overlay_settings;
 }
 
-class ccl_config;
+struct element_record;
 
 #ifdef _WIN32
 enum class element_type;
@@ -36,32 +34,9 @@ enum class element_type;
 
 #endif
 
-class element_data
-{
-public:
-    explicit element_data(element_type type);
-    virtual ~element_data() = default;
-
-    element_type get_type() const;
-
-    /* true if data should not me removed */
-    virtual bool is_persistent()
-    { return false; }
-
-    /* used if is persistent
-     * returns true if new data differed from old one and this input should
-     * invoke an update for input history things like mouse or analog stick
-     * movement return false to prevent spamming input history */
-    virtual bool merge(element_data* other)
-    {
-        UNUSED_PARAMETER(other);
-        /* NO-OP */
-        return false;
-    }
+class element_data;
 
-protected:
-    element_type m_type;
-};
+class sprite_batch;
 
 class element
 {
@@ -72,10 +47,10 @@ public:
 
     element(element_type type);
 
-    virtual void load(ccl_config* cfg, const std::string &id) = 0;
+    virtual void load(const element_record* record) = 0;
 
     virtual void
-    draw(gs_effect_t* effect, gs_image_file_t* m_image, element_data* data, sources::overlay_settings* settings) = 0;
+    draw(sprite_batch* batch, const element_data* data, sources::overlay_settings* settings) = 0;
 
     element_type get_type() const;
 
@@ -83,10 +58,14 @@ public:
 
     virtual data_source get_source();
 
+    /* Maximum amount of quads this element draws,
+     * which are reserved for it in the sprite batch */
+    virtual uint8_t get_quad_count() const = 0;
+
 protected:
-    void read_mapping(ccl_config* cfg, const std::string &id);
+    void read_mapping(const element_record* record);
 
-    void read_pos(ccl_config* cfg, const std::string &id);
+    void read_pos(const element_record* record);
 
     vec2 m_pos = {};
     gs_rect m_mapping = {};
@@ -11,26 +11,6 @@
 #include "element_texture.hpp"
 #include <netlib.h>
 
-class element_data_button : public element_data
-{
-public:
-    element_data_button(const button_state state) : element_data(ET_BUTTON)
-    {
-        m_state = state;
-        blog(LOG_DEBUG, "state: %i", static_cast<bool>(state));
-    }
-
-    button_state get_state() const
-    {
-        return m_state;
-    }
-
-    bool merge(element_data* other) override;
-
-private:
-    button_state m_state;
-};
-
 class element_button : public element_texture
 {
 public:
@@ -38,10 +18,10 @@ public:
     {
     }
 
-    void load(ccl_config* cfg, const std::string &id) override;
+    void load(const element_record* record) override;
 
     void
-    draw(gs_effect_t* effect, gs_image_file_t* image, element_data* data, sources::overlay_settings* settings) override;
+    draw(sprite_batch* batch, const element_data* data, sources::overlay_settings* settings) override;
 
     data_source get_source() override
     { return is_gamepad ? DS_GAMEPAD : DS_DEFAULT; }
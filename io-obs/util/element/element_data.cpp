@@ -0,0 +1,309 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#include "element_data.hpp"
+
+bool element_data_button::set_state(const button_state state)
+{
+    const auto result = m_state == BS_RELEASED && state == BS_PRESSED;
+    m_state = state;
+    return result;
+}
+
+bool element_data_button::merge(const element_data_button &other)
+{
+    return set_state(other.m_state);
+}
+
+void element_data_analog_stick::set_state(const button_state left, const button_state right)
+{
+    m_left_state = left;
+    m_right_state = right;
+}
+
+bool element_data_analog_stick::merge(const element_data_analog_stick &other)
+{
+    bool result = false;
+    switch (other.m_data_type) {
+        case SD_BOTH:
+            /* If either of the two sticks
+             * are switching from unpressed to pressed
+             * input history should update */
+            if (other.m_left_state == BS_PRESSED && m_left_state == BS_RELEASED)
+                result = true;
+            if (other.m_right_state == BS_PRESSED && m_right_state == BS_RELEASED)
+                result = true;
+            m_left_stick = other.m_left_stick;
+            m_right_stick = other.m_right_stick;
+            m_left_state = other.m_left_state;
+            m_right_state = other.m_right_state;
+            break;
+        case SD_PRESSED_STATE_LEFT:
+            if (other.m_left_state == BS_PRESSED && m_left_state == BS_RELEASED)
+                result = true;
+            m_left_state = other.m_left_state;
+            if (m_data_type != SD_PRESSED_STATE_LEFT) m_data_type = SD_BOTH;
+            break;
+        case SD_PRESSED_STATE_RIGHT:
+            if (other.m_right_state == BS_PRESSED && m_right_state == BS_RELEASED)
+                result = true;
+            m_right_state = other.m_right_state;
+            if (m_data_type != SD_PRESSED_STATE_RIGHT) m_data_type = SD_BOTH;
+            break;
+        case SD_LEFT_X:
+            m_left_stick.x = other.m_left_stick.x;
+            if (m_data_type != SD_LEFT_X) m_data_type = SD_BOTH;
+            break;
+        case SD_LEFT_Y:
+            m_left_stick.y = other.m_left_stick.y;
+            if (m_data_type != SD_LEFT_Y) m_data_type = SD_BOTH;
+            break;
+        case SD_RIGHT_X:
+            m_right_stick.x = other.m_right_stick.x;
+            if (m_data_type != SD_RIGHT_X) m_data_type = SD_BOTH;
+            break;
+        case SD_RIGHT_Y:
+            m_right_stick.y = other.m_right_stick.y;
+            if (m_data_type != SD_RIGHT_Y) m_data_type = SD_BOTH;
+            break;
+    }
+    return result;
+}
+
+element_data_trigger::element_data_trigger(const trigger_data side, const float val)
+{
+    if (side == TD_LEFT)
+        m_left_trigger = val;
+    else
+        m_right_trigger = val;
+    m_data_type = side;
+}
+
+element_data_trigger::element_data_trigger(const float left, const float right)
+{
+    m_left_trigger = left;
+    m_right_trigger = right;
+    m_data_type = TD_BOTH;
+}
+
+float element_data_trigger::get_left() const
+{
+    return m_left_trigger;
+}
+
+float element_data_trigger::get_right() const
+{
+    return m_right_trigger;
+}
+
+bool element_data_trigger::merge(const element_data_trigger &other)
+{
+    switch (other.m_data_type) {
+        case TD_BOTH:
+            m_left_trigger = other.m_left_trigger;
+            m_right_trigger = other.m_right_trigger;
+            break;
+        case TD_LEFT:
+            m_left_trigger = other.m_left_trigger;
+            if (m_data_type == TD_RIGHT) /* Left merged with right = now contains both sides */
+                m_data_type = TD_BOTH;
+            break;
+        case TD_RIGHT:
+            m_right_trigger = other.m_right_trigger;
+            if (m_data_type == TD_LEFT) /* Left merged with right = now contains both sides */
+                m_data_type = TD_BOTH;
+            break;
+        default:;
+    }
+    return false;
+}
+
+element_data_dpad::element_data_dpad(const dpad_direction a, const dpad_direction b)
+{
+    m_direction = (int) a | (int) b;
+    m_state = BS_RELEASED;
+}
+
+element_data_dpad::element_data_dpad(const dpad_direction d, const button_state state)
+{
+    m_direction = (int) d;
+    m_state = state;
+}
+
+bool element_data_dpad::merge(const element_data_dpad &other)
+{
+    const auto result = m_direction != other.m_direction;
+#ifdef _WIN32
+    m_direction = other.m_direction;
+#else
+    if (other.get_state() == BS_PRESSED) {
+        m_direction |= other.m_direction;
+    } else {
+        m_direction &= ~other.m_direction;
+    }
+#endif /* !WINDOWS*/
+    return result;
+}
+
+dpad_texture element_data_dpad::get_direction() const
+{
+    if (m_direction & DD_UP && m_direction & DD_LEFT)
+        return DT_TOP_LEFT;
+    else if (m_direction & DD_UP && m_direction & DD_RIGHT)
+        return DT_TOP_RIGHT;
+    else if (m_direction & DD_DOWN && m_direction & DD_LEFT)
+        return DT_BOTTOM_LEFT;
+    else if (m_direction & DD_DOWN && m_direction & DD_RIGHT)
+        return DT_BOTTOM_RIGHT;
+    else if (m_direction & DT_UP)
+        return DT_UP;
+    else if (m_direction & DD_DOWN)
+        return DT_DOWN;
+    else if (m_direction & DD_LEFT)
+        return DT_LEFT;
+    else
+        return DT_RIGHT;
+}
+
+button_state element_data_dpad::get_state() const
+{
+    return m_state;
+}
+
+element_data_mouse_pos::element_data_mouse_pos(const int16_t x, const int16_t y)
+{
+    m_x = x;
+    m_y = y;
+}
+
+bool element_data_mouse_pos::merge(const element_data_mouse_pos &other)
+{
+    set_pos(other.m_x, other.m_y);
+    return false;
+}
+
+void element_data_mouse_pos::set_pos(const int16_t x, const int16_t y)
+{
+    m_last_x = m_x;
+    m_last_y = m_y;
+    m_x = x;
+    m_y = y;
+}
+
+void element_data_mouse_pos::set_motion(const int16_t from_x, const int16_t from_y, const int16_t x, const int16_t y)
+{
+    m_last_x = from_x;
+    m_last_y = from_y;
+    m_x = x;
+    m_y = y;
+}
+
+bool element_data_mouse_pos::stop_motion()
+{
+    if (m_last_x == m_x && m_last_y == m_y)
+        return false;
+    m_last_x = m_x;
+    m_last_y = m_y;
+    return true;
+}
+
+int16_t element_data_mouse_pos::get_mouse_x() const
+{
+    return m_x;
+}
+
+int16_t element_data_mouse_pos::get_mouse_y() const
+{
+    return m_y;
+}
+
+element_data_wheel::element_data_wheel(const direction dir, const button_state state) : element_data_wheel(dir)
+{
+    m_data_type = WD_BOTH;
+    m_middle_button = state;
+}
+
+element_data_wheel::element_data_wheel(const direction dir) :
+    m_middle_button(BS_RELEASED)
+{
+    m_data_type = WD_WHEEL;
+    m_dir = dir;
+}
+
+element_data_wheel::element_data_wheel(const button_state state) :
+    m_dir()
+{
+    m_data_type = WD_BUTTON;
+    m_middle_button = state;
+}
+
+direction element_data_wheel::get_dir() const
+{
+    return m_dir;
+}
+
+void element_data_wheel::set_dir(const direction dir)
+{
+    m_dir = dir;
+}
+
+button_state element_data_wheel::get_state() const
+{
+    return m_middle_button;
+}
+
+bool element_data_wheel::merge(const element_data_wheel &other)
+{
+    bool result = false;
+
+    /* After the merge this data contains both the scroll wheel state and the button state */
+    if (m_data_type != other.m_data_type)
+        m_data_type = WD_BOTH;
+
+    switch (other.m_data_type) {
+        case WD_BUTTON:
+            result = m_middle_button == BS_RELEASED && other.m_middle_button == BS_PRESSED;
+            m_middle_button = other.get_state();
+            break;
+        case WD_WHEEL:
+            m_dir = other.get_dir();
+            break;
+        case WD_BOTH:
+            result = m_middle_button == BS_RELEASED && other.m_middle_button == BS_PRESSED;
+            m_dir = other.get_dir();
+            m_middle_button = other.get_state();
+    }
+    return result;
+}
+
+wheel_data element_data_wheel::get_data_type() const
+{
+    return m_data_type;
+}
+
+bool element_data::merge(const element_data &other)
+{
+    if (other.m_type != m_type)
+        return false;
+
+    switch (m_type) {
+        case ET_BUTTON:
+            return m_button.merge(other.m_button);
+        case ET_ANALOG_STICK:
+            return m_stick.merge(other.m_stick);
+        case ET_TRIGGER:
+            return m_trigger.merge(other.m_trigger);
+        case ET_DPAD_STICK:
+            return m_dpad.merge(other.m_dpad);
+        case ET_MOUSE_STATS:
+            return m_mouse.merge(other.m_mouse);
+        case ET_WHEEL:
+            return m_wheel.merge(other.m_wheel);
+        default:
+            return false;
+    }
+}
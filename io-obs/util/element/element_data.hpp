@@ -0,0 +1,351 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include "../layout_constants.hpp"
+#include "graphics/vec2.h"
+#include <netlib.h>
+#include <stdint.h>
+
+namespace sources
+{
+    class overlay_settings;
+}
+
+/* All data classes are plain values without virtual methods, so they
+ * can be stored by value inside element_data and copied freely.
+ * merge() returns true if new data differed from old one and this input
+ * should invoke an update for input history. Things like mouse or analog
+ * stick movement return false to prevent spamming input history */
+
+class element_data_button
+{
+public:
+    element_data_button(const button_state state = BS_RELEASED) : m_state(state)
+    {
+    }
+
+    button_state get_state() const
+    {
+        return m_state;
+    }
+
+    /* returns true if the button was pressed down */
+    bool set_state(button_state state);
+
+    bool merge(const element_data_button &other);
+
+private:
+    button_state m_state;
+};
+
+enum stick_data_type
+{
+    SD_BOTH, SD_PRESSED_STATE_LEFT, SD_PRESSED_STATE_RIGHT, SD_LEFT_X, SD_LEFT_Y, SD_RIGHT_X, SD_RIGHT_Y
+};
+
+/* Contains data for both analog sticks
+ * and their pressed state
+ */
+class element_data_analog_stick
+{
+public:
+    element_data_analog_stick() : m_left_stick(), m_right_stick(), m_left_state(), m_right_state()
+    {
+        m_data_type = SD_BOTH;
+    }
+
+    /*
+        Separate constructors are used on linux
+        because the values can't be queried together
+    */
+    element_data_analog_stick(const button_state state, const element_side side) : m_left_stick(), m_right_stick(),
+        m_left_state(), m_right_state()
+    {
+        if (side == ES_LEFT) {
+            m_left_state = state;
+            m_data_type = SD_PRESSED_STATE_LEFT;
+        } else {
+            m_right_state = state;
+            m_data_type = SD_PRESSED_STATE_RIGHT;
+        }
+    }
+
+    element_data_analog_stick(const float axis_value, const stick_data_type data_type) : m_left_stick(),
+        m_right_stick(), m_left_state(), m_right_state()
+    {
+        switch (data_type) {
+            case SD_LEFT_X:
+                m_left_stick = {axis_value, -1};
+                break;
+            case SD_LEFT_Y:
+                m_left_stick = {-1, axis_value};
+                break;
+            case SD_RIGHT_X:
+                m_right_stick = {axis_value, -1};
+                break;
+            case SD_RIGHT_Y:
+                m_right_stick = {-1, axis_value};
+                break;
+            default:;
+        }
+        m_data_type = data_type;
+    }
+
+    element_data_analog_stick(bool left, bool right, const float l_x, const float l_y, const float r_x,
+                              const float r_y)
+    {
+        m_left_stick = {l_x, l_y};
+        m_right_stick = {r_x, r_y};
+        m_left_state = static_cast<button_state>(left);
+        m_right_state = static_cast<button_state>(right);
+        m_data_type = SD_BOTH;
+    }
+
+    bool left_pressed() const
+    {
+        return m_left_state == BS_PRESSED;
+    }
+
+    bool right_pressed() const
+    {
+        return m_right_state == BS_PRESSED;
+    }
+
+    const vec2* get_left_stick() const
+    {
+        return &m_left_stick;
+    }
+
+    const vec2* get_right_stick() const
+    {
+        return &m_right_stick;
+    }
+
+    void set_state(button_state left, button_state right);
+
+    bool merge(const element_data_analog_stick &other);
+
+private:
+    vec2 m_left_stick{}, m_right_stick{};
+    stick_data_type m_data_type = SD_BOTH;
+    button_state m_left_state, m_right_state;
+};
+
+enum trigger_data
+{
+    TD_NONE = -1,
+    TD_BOTH,
+    TD_LEFT,
+    TD_RIGHT
+};
+
+/* Contains data for both trigger buttons */
+class element_data_trigger
+{
+public:
+    element_data_trigger() = default;
+
+    /*
+        Separate constructors are used on linux
+        because the values can't be queried together
+    */
+    element_data_trigger(trigger_data side, float val);
+
+    element_data_trigger(float left, float right);
+
+    float get_left() const;
+
+    float get_right() const;
+
+    bool merge(const element_data_trigger &other);
+
+private:
+    trigger_data m_data_type = TD_BOTH;
+    float m_left_trigger = 0.f, m_right_trigger = 0.f;
+};
+
+class element_data_dpad
+{
+public:
+    /*
+        Separate constructors are used on linux
+        because the values can't be queried together
+    */
+
+    /* Xinput directly generates direction */
+    element_data_dpad(dpad_direction a, dpad_direction b);
+
+    element_data_dpad(dpad_direction d, button_state state);
+
+    bool merge(const element_data_dpad &other);
+
+    dpad_texture get_direction() const;
+
+    button_state get_state() const;
+
+private:
+    uint16_t m_direction;
+    button_state m_state;
+};
+
+/* Contains all information about mouse movement,
+ * which is used for the arrow and dot elements
+ */
+class element_data_mouse_pos
+{
+public:
+    element_data_mouse_pos(int16_t x, int16_t y);
+
+    bool merge(const element_data_mouse_pos &other);
+    void set_pos(int16_t x, int16_t y);
+    /* Sets the position and where the movement started, instead of the last position */
+    void set_motion(int16_t from_x, int16_t from_y, int16_t x, int16_t y);
+    /* Mouse didn't move since the last position, returns false if there was no movement anyway */
+    bool stop_motion();
+    /* old_angle is returned if the movement was within the dead zone */
+    float get_mouse_angle(sources::overlay_settings* settings, float old_angle) const;
+    void get_mouse_offset(sources::overlay_settings* settings, const vec2 &center, vec2 &out, uint8_t radius) const;
+    int16_t get_mouse_x() const;
+    int16_t get_mouse_y() const;
+
+private:
+    int16_t m_x{}, m_y{};
+    int16_t m_last_x{}, m_last_y{};
+};
+
+enum wheel_data
+{
+    WD_BOTH, WD_BUTTON, WD_WHEEL
+};
+
+class element_data_wheel
+{
+public:
+    element_data_wheel(direction dir, button_state state);
+
+    explicit element_data_wheel(direction dir);
+
+    explicit element_data_wheel(button_state state);
+
+    direction get_dir() const;
+
+    void set_dir(direction dir);
+
+    button_state get_state() const;
+
+    bool merge(const element_data_wheel &other);
+
+    wheel_data get_data_type() const;
+
+private:
+    wheel_data m_data_type;
+    button_state m_middle_button;
+    direction m_dir;
+};
+
+/* Input state of a single keycode. The type decides which of the
+ * data classes is stored, the accessors return nullptr if the data
+ * is of a different type */
+class element_data
+{
+public:
+    element_data() : m_type(ET_INVALID), m_button()
+    {
+    }
+
+    element_data(const element_data_button &button) : m_type(ET_BUTTON), m_button(button)
+    {
+    }
+
+    element_data(const element_data_analog_stick &stick) : m_type(ET_ANALOG_STICK), m_stick(stick)
+    {
+    }
+
+    element_data(const element_data_trigger &trigger) : m_type(ET_TRIGGER), m_trigger(trigger)
+    {
+    }
+
+    element_data(const element_data_dpad &dpad) : m_type(ET_DPAD_STICK), m_dpad(dpad)
+    {
+    }
+
+    element_data(const element_data_mouse_pos &mouse) : m_type(ET_MOUSE_STATS), m_mouse(mouse)
+    {
+    }
+
+    element_data(const element_data_wheel &wheel) : m_type(ET_WHEEL), m_wheel(wheel)
+    {
+    }
+
+    element_type get_type() const
+    {
+        return m_type;
+    }
+
+    bool valid() const
+    {
+        return m_type != ET_INVALID;
+    }
+
+    /* Data of a different type is ignored */
+    bool merge(const element_data &other);
+
+    const element_data_button* button() const
+    {
+        return m_type == ET_BUTTON ? &m_button : nullptr;
+    }
+
+    element_data_button* button()
+    {
+        return m_type == ET_BUTTON ? &m_button : nullptr;
+    }
+
+    const element_data_analog_stick* analog_stick() const
+    {
+        return m_type == ET_ANALOG_STICK ? &m_stick : nullptr;
+    }
+
+    const element_data_trigger* trigger() const
+    {
+        return m_type == ET_TRIGGER ? &m_trigger : nullptr;
+    }
+
+    const element_data_dpad* dpad() const
+    {
+        return m_type == ET_DPAD_STICK ? &m_dpad : nullptr;
+    }
+
+    const element_data_mouse_pos* mouse_pos() const
+    {
+        return m_type == ET_MOUSE_STATS ? &m_mouse : nullptr;
+    }
+
+    element_data_mouse_pos* mouse_pos()
+    {
+        return m_type == ET_MOUSE_STATS ? &m_mouse : nullptr;
+    }
+
+    const element_data_wheel* wheel() const
+    {
+        return m_type == ET_WHEEL ? &m_wheel : nullptr;
+    }
+
+private:
+    element_type m_type;
+
+    union
+    {
+        element_data_button m_button;
+        element_data_analog_stick m_stick;
+        element_data_trigger m_trigger;
+        element_data_dpad m_dpad;
+        element_data_mouse_pos m_mouse;
+        element_data_wheel m_wheel;
+    };
+};
@@ -6,87 +6,297 @@
  */
 
 #include "element_data_holder.hpp"
-#include "element_trigger.hpp"
-#include "sources/input_history.hpp"
-#include "element_button.hpp"
-#include "element_analog_stick.hpp"
-#include "element_mouse_wheel.hpp"
 #include <util/platform.h>
+#include <uiohook.h>
 #include <algorithm>
+#include <iterator>
+
+/* Upper keycode bytes used by uiohook and the plugin, in page order */
+static const uint8_t page_codes[HOLDER_PAGE_COUNT] = {
+    0x00, 0x0E, 0xE0, VC_PAD_MASK >> 8, VC_MOUSE_MASK >> 8, 0xEE, 0xFF
+};
+
+static inline int key_page(const uint16_t keycode)
+{
+    switch (keycode >> 8) {
+        case 0x00:
+            return 0;
+        case 0x0E:
+            return 1;
+        case 0xE0:
+            return 2;
+        case VC_PAD_MASK >> 8:
+            return 3;
+        case VC_MOUSE_MASK >> 8:
+            return 4;
+        case 0xEE:
+            return 5;
+        case 0xFF:
+            return 6;
+        default:
+            return HOLDER_INVALID_SLOT;
+    }
+}
 
 element_data_holder::element_data_holder(bool is_local)
 {
     m_local = is_local;
-    m_button_data = std::map<uint16_t, std::unique_ptr<element_data>>();
+    std::fill(std::begin(m_gamepad_index), std::end(m_gamepad_index), HOLDER_NO_PAD);
+}
+
+int element_data_holder::button_slot(const uint16_t keycode)
+{
+    const auto page = key_page(keycode);
+    if (page == HOLDER_INVALID_SLOT)
+        return HOLDER_INVALID_SLOT;
+    return page * HOLDER_PAGE_SIZE + (keycode & 0xff);
+}
+
+int element_data_holder::gamepad_slot(const uint16_t keycode)
+{
+    if ((keycode >> 8) != (VC_PAD_MASK >> 8))
+        return HOLDER_INVALID_SLOT;
+    return keycode & 0xff;
+}
+
+element_data_holder::gamepad_page* element_data_holder::find_gamepad(const uint8_t gamepad)
+{
+    const auto index = m_gamepad_index[gamepad];
+    return index == HOLDER_NO_PAD ? nullptr : &m_gamepads[index];
+}
+
+const element_data_holder::gamepad_page* element_data_holder::find_gamepad(const uint8_t gamepad) const
+{
+    const auto index = m_gamepad_index[gamepad];
+    return index == HOLDER_NO_PAD ? nullptr : &m_gamepads[index];
+}
+
+element_data_holder::gamepad_page &element_data_holder::add_gamepad(const uint8_t gamepad)
+{
+    auto index = m_gamepad_index[gamepad];
+    if (index == HOLDER_NO_PAD) {
+        index = static_cast<int16_t>(m_gamepads.size());
+        m_gamepads.emplace_back();
+        m_gamepad_index[gamepad] = index;
+    }
+    return m_gamepads[index];
+}
+
+uint16_t element_data_holder::slot_to_code(const int slot)
+{
+    return page_codes[slot / HOLDER_PAGE_SIZE] << 8 | slot % HOLDER_PAGE_SIZE;
+}
+
+uint8_t element_data_holder::press_bits(const element_data &data)
+{
+    switch (data.get_type()) {
+        case ET_BUTTON:
+            return data.button()->get_state() == BS_PRESSED;
+        case ET_WHEEL:
+            return (data.wheel()->get_dir() == DIR_UP) | (data.wheel()->get_dir() == DIR_DOWN) << 1 |
+                   (data.wheel()->get_state() == BS_PRESSED) << 2;
+        case ET_ANALOG_STICK:
+            return data.analog_stick()->left_pressed() | data.analog_stick()->right_pressed() << 1;
+        case ET_TRIGGER:
+            return (data.trigger()->get_left() > TRIGGER_THRESHOLD) |
+                   (data.trigger()->get_right() > TRIGGER_THRESHOLD) << 1;
+        default: /* Mouse position and dpad data are never shown */
+            return 0;
+    }
+}
+
+uint16_t element_data_holder::press_code(const element_data &data, const uint16_t keycode, const int bit)
+{
+    static const uint16_t wheel_codes[] = {VC_MOUSE_WHEEL_UP, VC_MOUSE_WHEEL_DOWN, VC_MOUSE_WHEEL};
+
+    switch (data.get_type()) {
+        case ET_WHEEL:
+            return wheel_codes[bit];
+        case ET_ANALOG_STICK:
+            return bit ? VC_PAD_R_ANALOG : VC_PAD_L_ANALOG;
+        case ET_TRIGGER:
+            return bit ? VC_PAD_RT : VC_PAD_LT;
+        default:
+            return keycode;
+    }
+}
+
+void element_data_holder::log_presses(const uint16_t keycode, const int16_t gamepad, const element_data &data,
+                                      const uint8_t before, const uint8_t after)
+{
+    for (auto bit = 0; before != after && bit < 3; bit++) {
+        if (((before ^ after) >> bit) & 1) {
+            press_event event;
+            event.keycode = press_code(data, keycode, bit);
+            event.gamepad = gamepad;
+            event.pressed = (after >> bit) & 1;
+            add_press(event);
+        }
+    }
 }
 
-element_data_holder::~element_data_holder()
+void element_data_holder::add_press(const press_event &event)
 {
-    clear_data();
+    m_presses[m_press_count++ % HOLDER_PRESS_LOG] = event;
 }
 
 bool element_data_holder::is_empty() const
 {
     auto flag = true;
 
-    for (const auto &pad : m_gamepad_data) {
-        if (!pad.empty()) {
+    for (const auto &pad : m_gamepads) {
+        if (pad.count) {
             flag = false;
             break;
         }
     }
 
-    return flag && m_button_data.empty();
+    return flag && !m_button_count;
 }
 
-void element_data_holder::add_data(const uint16_t keycode, element_data* data)
+void element_data_holder::add_data(const uint16_t keycode, const element_data &data)
 {
+    const auto slot = button_slot(keycode);
     bool refresh = false;
-    if (data_exists(keycode)) {
-        refresh = m_button_data[keycode]->merge(data);
-        delete data; /* Existing data was used -> delete other one */
+
+    if (slot == HOLDER_INVALID_SLOT || !data.valid())
+        return;
+
+    auto &entry = m_button_data[slot];
+    const auto before = press_bits(entry);
+    if (entry.valid()) {
+        refresh = entry.merge(data);
     } else {
-        m_button_data[keycode] = std::unique_ptr<element_data>(data);
+        entry = data;
+        m_button_count++;
         refresh = true;
     }
 
+    log_presses(keycode, HOLDER_NO_PAD, entry, before, press_bits(entry));
+    m_version++;
     if (refresh)
         m_last_input = os_gettime_ns();
 }
 
-void element_data_holder::add_gamepad_data(const uint8_t gamepad, const uint16_t keycode, element_data* data)
+void element_data_holder::add_gamepad_data(const uint8_t gamepad, const uint16_t keycode, const element_data &data)
 {
+    const auto slot = gamepad_slot(keycode);
     bool refresh = false;
-    if (gamepad_data_exists(gamepad, keycode)) {
-        refresh = m_gamepad_data[gamepad][keycode]->merge(data);
-        delete data; /* Existing data was used -> delete other one */
+
+    if (slot == HOLDER_INVALID_SLOT || !data.valid())
+        return;
+
+    auto &pad = add_gamepad(gamepad);
+    auto &entry = pad.data[slot];
+    const auto before = press_bits(entry);
+    if (entry.valid()) {
+        refresh = entry.merge(data);
     } else {
-        m_gamepad_data[gamepad][keycode] = std::unique_ptr<element_data>(data);
+        entry = data;
+        pad.count++;
         refresh = true;
     }
+
+    log_presses(keycode, gamepad, entry, before, press_bits(entry));
+    m_version++;
     if (refresh)
         m_last_input = os_gettime_ns();
 }
 
-bool element_data_holder::gamepad_data_exists(const uint8_t gamepad, const uint16_t keycode)
+void element_data_holder::set_button(const uint16_t keycode, const button_state state)
 {
-    if (is_empty())
-        return false;
-    return m_gamepad_data[gamepad][keycode] != nullptr;
+    const auto slot = button_slot(keycode);
+    if (slot == HOLDER_INVALID_SLOT)
+        return;
+
+    const auto button = m_button_data[slot].button();
+    if (button) {
+        m_version++;
+        if (button->get_state() != state)
+            log_presses(keycode, HOLDER_NO_PAD, m_button_data[slot], state != BS_PRESSED, state == BS_PRESSED);
+        if (button->set_state(state))
+            m_last_input = os_gettime_ns();
+    } else {
+        add_data(keycode, element_data_button(state));
+    }
+}
+
+void element_data_holder::set_mouse_pos(const int16_t x, const int16_t y)
+{
+    const auto mouse = m_button_data[button_slot(VC_MOUSE_DATA)].mouse_pos();
+    if (mouse) {
+        mouse->set_pos(x, y);
+        m_version++;
+    } else {
+        add_data(VC_MOUSE_DATA, element_data_mouse_pos(x, y));
+    }
+}
+
+void element_data_holder::set_mouse_motion(const int16_t from_x, const int16_t from_y, const int16_t x,
+                                           const int16_t y)
+{
+    auto mouse = m_button_data[button_slot(VC_MOUSE_DATA)].mouse_pos();
+    if (!mouse) {
+        add_data(VC_MOUSE_DATA, element_data_mouse_pos(x, y));
+        mouse = m_button_data[button_slot(VC_MOUSE_DATA)].mouse_pos();
+    }
+
+    if (mouse) {
+        mouse->set_motion(from_x, from_y, x, y);
+        m_version++;
+    }
+}
+
+void element_data_holder::stop_mouse_motion()
+{
+    const auto mouse = m_button_data[button_slot(VC_MOUSE_DATA)].mouse_pos();
+    if (mouse && mouse->stop_motion())
+        m_version++;
+}
+
+void element_data_holder::set_gamepad_button(const uint8_t gamepad, const uint16_t keycode, const button_state state)
+{
+    const auto slot = gamepad_slot(keycode);
+    const auto pad = find_gamepad(gamepad);
+    if (slot == HOLDER_INVALID_SLOT)
+        return;
+
+    const auto button = pad ? pad->data[slot].button() : nullptr;
+    if (button) {
+        m_version++;
+        if (button->get_state() != state)
+            log_presses(keycode, gamepad, pad->data[slot], state != BS_PRESSED, state == BS_PRESSED);
+        if (button->set_state(state))
+            m_last_input = os_gettime_ns();
+    } else {
+        add_gamepad_data(gamepad, keycode, element_data_button(state));
+    }
+}
+
+bool element_data_holder::gamepad_data_exists(const uint8_t gamepad, const uint16_t keycode) const
+{
+    return get_by_gamepad(gamepad, keycode) != nullptr;
 }
 
 void element_data_holder::remove_gamepad_data(const uint8_t gamepad, const uint16_t keycode)
 {
     if (gamepad_data_exists(gamepad, keycode)) {
-        m_gamepad_data[gamepad][keycode].reset();
-        m_gamepad_data[gamepad].erase(keycode);
+        const auto pad = find_gamepad(gamepad);
+        auto &entry = pad->data[gamepad_slot(keycode)];
+        log_presses(keycode, gamepad, entry, press_bits(entry), 0);
+        entry = element_data();
+        pad->count--;
+        m_version++;
     }
 }
 
-element_data* element_data_holder::get_by_gamepad(const uint8_t gamepad, const uint16_t keycode)
+const element_data* element_data_holder::get_by_gamepad(const uint8_t gamepad, const uint16_t keycode) const
 {
-    auto result = m_gamepad_data[gamepad][keycode].get();
-    return result;
+    const auto slot = gamepad_slot(keycode);
+    const auto pad = find_gamepad(gamepad);
+    if (slot == HOLDER_INVALID_SLOT || !pad || !pad->data[slot].valid())
+        return nullptr;
+    return &pad->data[slot];
 }
 
 void element_data_holder::clear_data()
@@ -97,12 +307,102 @@ void element_data_holder::clear_data()
 
 void element_data_holder::clear_button_data()
 {
-    m_button_data.clear();
+    if (!m_button_count)
+        return;
+    for (auto slot = 0; slot < HOLDER_BUTTON_SLOTS; slot++) {
+        auto &entry = m_button_data[slot];
+        if (entry.valid()) {
+            log_presses(slot_to_code(slot), HOLDER_NO_PAD, entry, press_bits(entry), 0);
+            entry = element_data();
+        }
+    }
+    m_button_count = 0;
+    m_version++;
 }
 
 void element_data_holder::clear_gamepad_data()
 {
-    m_gamepad_data->clear();
+    if (m_gamepads.empty())
+        return;
+    for (auto id = 0; id < HOLDER_PAD_IDS; id++) {
+        const auto pad = find_gamepad(id);
+        for (auto slot = 0; pad && pad->count && slot < HOLDER_PAGE_SIZE; slot++) {
+            const auto &entry = pad->data[slot];
+            log_presses(VC_PAD_MASK | slot, id, entry, press_bits(entry), 0);
+        }
+    }
+    m_gamepads.clear(); /* Keeps the memory for pads which come back */
+    std::fill(std::begin(m_gamepad_index), std::end(m_gamepad_index), HOLDER_NO_PAD);
+    m_version++;
+}
+
+void element_data_holder::clear_gamepad(const uint8_t gamepad)
+{
+    const auto pad = find_gamepad(gamepad);
+    if (!pad || !pad->count)
+        return;
+    for (auto slot = 0; slot < HOLDER_PAGE_SIZE; slot++) {
+        auto &entry = pad->data[slot];
+        if (entry.valid()) {
+            log_presses(VC_PAD_MASK | slot, gamepad, entry, press_bits(entry), 0);
+            entry = element_data();
+        }
+    }
+    pad->count = 0;
+    m_version++;
+}
+
+void element_data_holder::copy_from(const element_data_holder &other)
+{
+    copy_button_data(other);
+    copy_gamepads(other);
+    m_last_input = other.m_last_input;
+
+    /* Only copies the events that were added since the last copy, unless the other holder was reset */
+    auto index = m_press_count <= other.m_press_count ? m_press_count : 0;
+    if (other.m_press_count - index > HOLDER_PRESS_LOG)
+        index = other.m_press_count - HOLDER_PRESS_LOG;
+    for (; index < other.m_press_count; index++)
+        m_presses[index % HOLDER_PRESS_LOG] = other.m_presses[index % HOLDER_PRESS_LOG];
+    m_press_count = other.m_press_count;
+    m_press_epoch = other.m_press_epoch;
+}
+
+void element_data_holder::copy_button_data(const element_data_holder &other)
+{
+    if (!m_button_count && !other.m_button_count)
+        return;
+
+    std::copy(std::begin(other.m_button_data), std::end(other.m_button_data), std::begin(m_button_data));
+    m_button_count = other.m_button_count;
+    m_last_input = UTIL_MAX(m_last_input, other.m_last_input);
+    m_version++;
+}
+
+void element_data_holder::copy_gamepad_data(const element_data_holder &other)
+{
+    copy_gamepads(other);
+
+    /* The other holder has its own log, so only the events since the last copy are added to this one */
+    auto index = m_imported_presses;
+    if (other.m_press_count < index || other.m_press_count - index > HOLDER_PRESS_LOG) {
+        m_press_epoch++;
+        index = other.m_press_count;
+    }
+    for (; index < other.m_press_count; index++)
+        add_press(other.m_presses[index % HOLDER_PRESS_LOG]);
+    m_imported_presses = other.m_press_count;
+}
+
+void element_data_holder::copy_gamepads(const element_data_holder &other)
+{
+    if (!m_gamepads.empty() || !other.m_gamepads.empty()) {
+        /* Only allocates if the other holder has more pads than this one had so far */
+        m_gamepads = other.m_gamepads;
+        std::copy(std::begin(other.m_gamepad_index), std::end(other.m_gamepad_index), std::begin(m_gamepad_index));
+        m_version++;
+    }
+    m_last_input = UTIL_MAX(m_last_input, other.m_last_input);
 }
 
 bool element_data_holder::is_local() const
@@ -110,114 +410,57 @@ bool element_data_holder::is_local() const
     return m_local;
 }
 
-bool inline is_new_key(const std::vector<uint16_t> &vec, uint16_t vc)
-{
-    for (const auto &k : vec)
-        if (k == vc)
-            return false;
-    return true;
-}
-
-void element_data_holder::populate_vector(std::vector<uint16_t> &vec, sources::history_settings* settings)
-{
-    for (const auto &data : m_button_data) {
-        if (!data.second)
-            continue;
-        /* Mouse data is persistent and shouldn't be included
-         * Any mouse buttons should only be included if enabled
-         * MOUSE_DATA is only used in mouse movement, so it'll
-         * always be excluded
-         */
-        if (data.first == VC_MOUSE_DATA)
-            continue;
-        if ((data.first >> 8) == (VC_MOUSE_MASK >> 8) && !(settings->flags & (int) sources::history_flags::INCLUDE_MOUSE))
-            continue;
-
-        if (data.second->get_type() == ET_BUTTON) {
-            if (dynamic_cast<element_data_button*>(data.second.get())->get_state() == BS_RELEASED)
-                continue;
-        } else if (data.second->get_type() == ET_WHEEL) {
-            auto* wheel = dynamic_cast<element_data_wheel*>(data.second.get());
-            if (wheel) {
-                if (wheel->get_dir() == DIR_UP && is_new_key(vec, VC_MOUSE_WHEEL_UP))
-                    vec.emplace_back(VC_MOUSE_WHEEL_UP);
-                else if (wheel->get_dir() == DIR_DOWN && is_new_key(vec, VC_MOUSE_WHEEL_DOWN))
-                    vec.emplace_back(VC_MOUSE_WHEEL_DOWN);
-                if (wheel->get_state() == BS_PRESSED && is_new_key(vec, VC_MOUSE_WHEEL))
-                    vec.emplace_back(VC_MOUSE_WHEEL);
-                continue;
+void element_data_holder::get_pressed(std::vector<press_event> &vec) const
+{
+    press_event event;
+    event.pressed = true;
+
+    for (auto slot = 0; slot < HOLDER_BUTTON_SLOTS && m_button_count; slot++) {
+        const auto bits = press_bits(m_button_data[slot]);
+        for (auto bit = 0; bits >> bit; bit++) {
+            if ((bits >> bit) & 1) {
+                event.keycode = press_code(m_button_data[slot], slot_to_code(slot), bit);
+                vec.emplace_back(event);
             }
         }
+    }
 
-        if (is_new_key(vec, data.first)) /* if not add it */
-            vec.emplace_back(data.first);
-    }
-
-    /* Same procedure for the gamepad */
-    if (settings->flags & (int) sources::history_flags::INCLUDE_PAD) {
-        for (const auto &data : m_gamepad_data[settings->target_gamepad]) {
-            auto add = true;
-            auto code = data.first;
-            element_data_analog_stick* stick = nullptr;
-            element_data_button* button = nullptr;
-            element_data_trigger* trigger = nullptr;
-
-            if (data.second) {
-                switch (data.second->get_type()) {
-                    case ET_BUTTON:
-                        button = dynamic_cast<element_data_button*>(data.second.get());
-                        if (button && button->get_state() == BS_RELEASED)
-                            continue;
-                        break;
-                    case ET_ANALOG_STICK:
-                        stick = dynamic_cast<element_data_analog_stick*>(data.second.get());
-                        if (stick) {
-                            if (stick->left_pressed() && is_new_key(vec, VC_PAD_L_ANALOG))
-                                vec.emplace_back(VC_PAD_L_ANALOG);
-
-                            if (stick->right_pressed() && is_new_key(vec, VC_PAD_R_ANALOG))
-                                vec.emplace_back(VC_PAD_R_ANALOG);
-                            add = false;
-                        }
-                        break;
-                    case ET_TRIGGER:
-                        trigger = dynamic_cast<element_data_trigger*>(data.second.get());
-
-                        if (trigger) {
-                            if (trigger->get_left() > TRIGGER_THRESHOLD && is_new_key(vec, VC_PAD_LT))
-                                vec.emplace_back(VC_PAD_LT);
-
-                            if (trigger->get_right() > TRIGGER_THRESHOLD && is_new_key(vec, VC_PAD_RT))
-                                vec.emplace_back(VC_PAD_RT);
-                            add = false;
-                        }
-                }
-            }
-
-            if (add && is_new_key(vec, code)) {
-                switch (code) {
-                    case VC_STICK_DATA:
-                    case VC_TRIGGER_DATA:
-                    case VC_DPAD_DATA:
-                        break;
-                    default:
-                        vec.emplace_back(code);
+    for (auto id = 0; id < HOLDER_PAD_IDS; id++) {
+        const auto pad = find_gamepad(id);
+        event.gamepad = id;
+        for (auto slot = 0; pad && pad->count && slot < HOLDER_PAGE_SIZE; slot++) {
+            const auto bits = press_bits(pad->data[slot]);
+            for (auto bit = 0; bits >> bit; bit++) {
+                if ((bits >> bit) & 1) {
+                    event.keycode = press_code(pad->data[slot], VC_PAD_MASK | slot, bit);
+                    vec.emplace_back(event);
                 }
             }
         }
     }
-    /* Sort the vector, so keycombinations are always displayed the same way
-     * Sorting is done in reverse so modifier keys like shift are at the
-     * beginning */
-    std::sort(vec.rbegin(), vec.rend());
 }
 
-bool element_data_holder::data_exists(const uint16_t keycode)
+uint64_t element_data_holder::get_press_count() const
+{
+    return m_press_count;
+}
+
+const press_event* element_data_holder::get_press(const uint64_t index) const
 {
-    if (is_empty())
-        return false;
+    if (index >= m_press_count || m_press_count - index > HOLDER_PRESS_LOG)
+        return nullptr;
+    return &m_presses[index % HOLDER_PRESS_LOG];
+}
 
-    return m_button_data[keycode] != nullptr;
+uint64_t element_data_holder::get_press_epoch() const
+{
+    return m_press_epoch;
+}
+
+bool element_data_holder::data_exists(const uint16_t keycode) const
+{
+    const auto slot = button_slot(keycode);
+    return slot != HOLDER_INVALID_SLOT && m_button_data[slot].valid();
 }
 
 uint64_t element_data_holder::get_last_input() const
@@ -225,18 +468,31 @@ uint64_t element_data_holder::get_last_input() const
     return m_last_input;
 }
 
+void element_data_holder::set_last_input(const uint64_t ns)
+{
+    m_last_input = ns;
+}
+
+uint64_t element_data_holder::get_version() const
+{
+    return m_version;
+}
+
 void element_data_holder::remove_data(const uint16_t keycode)
 {
     if (data_exists(keycode)) {
-        m_button_data[keycode].reset();
-        m_button_data.erase(keycode);
+        auto &entry = m_button_data[button_slot(keycode)];
+        log_presses(keycode, HOLDER_NO_PAD, entry, press_bits(entry), 0);
+        entry = element_data();
+        m_button_count--;
+        m_version++;
     }
 }
 
-element_data* element_data_holder::get_by_code(const uint16_t keycode)
+const element_data* element_data_holder::get_by_code(const uint16_t keycode) const
 {
-    if (!data_exists(keycode))
+    const auto slot = button_slot(keycode);
+    if (slot == HOLDER_INVALID_SLOT || !m_button_data[slot].valid())
         return nullptr;
-
-    return m_button_data[keycode].get();
+    return &m_button_data[slot];
 }
@@ -7,15 +7,29 @@
 
 #pragma once
 
-#include "element.hpp"
-#include <map>
-#include <memory>
+#include "element_data.hpp"
+#include "../util.hpp"
+#include "../layout_constants.hpp"
 #include <vector>
 
-namespace sources
+/* uiohook only uses a few of the 256 possible upper keycode bytes
+ * so each of those gets one page of 256 slots in the state table */
+#define HOLDER_PAGE_SIZE    256
+#define HOLDER_PAGE_COUNT   7
+#define HOLDER_BUTTON_SLOTS (HOLDER_PAGE_SIZE * HOLDER_PAGE_COUNT)
+#define HOLDER_INVALID_SLOT -1
+#define HOLDER_PAD_IDS      256 /* Gamepad ids are one byte */
+#define HOLDER_NO_PAD       -1
+#define HOLDER_PRESS_LOG    256 /* Press events kept for input history, enough for a few video frames */
+
+/* Something input history shows was pressed or released. Sticks, triggers and the
+ * wheel are logged with the keycode history uses for them (VC_PAD_L_ANALOG etc.) */
+struct press_event
 {
-    struct history_settings;
-}
+    uint16_t keycode = 0;
+    int16_t gamepad = HOLDER_NO_PAD; /* Pad the keycode belongs to or HOLDER_NO_PAD */
+    bool pressed = false;
+};
 
 /* Holds all input data for connected clients
  * and/or the local computer
@@ -25,23 +39,35 @@ class element_data_holder
 public:
     element_data_holder(bool is_local = true);
 
-    ~element_data_holder();
+    /* Data is merged into existing data of the same type */
+    void add_data(uint16_t keycode, const element_data &data);
+
+    /* Typed setters update existing data in place, use these for frequent events */
+    void set_button(uint16_t keycode, button_state state);
+
+    void set_mouse_pos(int16_t x, int16_t y);
+
+    /* Mouse movement elements show the movement from (from_x, from_y) instead of the last position */
+    void set_mouse_motion(int16_t from_x, int16_t from_y, int16_t x, int16_t y);
 
-    void add_data(uint16_t keycode, element_data* data);
+    /* Moves mouse movement elements back to the center, call it whenever the mouse didn't move */
+    void stop_mouse_motion();
 
-    bool data_exists(uint16_t keycode);
+    bool data_exists(uint16_t keycode) const;
 
     void remove_data(uint16_t keycode);
 
-    element_data* get_by_code(uint16_t keycode);
+    const element_data* get_by_code(uint16_t keycode) const;
 
-    void add_gamepad_data(uint8_t gamepad, uint16_t keycode, element_data* data);
+    void add_gamepad_data(uint8_t gamepad, uint16_t keycode, const element_data &data);
 
-    bool gamepad_data_exists(uint8_t gamepad, uint16_t keycode);
+    void set_gamepad_button(uint8_t gamepad, uint16_t keycode, button_state state);
+
+    bool gamepad_data_exists(uint8_t gamepad, uint16_t keycode) const;
 
     void remove_gamepad_data(uint8_t gamepad, uint16_t keycode);
 
-    element_data* get_by_gamepad(uint8_t gamepad, uint16_t keycode);
+    const element_data* get_by_gamepad(uint8_t gamepad, uint16_t keycode) const;
 
     void clear_data();
 
@@ -49,18 +75,95 @@ public:
 
     void clear_gamepad_data();
 
-    void populate_vector(std::vector<uint16_t> &vec, sources::history_settings* settings);
+    /* Releases and removes everything of one pad, e.g. after it was unplugged */
+    void clear_gamepad(uint8_t gamepad);
+
+    /* Replaces all data with a copy of the other holder */
+    void copy_from(const element_data_holder &other);
+
+    void copy_button_data(const element_data_holder &other);
+
+    /* Also appends the press events of the other holder which weren't copied yet */
+    void copy_gamepad_data(const element_data_holder &other);
+
+    /* Adds a press event for everything that is currently pressed. Used by
+     * input history whenever it can't follow the press log */
+    void get_pressed(std::vector<press_event> &vec) const;
+
+    /* Number of press events logged so far, the newest one has the index count - 1 */
+    uint64_t get_press_count() const;
+
+    /* nullptr if the event with that index was overwritten or doesn't exist yet */
+    const press_event* get_press(uint64_t index) const;
+
+    /* Changes if events were lost, readers of the log have to start over with get_pressed() */
+    uint64_t get_press_epoch() const;
 
     bool is_empty() const;
 
     bool is_local() const;
 
     uint64_t get_last_input() const;
+
+    /* Replaces the time of the last input, for hooks which
+     * know when it happened instead of when it was applied */
+    void set_last_input(uint64_t ns);
+
+    /* Changes every time the data is modified, used
+     * by sources to skip work if nothing changed */
+    uint64_t get_version() const;
 private:
+    /* Slot of a keycode in m_button_data or HOLDER_INVALID_SLOT */
+    static int button_slot(uint16_t keycode);
+
+    /* Slot of a keycode in the data of a gamepad or HOLDER_INVALID_SLOT,
+     * all gamepad keycodes share the upper byte of VC_PAD_MASK */
+    static int gamepad_slot(uint16_t keycode);
+
+    static uint16_t slot_to_code(int slot);
+
+    /* One bit for each keycode history uses for the data, see press_code() */
+    static uint8_t press_bits(const element_data &data);
+
+    static uint16_t press_code(const element_data &data, uint16_t keycode, int bit);
+
+    /* Logs the bits that changed between before and after */
+    void log_presses(uint16_t keycode, int16_t gamepad, const element_data &data, uint8_t before, uint8_t after);
+
+    void add_press(const press_event &event);
+
+    void copy_gamepads(const element_data_holder &other);
+
     /* Used to check if new inputs happened
      * in input history */
     uint64_t m_last_input = 0;
+    uint64_t m_version = 0;
     bool m_local; /* True if this holds the data for the local pc */
-    std::map<uint16_t, std::unique_ptr<element_data>> m_button_data;
-    std::map<uint16_t, std::unique_ptr<element_data>> m_gamepad_data[4];
+    uint16_t m_button_count = 0;
+    /* Unused slots hold invalid data */
+    element_data m_button_data[HOLDER_BUTTON_SLOTS];
+
+    /* Data of one gamepad, only pads which received any data have one */
+    struct gamepad_page
+    {
+        uint16_t count = 0;
+        element_data data[HOLDER_PAGE_SIZE];
+    };
+
+    /* nullptr if the pad doesn't have any data */
+    gamepad_page* find_gamepad(uint8_t gamepad);
+
+    const gamepad_page* find_gamepad(uint8_t gamepad) const;
+
+    gamepad_page &add_gamepad(uint8_t gamepad);
+
+    /* Index of each gamepad id in m_gamepads or HOLDER_NO_PAD */
+    int16_t m_gamepad_index[HOLDER_PAD_IDS];
+    std::vector<gamepad_page> m_gamepads;
+
+    /* Ring of the last HOLDER_PRESS_LOG press events */
+    press_event m_presses[HOLDER_PRESS_LOG];
+    uint64_t m_press_count = 0;
+    uint64_t m_press_epoch = 0;
+    uint64_t m_imported_presses = 0; /* Press count of the holder copy_gamepad_data() last copied */
 };
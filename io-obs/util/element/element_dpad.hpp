@@ -9,41 +9,15 @@
 
 #include "element_texture.hpp"
 
-class element_data_dpad : public element_data
-{
-public:
-    /*
-        Separate constructors are used on linux
-        because the values can't be queried together
-    */
-
-    /* Xinput directly generates direction */
-    element_data_dpad(dpad_direction a, dpad_direction b);
-
-    element_data_dpad(dpad_direction d, button_state state);
-
-    bool is_persistent() override;
-
-    bool merge(element_data* other) override;
-
-    dpad_texture get_direction() const;
-
-    button_state get_state() const;
-
-private:
-    uint16_t m_direction;
-    button_state m_state;
-};
-
 class element_dpad : public element_texture
 {
 public:
     element_dpad();
 
-    void load(ccl_config* cfg, const std::string &id) override;
+    void load(const element_record* record) override;
 
     void
-    draw(gs_effect_t* effect, gs_image_file_t* image, element_data* data, sources::overlay_settings* settings) override;
+    draw(sprite_batch* batch, const element_data* data, sources::overlay_settings* settings) override;
 
     data_source get_source() override;
 
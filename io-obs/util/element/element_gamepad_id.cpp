@@ -6,19 +6,19 @@
  */
 
 #include "../../sources/input_source.hpp"
-#include "../../../ccl/ccl.hpp"
+#include "../layout_file.hpp"
 #include "element_gamepad_id.hpp"
 #include "util/layout_constants.hpp"
-#include "element_button.hpp"
+#include "element_data.hpp"
 
 element_gamepad_id::element_gamepad_id() : element_texture(ET_GAMEPAD_ID), m_mappings{}
 {
     m_keycode = VC_PAD_GUIDE;
 }
 
-void element_gamepad_id::load(ccl_config* cfg, const std::string &id)
+void element_gamepad_id::load(const element_record* record)
 {
-    element_texture::load(cfg, id);
+    element_texture::load(record);
     auto i = 1;
     for (auto &map : m_mappings) {
         map = m_mapping;
@@ -26,20 +26,20 @@ void element_gamepad_id::load(ccl_config* cfg, const std::string &id)
     }
 }
 
-void element_gamepad_id::draw(gs_effect_t* effect, gs_image_file_t* image, element_data* data,
-                              sources::overlay_settings* settings)
+void element_gamepad_id::draw(sprite_batch* batch, const element_data* data, sources::overlay_settings* settings)
 {
     if (data) {
-        const auto d = dynamic_cast<element_data_button*>(data);
+        const auto d = data->button();
         if (d && (int) d->get_state()) {
-            element_texture::draw(effect, image, &m_mappings[ID_PRESSED]);
+            element_texture::draw(batch, &m_mappings[ID_PRESSED]);
         }
     }
 
-    if (settings->gamepad > 0) {
-        element_texture::draw(effect, image, &m_mappings[settings->gamepad - 1]);
+    const auto player = settings->gamepad % ID_PLAYERS;
+    if (player > 0) {
+        element_texture::draw(batch, &m_mappings[player - 1]);
     } else {
-        element_texture::draw(effect, image, &m_mapping);
+        element_texture::draw(batch, &m_mapping);
     }
 }
 
@@ -47,3 +47,8 @@ data_source element_gamepad_id::get_source()
 {
     return DS_GAMEPAD;
 }
+
+uint8_t element_gamepad_id::get_quad_count() const
+{
+    return 2;
+}
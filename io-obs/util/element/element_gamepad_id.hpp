@@ -10,19 +10,22 @@
 #include "element_texture.hpp"
 
 #define ID_PRESSED 3
+#define ID_PLAYERS 4 /* Layouts have a texture for each of them, higher ids reuse them */
 
 class element_gamepad_id : public element_texture
 {
 public:
     element_gamepad_id();
 
-    void load(ccl_config* cfg, const std::string &id) override;
+    void load(const element_record* record) override;
 
     void
-    draw(gs_effect_t* effect, gs_image_file_t* image, element_data* data, sources::overlay_settings* settings) override;
+    draw(sprite_batch* batch, const element_data* data, sources::overlay_settings* settings) override;
 
     data_source get_source() override;
 
+    uint8_t get_quad_count() const override;
+
 private:
     /* 0 - 2 Player 2 - 4 (Player 1 is default)
      * 3     Middle pressed down
@@ -6,65 +6,38 @@
  */
 
 #include "../../sources/input_source.hpp"
-#include "../../../ccl/ccl.hpp"
+#include "../layout_file.hpp"
 #include "element_mouse_movement.hpp"
+#include "element_data.hpp"
 #include "util/layout_constants.hpp"
 #include "util/util.hpp"
 
-void element_mouse_movement::load(ccl_config* cfg, const std::string &id)
+void element_mouse_movement::load(const element_record* record)
 {
-    element_texture::load(cfg, id);
+    element_texture::load(record);
     m_keycode = VC_MOUSE_DATA;
-    m_radius = cfg->get_int(id + CFG_MOUSE_RADIUS);
-    m_movement_type = cfg->get_int(id + CFG_MOUSE_TYPE) == 0 ? MM_DOT : MM_ARROW;
+    m_radius = record->radius;
+    m_movement_type = (record->flags & LR_MOUSE_ARROW) ? MM_ARROW : MM_DOT;
 }
 
-void element_mouse_movement::draw(gs_effect_t* effect, gs_image_file_t* image, element_data* data,
-                                  sources::overlay_settings* settings)
+void element_mouse_movement::draw(sprite_batch* batch, const element_data* data, sources::overlay_settings* settings)
 {
-    if (data && data->get_type() == ET_MOUSE_STATS) {
-        const auto element_data = dynamic_cast<element_data_mouse_pos*>(data);
-
-        if (element_data) {
-            if (m_movement_type == MM_ARROW) {
-                element_texture::draw(effect, image, &m_mapping, &m_pos, element_data->get_mouse_angle(settings));
-            } else {
-                element_data->get_mouse_offset(settings, m_pos, m_offset_pos, m_radius);
-                element_texture::draw(effect, image, &m_mapping, &m_offset_pos);
-            }
+    const auto mouse = data ? data->mouse_pos() : nullptr;
+
+    if (mouse) {
+        if (m_movement_type == MM_ARROW) {
+            m_angle = mouse->get_mouse_angle(settings, m_angle);
+            element_texture::draw(batch, &m_mapping, &m_pos, m_angle);
+        } else {
+            mouse->get_mouse_offset(settings, m_pos, m_offset_pos, m_radius);
+            element_texture::draw(batch, &m_mapping, &m_offset_pos);
         }
     } else {
-        element_texture::draw(effect, image, &m_mapping, &m_pos);
-    }
-}
-
-element_data_mouse_pos::element_data_mouse_pos(const int16_t x, const int16_t y) :
-    element_data(ET_MOUSE_STATS)
-{
-    m_x = x;
-    m_y = y;
-}
-
-bool element_data_mouse_pos::is_persistent()
-{
-    return true;
-}
-
-bool element_data_mouse_pos::merge(element_data *other)
-{
-    if (other) {
-        element_data_mouse_pos* pos = dynamic_cast<element_data_mouse_pos*>(other);
-        if (pos) {
-            m_last_x = m_x;
-            m_last_y = m_x;
-            m_x = pos->m_x;
-            m_y = pos->m_y;
-        }
+        element_texture::draw(batch, &m_mapping, &m_pos);
     }
-    return false;
 }
 
-float element_data_mouse_pos::get_mouse_angle(sources::overlay_settings* settings)
+float element_data_mouse_pos::get_mouse_angle(sources::overlay_settings* settings, const float old_angle) const
 {
     auto d_x = 0, d_y = 0;
 
@@ -79,10 +52,9 @@ float element_data_mouse_pos::get_mouse_angle(sources::overlay_settings* setting
     const float new_angle = (0.5 * M_PI) + (atan2f(d_y, d_x));
     if (abs(d_x) < settings->mouse_deadzone || abs(d_y) < settings->mouse_deadzone) {
         /* Draw old angle (new movement was to minor) */
-        return m_old_angle;
+        return old_angle;
     }
 
-    m_old_angle = new_angle;
     return new_angle;
 }
 
@@ -112,16 +84,6 @@ void element_data_mouse_pos::get_mouse_offset(sources::overlay_settings* setting
 
 }
 
-int16_t element_data_mouse_pos::get_mouse_x() const
-{
-    return m_x;
-}
-
-int16_t element_data_mouse_pos::get_mouse_y() const
-{
-    return m_y;
-}
-
 element_mouse_movement::element_mouse_movement() :
     element_texture(ET_MOUSE_STATS), m_movement_type()
 {
@@ -14,50 +14,20 @@
 #define WHEEL_MAP_UP      1
 #define WHEEL_MAP_DOWN    2
 
-enum wheel_data
-{
-    WD_BOTH, WD_BUTTON, WD_WHEEL
-};
-
-class element_data_wheel : public element_data
-{
-public:
-    element_data_wheel(direction dir, button_state state);
-
-    explicit element_data_wheel(direction dir);
-
-    explicit element_data_wheel(button_state state);
-
-    direction get_dir() const;
-
-    void set_dir(direction dir);
-
-    button_state get_state() const;
-
-    bool is_persistent() override;
-
-    bool merge(element_data* other) override;
-
-    wheel_data get_data_type() const;
-
-private:
-    wheel_data m_data_type;
-    button_state m_middle_button;
-    direction m_dir;
-};
-
 class element_wheel : public element_texture
 {
 public:
     element_wheel();
 
-    void load(ccl_config* cfg, const std::string &id) override;
+    void load(const element_record* record) override;
 
     void
-    draw(gs_effect_t* effect, gs_image_file_t* image, element_data* data, sources::overlay_settings* settings) override;
+    draw(sprite_batch* batch, const element_data* data, sources::overlay_settings* settings) override;
 
     data_source get_source() override;
 
+    uint8_t get_quad_count() const override;
+
 private:
     /* Middle, Up, Down */
     gs_rect m_mappings[3];
@@ -16,16 +16,18 @@ public:
 
     explicit element_texture(element_type type);
 
-    void load(ccl_config* cfg, const std::string &id) override;
+    void load(const element_record* record) override;
 
     void
-    draw(gs_effect_t* effect, gs_image_file_t* image, element_data* data, sources::overlay_settings* settings) override;
+    draw(sprite_batch* batch, const element_data* data, sources::overlay_settings* settings) override;
 
-    void draw(gs_effect_t* effect, gs_image_file_t* image, const gs_rect* rect) const;
+    void draw(sprite_batch* batch, const gs_rect* rect) const;
 
-    static void draw(gs_effect_t* effect, gs_image_file_t* image, const gs_rect* rect, const vec2* pos);
+    static void draw(sprite_batch* batch, const gs_rect* rect, const vec2* pos);
 
-    static void draw(gs_effect* effect, gs_image_file_t* image, const gs_rect* rect, const vec2* pos, float angle);
+    static void draw(sprite_batch* batch, const gs_rect* rect, const vec2* pos, float angle);
+
+    uint8_t get_quad_count() const override;
 
     data_source get_source() override;
 };
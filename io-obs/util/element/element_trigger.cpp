@@ -6,8 +6,9 @@
  */
 
 #include "../../sources/input_source.hpp"
-#include "../../../ccl/ccl.hpp"
+#include "../layout_file.hpp"
 #include "element_trigger.hpp"
+#include "element_data.hpp"
 #include "../util.hpp"
 #include "util/layout_constants.hpp"
 
@@ -15,26 +16,25 @@ element_trigger::element_trigger() : element_texture(ET_TRIGGER)
 {
 }
 
-void element_trigger::load(ccl_config* cfg, const std::string &id)
+void element_trigger::load(const element_record* record)
 {
-    element_texture::load(cfg, id);
-    m_button_mode = cfg->get_bool(id + CFG_TRIGGER_MODE);
-    m_side = static_cast<element_side>(cfg->get_int(id + CFG_SIDE));
+    element_texture::load(record);
+    m_button_mode = (record->flags & LR_TRIGGER_BUTTON_MODE) != 0;
+    m_side = static_cast<element_side>(record->side);
     m_keycode = VC_TRIGGER_DATA;
     m_pressed = m_mapping;
     m_pressed.y = m_mapping.y + m_mapping.cy + CFG_INNER_BORDER;
     if (!m_button_mode) {
-        m_direction = static_cast<direction>(cfg->get_int(id + CFG_DIRECTION));
+        m_direction = static_cast<direction>(record->direction);
     }
 }
 
-void element_trigger::draw(gs_effect_t* effect, gs_image_file_t* image, element_data* data,
-                           sources::overlay_settings* settings)
+void element_trigger::draw(sprite_batch* batch, const element_data* data, sources::overlay_settings* settings)
 {
     UNUSED_PARAMETER(settings);
 
     if (data) {
-        const auto trigger = dynamic_cast<element_data_trigger*>(data);
+        const auto trigger = data->trigger();
         auto progress = 0.f;
         if (trigger) {
             switch (m_side) {
@@ -49,20 +49,20 @@ void element_trigger::draw(gs_effect_t* effect, gs_image_file_t* image, element_
 
             if (m_button_mode) {
                 if (progress >= 0.1) {
-                    element_texture::draw(effect, image, &m_pressed);
+                    element_texture::draw(batch, &m_pressed);
                 } else {
-                    element_texture::draw(effect, image, &m_mapping);
+                    element_texture::draw(batch, &m_mapping);
                 }
             } else {
                 auto crop = m_pressed;
                 auto new_pos = m_pos;
                 calculate_mapping(&crop, &new_pos, progress);
-                element_texture::draw(effect, image, &m_mapping); /* Draw unpressed first */
-                element_texture::draw(effect, image, &crop, &new_pos);
+                element_texture::draw(batch, &m_mapping); /* Draw unpressed first */
+                element_texture::draw(batch, &crop, &new_pos);
             }
         }
     } else {
-        element_texture::draw(effect, image, nullptr);
+        element_texture::draw(batch, nullptr);
     }
 }
 
@@ -71,6 +71,11 @@ data_source element_trigger::get_source()
     return DS_GAMEPAD;
 }
 
+uint8_t element_trigger::get_quad_count() const
+{
+    return 2;
+}
+
 void element_trigger::calculate_mapping(gs_rect* pressed, vec2* pos, const float progress) const
 {
     switch (m_direction) {
@@ -92,76 +97,3 @@ void element_trigger::calculate_mapping(gs_rect* pressed, vec2* pos, const float
             break;
     }
 }
-
-element_data_trigger::element_data_trigger(const trigger_data side, const float val) :
-    element_data(ET_TRIGGER)
-{
-    if (side == TD_LEFT)
-        m_left_trigger = val;
-    else
-        m_right_trigger = val;
-    m_data_type = side;
-}
-
-element_data_trigger::element_data_trigger(const float left, const float right) :
-    element_data(ET_TRIGGER)
-{
-    m_left_trigger = left;
-    m_right_trigger = right;
-    m_data_type = TD_BOTH;
-}
-
-float element_data_trigger::get_left() const
-{
-    return m_left_trigger;
-}
-
-float element_data_trigger::get_right() const
-{
-    return m_right_trigger;
-}
-
-bool element_data_trigger::is_persistent()
-{
-    return true;
-}
-
-bool element_data_trigger::merge(element_data* other)
-{
-    if (other && other->get_type() == m_type) {
-        const auto trigger = dynamic_cast<element_data_trigger*>(other);
-
-        if (trigger) {
-            switch (trigger->m_data_type) {
-                case TD_BOTH:
-                    m_left_trigger = trigger->m_left_trigger;
-                    m_right_trigger = trigger->m_right_trigger;
-                    break;
-                case TD_LEFT:
-                    m_left_trigger = trigger->m_left_trigger;
-                    if (m_data_type == TD_RIGHT) /* Left merged with right = now contains both sides */
-                        m_data_type = TD_BOTH;
-                    break;
-                case TD_RIGHT:
-                    m_right_trigger = trigger->m_right_trigger;
-                    if (m_data_type == TD_LEFT) /* Left merged with right = now contains both sides */
-                        m_data_type = TD_BOTH;
-                    break;
-                default:;
-            }
-        }
-    }
-    return false;
-}
-
-element_data_trigger* element_data_trigger::from_buffer(netlib_byte_buf* buffer)
-{
-    uint8_t left, right;
-    if (!netlib_read_uint8(buffer, &left) || !netlib_read_uint8(buffer, &right)) {
-#ifdef _DEBUG
-        blog(LOG_INFO, "Failed to read trigger data: %s", netlib_get_error());
-#endif
-        return nullptr;
-    }
-    return new element_data_trigger(left / TRIGGER_MAX_VAL, right / TRIGGER_MAX_VAL);
-}
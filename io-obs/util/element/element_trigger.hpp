@@ -10,54 +10,19 @@
 #include "element_texture.hpp"
 #include <netlib.h>
 
-enum trigger_data
-{
-    TD_NONE = -1,
-    TD_BOTH,
-    TD_LEFT,
-    TD_RIGHT
-};
-
-/* Contains data for both trigger buttons
- */
-class element_data_trigger : public element_data
-{
-public:
-    /*
-        Separate constructors are used on linux
-        because the values can't be queried together
-    */
-    element_data_trigger(trigger_data side, float val);
-
-    element_data_trigger(float left, float right);
-
-    float get_left() const;
-
-    float get_right() const;
-
-    bool is_persistent() override;
-
-    bool merge(element_data* other) override;
-
-    static element_data_trigger* from_buffer(netlib_byte_buf* buffer);
-
-private:
-    trigger_data m_data_type = TD_BOTH;
-    float m_left_trigger = 0.f, m_right_trigger = 0.f;
-};
-
 class element_trigger : public element_texture
 {
 public:
     element_trigger();
 
-    void load(ccl_config* cfg, const std::string& id) override;
+    void load(const element_record* record) override;
 
-    void draw(gs_effect_t* effect, gs_image_file_t* image,
-        element_data* data, sources::overlay_settings* settings) override;
+    void draw(sprite_batch* batch, const element_data* data, sources::overlay_settings* settings) override;
 
     data_source get_source() override;
 
+    uint8_t get_quad_count() const override;
+
 private:
     void calculate_mapping(gs_rect* pressed, vec2* pos, float progress) const;
     gs_rect m_pressed;
@@ -8,7 +8,6 @@
 #include "input_entry.hpp"
 #include "../../sources/input_history.hpp"
 #include "effect.hpp"
-#include "../element/element_data_holder.hpp"
 #include "key_names.hpp"
 #include "history_icons.hpp"
 #include "network/io_server.hpp"
@@ -65,22 +64,43 @@ void input_entry::set_text(const char* text, sources::history_settings* settings
     }
 }
 
-void input_entry::collect_inputs(sources::history_settings* settings)
-{
-    if (settings->data) {
-        std::lock_guard<std::mutex> lck1(hook::mutex);
-        std::lock_guard<std::mutex> lck2(network::mutex);
-        if (settings->flags & (int) sources::history_flags::INCLUDE_PAD)
-            std::lock_guard<std::mutex> lck3(gamepad::mutex);
-        /* Check if the scroll wheel timed out if the data
-         * is being fetched from the local data holder, since
-         * scroll wheel doesn't have a released event */
-        if (settings->data->is_local())
-            hook::check_wheel();
-        settings->data->populate_vector(m_inputs, settings);
+/* Combinations are shown as Ctrl + Shift + Alt + Meta + the other keys */
+static int modifier_class(const uint16_t vc)
+{
+    switch (vc) {
+        case VC_CONTROL_L:
+        case VC_CONTROL_R:
+            return 0;
+        case VC_SHIFT_L:
+        case VC_SHIFT_R:
+            return 1;
+        case VC_ALT_L:
+        case VC_ALT_R:
+            return 2;
+        case VC_META_L:
+        case VC_META_R:
+            return 3;
+        default:
+            return 4;
     }
 }
 
+void input_entry::add_input(const uint16_t vc)
+{
+    const auto mod = modifier_class(vc);
+    auto pos = m_inputs.end();
+
+    /* Entries only have a few keys, so searching is cheaper than keeping an index */
+    while (pos != m_inputs.begin() && modifier_class(*(pos - 1)) > mod)
+        --pos;
+    m_inputs.insert(pos, vc);
+}
+
+const std::vector<uint16_t> &input_entry::get_inputs() const
+{
+    return m_inputs;
+}
+
 std::string input_entry::build_string(key_names* names, const bool use_fallback)
 {
     static std::string plus = " + ";
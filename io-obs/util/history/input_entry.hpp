@@ -22,8 +22,6 @@ namespace sources
 
 class effect;
 
-class element_data_holder;
-
 class input_entry
 {
     /* Contains all collected inputs in order */
@@ -61,7 +59,11 @@ public:
 
     void set_text(const char* text, sources::history_settings* settings);
 
-    void collect_inputs(sources::history_settings* settings);
+    /* Inserted after all keys of the same or a lower modifier class, so modifiers come
+     * first and everything else stays in the order it was pressed. Doesn't check for duplicates */
+    void add_input(uint16_t vc);
+
+    const std::vector<uint16_t> &get_inputs() const;
 
     void tick(float seconds);
 
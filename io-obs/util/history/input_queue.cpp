@@ -9,6 +9,8 @@
 #include "sources/input_history.hpp"
 #include "icon_handler.hpp"
 #include "text_handler.hpp"
+#include "../element/element_data_holder.hpp"
+#include <algorithm>
 
 void input_queue::init_icon()
 {
@@ -53,6 +55,7 @@ void input_queue::update(const sources::history_mode new_mode)
     }
 
     m_current_handler->update();
+    m_source = nullptr; /* Which inputs are included might have changed */
 }
 
 obs_source_t* input_queue::get_fade_in()
@@ -63,9 +66,77 @@ obs_source_t* input_queue::get_fade_in()
     return h ? h->get_text_source() : nullptr;
 }
 
+void input_queue::resync(const element_data_holder* data)
+{
+    std::vector<press_event> pressed;
+
+    m_source = data;
+    m_press_index = data->get_press_count();
+    m_press_epoch = data->get_press_epoch();
+    for (const auto &key : m_held)
+        m_held_keys.reset(key);
+    m_held.clear();
+    reset_entry(); /* Nothing is held, so this only drops what the entry had so far */
+
+    data->get_pressed(pressed);
+    for (const auto &event : pressed)
+        handle_press(event);
+}
+
+void input_queue::handle_press(const press_event &event)
+{
+    const auto vc = event.keycode;
+    if (event.gamepad != HOLDER_NO_PAD && (!(m_settings->flags & (int) sources::history_flags::INCLUDE_PAD) ||
+                                           event.gamepad != m_settings->target_gamepad))
+        return;
+    if ((vc >> 8) == (VC_MOUSE_MASK >> 8) && !(m_settings->flags & (int) sources::history_flags::INCLUDE_MOUSE))
+        return;
+
+    if (!event.pressed) {
+        if (m_held_keys.test(vc)) {
+            m_held_keys.reset(vc);
+            m_held.erase(std::find(m_held.begin(), m_held.end(), vc));
+        }
+        return;
+    }
+
+    if (!m_held_keys.test(vc)) {
+        m_held_keys.set(vc);
+        m_held.emplace_back(vc);
+    }
+    if (!m_queued_keys.test(vc)) {
+        m_queued_keys.set(vc);
+        m_queued_entry.add_input(vc);
+    }
+}
+
+void input_queue::reset_entry()
+{
+    for (const auto &key : m_queued_entry.get_inputs())
+        m_queued_keys.reset(key);
+    m_queued_entry.clear();
+
+    for (const auto &key : m_held) {
+        m_queued_keys.set(key);
+        m_queued_entry.add_input(key);
+    }
+}
+
 void input_queue::collect_input()
 {
-    m_queued_entry.collect_inputs(m_settings);
+    const auto data = m_settings->data;
+    if (!data)
+        return;
+
+    const auto count = data->get_press_count();
+    if (data != m_source || data->get_press_epoch() != m_press_epoch || count < m_press_index ||
+        count - m_press_index > HOLDER_PRESS_LOG) {
+        resync(data);
+        return;
+    }
+
+    for (; m_press_index < count; m_press_index++)
+        handle_press(*data->get_press(m_press_index));
 }
 
 void input_queue::swap()
@@ -73,7 +144,7 @@ void input_queue::swap()
     m_handler_mutex.lock();
     if (!m_queued_entry.empty() && m_current_handler) {
         m_current_handler->swap(m_queued_entry);
-        m_queued_entry.clear();
+        reset_entry();
     }
     m_handler_mutex.unlock();
 }
@@ -102,7 +173,7 @@ void input_queue::clear()
     m_handler_mutex.lock();
     if (m_current_handler)
         m_current_handler->clear();
-    m_queued_entry.clear();
+    reset_entry();
     m_height = 50;
     m_width = 50;
     m_handler_mutex.unlock();
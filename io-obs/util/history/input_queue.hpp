@@ -9,9 +9,12 @@
 
 #include "input_entry.hpp"
 #include "sources/input_history.hpp"
+#include <bitset>
 #include <mutex>
 class handler;
 
+struct press_event;
+
 class input_queue
 {
     std::mutex m_handler_mutex; /* Prevents deletion of handlers while rendering */
@@ -21,6 +24,21 @@ class input_queue
     input_entry m_queued_entry;
     handler* m_current_handler = nullptr;
 
+    /* The queued entry is built from the press log of the input data, so collecting only costs as much
+     * as the amount of new presses. Keys which are still held are added to every new entry */
+    const element_data_holder* m_source = nullptr; /* Input data the log position belongs to */
+    uint64_t m_press_index = 0, m_press_epoch = 0;
+    std::vector<uint16_t> m_held; /* In the order they were pressed */
+    std::bitset<0x10000> m_held_keys, m_queued_keys; /* Keycodes in m_held and m_queued_entry */
+
+    /* Starts over with whatever is pressed right now */
+    void resync(const element_data_holder* data);
+
+    void handle_press(const press_event &event);
+
+    /* Clears the queued entry and adds all held keys to it */
+    void reset_entry();
+
     /* Prepare/free the respective display modes */
     void init_icon();
 
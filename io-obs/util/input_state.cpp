@@ -0,0 +1,75 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#include "input_state.hpp"
+#include "element/element_data_holder.hpp"
+#include "../hook/hook_helper.hpp"
+#include "../network/io_server.hpp"
+#include "../network/remote_connection.hpp"
+#include <obs-module.h>
+
+namespace input_state
+{
+    static uint64_t last_frame = 0;
+
+    static void tick(void* data, float seconds)
+    {
+        UNUSED_PARAMETER(data);
+        UNUSED_PARAMETER(seconds);
+        sync();
+    }
+
+    void start()
+    {
+        obs_add_tick_callback(tick, nullptr);
+    }
+
+    void stop()
+    {
+        obs_remove_tick_callback(tick, nullptr);
+    }
+
+    void sync()
+    {
+        const auto frame = obs_get_video_frame_time();
+        if (frame == last_frame)
+            return;
+        last_frame = frame;
+
+        {
+            std::lock_guard<std::mutex> lck(hook::mutex);
+            if (hook::data_initialized)
+                hook::drain_events();
+        }
+
+        /* Remote clients publish their data without any lock */
+        if (network::server_instance)
+            network::server_instance->sync_clients();
+    }
+
+    element_data_holder* get(const uint8_t source_id)
+    {
+        if (source_id == 0)
+            return hook::data_initialized ? hook::input_data : nullptr;
+
+        if (!network::network_flag || !network::server_instance)
+            return nullptr;
+
+        const auto client = network::server_instance->get_client(source_id - 1);
+        return client ? client->get_data() : nullptr;
+    }
+
+    void mark_drawn(const uint8_t source_id)
+    {
+        if (source_id == 0 || !network::network_flag || !network::server_instance)
+            return;
+
+        const auto client = network::server_instance->get_client(source_id - 1);
+        if (client)
+            client->mark_drawn();
+    }
+}
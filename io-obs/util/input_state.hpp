@@ -0,0 +1,39 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+class element_data_holder;
+
+/* Input data shared by all overlay and history sources.
+ * Local and remote input is brought up to date once per video
+ * frame before any source ticks, afterwards every source reads the
+ * same data directly instead of keeping its own copy. Everything in
+ * here runs on the video thread
+ */
+namespace input_state
+{
+    /* Registers a tick callback, which calls sync() every video frame, even
+     * if no source is showing or input is blocked. Otherwise the hook's event
+     * queue would fill up and the events would be applied seconds later */
+    void start();
+
+    void stop();
+
+    /* Only the first call in a video frame does any work */
+    void sync();
+
+    /* Input data for a source, 0 is the local computer and any other
+     * id is the remote client with id - 1. Returns nullptr if the source
+     * doesn't exist. Stays valid until the next video frame */
+    element_data_holder* get(uint8_t source_id);
+
+    /* Called after a source drew the input data of source_id, used to measure latency */
+    void mark_drawn(uint8_t source_id);
+}
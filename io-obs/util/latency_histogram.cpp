@@ -0,0 +1,35 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#include "latency_histogram.hpp"
+
+void latency_histogram::record(const uint64_t ns)
+{
+    const auto ms = ns / (1000 * 1000);
+    const auto bucket = ms < LATENCY_BUCKETS ? ms : LATENCY_BUCKETS - 1;
+
+    m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+int latency_histogram::percentile(const double fraction) const
+{
+    const auto total = count();
+    if (!total)
+        return -1;
+
+    /* Rank of the sample we're looking for, starting at one */
+    const auto rank = static_cast<uint32_t>(fraction * (total - 1)) + 1;
+    uint32_t sum = 0;
+
+    for (auto i = 0; i < LATENCY_BUCKETS; i++) {
+        sum += m_buckets[i].load(std::memory_order_relaxed);
+        if (sum >= rank)
+            return i;
+    }
+    return LATENCY_BUCKETS - 1;
+}
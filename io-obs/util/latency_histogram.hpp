@@ -0,0 +1,35 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+#define LATENCY_BUCKETS 500 /* One bucket per millisecond, the last one also counts everything above */
+
+/* Counts latency samples in millisecond buckets. Samples are recorded
+ * on the video thread and read from any other, so all counters are
+ * atomic, but a read during a record can be off by that one sample
+ */
+class latency_histogram
+{
+public:
+    void record(uint64_t ns);
+
+    /* Latency in ms below which the given fraction of samples lies, -1 without any samples */
+    int percentile(double fraction) const;
+
+    uint32_t count() const
+    {
+        return m_count.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint32_t> m_buckets[LATENCY_BUCKETS] = {};
+    std::atomic<uint32_t> m_count{0};
+};
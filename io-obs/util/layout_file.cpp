@@ -0,0 +1,272 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#include "layout_file.hpp"
+#include "layout_constants.hpp"
+#include "util.hpp"
+#include "../../ccl/ccl.hpp"
+#include <util/platform.h>
+#include <util/bmem.h>
+#include <sys/stat.h>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static bool read_record(ccl_config &cfg, const std::string &id, element_record &record, const bool debug)
+{
+    record.type = static_cast<int16_t>(cfg.get_int(id + CFG_TYPE));
+
+    const auto pos = cfg.get_point(id + CFG_POS);
+    const auto map = cfg.get_rect(id + CFG_MAPPING);
+    record.pos_x = pos.x;
+    record.pos_y = pos.y;
+    record.map_x = map.x;
+    record.map_y = map.y;
+    record.map_w = map.w;
+    record.map_h = map.h;
+    record.side = ES_INVALID;
+
+    switch (record.type) {
+        case ET_BUTTON:
+            record.keycode = static_cast<uint16_t>(cfg.get_int(id + CFG_KEY_CODE));
+            break;
+        case ET_ANALOG_STICK:
+            record.side = static_cast<int8_t>(cfg.get_int(id + CFG_SIDE));
+            record.radius = static_cast<uint8_t>(cfg.get_int(id + CFG_STICK_RADIUS));
+            break;
+        case ET_TRIGGER:
+            record.side = static_cast<int8_t>(cfg.get_int(id + CFG_SIDE));
+            if (cfg.get_bool(id + CFG_TRIGGER_MODE))
+                record.flags |= LR_TRIGGER_BUTTON_MODE;
+            else
+                record.direction = static_cast<uint8_t>(cfg.get_int(id + CFG_DIRECTION));
+            break;
+        case ET_MOUSE_STATS:
+            record.radius = static_cast<uint8_t>(cfg.get_int(id + CFG_MOUSE_RADIUS));
+            if (cfg.get_int(id + CFG_MOUSE_TYPE) != 0)
+                record.flags |= LR_MOUSE_ARROW;
+            break;
+        case ET_TEXTURE:
+        case ET_WHEEL:
+        case ET_GAMEPAD_ID:
+        case ET_DPAD_STICK:
+            break;
+        default:
+            if (debug)
+                blog(LOG_INFO, "[input-overlay] Invalid element type %i for %s", record.type, id.c_str());
+            return false;
+    }
+    return true;
+}
+
+layout_file::~layout_file()
+{
+    unload();
+}
+
+std::string layout_file::compiled_path(const std::string &ini_path)
+{
+    const auto dot = ini_path.find_last_of('.');
+    const auto slash = ini_path.find_last_of("/\\");
+
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return ini_path + LAYOUT_FILE_EXT;
+    return ini_path.substr(0, dot) + LAYOUT_FILE_EXT;
+}
+
+bool layout_file::load(const std::string &ini_path)
+{
+    unload();
+
+    const auto compiled = compiled_path(ini_path);
+    struct stat info = {};
+
+    /* Compiled layouts can also be selected directly, which
+     * is also used if the .ini they were made from is gone */
+    if (compiled == ini_path || os_stat(ini_path.c_str(), &info) != 0)
+        return map(compiled, -1);
+
+    const int64_t mtime = info.st_mtime;
+    if (map(compiled, mtime))
+        return true;
+
+    if (!compile(ini_path, mtime, m_compiled))
+        return false;
+
+    /* Other layouts from the cache might still have the old file mapped, truncating it would make
+     * their mappings invalid. The new file replaces it instead, so they keep the old one */
+    const auto temp = compiled + ".tmp";
+    const auto file = os_fopen(temp.c_str(), "wb");
+    if (file) {
+        const auto written = fwrite(m_compiled.data(), 1, m_compiled.size(), file) == m_compiled.size();
+        if (fclose(file) != 0 || !written || os_rename(temp.c_str(), compiled.c_str()) != 0) {
+            blog(LOG_WARNING, "[input-overlay] Failed to write compiled layout %s", compiled.c_str());
+            os_unlink(temp.c_str());
+        }
+    } else {
+        blog(LOG_INFO, "[input-overlay] Couldn't save compiled layout to %s, using it from memory",
+             compiled.c_str());
+    }
+
+    return use(m_compiled.data(), m_compiled.size(), mtime);
+}
+
+void layout_file::unload()
+{
+    if (m_mapping) {
+#ifdef _WIN32
+        UnmapViewOfFile(m_mapping);
+        CloseHandle(m_mapping_handle);
+        CloseHandle(m_file_handle);
+        m_mapping_handle = nullptr;
+        m_file_handle = nullptr;
+#else
+        munmap(m_mapping, m_mapping_size);
+#endif
+        m_mapping = nullptr;
+        m_mapping_size = 0;
+    }
+
+    m_compiled.clear();
+    m_header = nullptr;
+    m_records = nullptr;
+}
+
+bool layout_file::compile(const std::string &ini_path, const int64_t mtime, std::vector<uint8_t> &out)
+{
+    ccl_config cfg(ini_path, "");
+    std::vector<element_record> records;
+    layout_header header = {};
+    auto flag = true;
+
+    if (!cfg.has_fatal_errors()) {
+        header.width = static_cast<uint32_t>(cfg.get_int(CFG_TOTAL_WIDTH, true));
+        header.height = static_cast<uint32_t>(cfg.get_int(CFG_TOTAL_HEIGHT, true));
+        header.layout_flags = static_cast<uint8_t>(cfg.get_int(CFG_FLAGS, true));
+        header.debug = cfg.get_bool(CFG_DEBUG_FLAG, true);
+
+#ifndef _DEBUG
+        if (header.debug)
+        {
+#else
+        {
+#endif
+            blog(LOG_INFO, "[input-overlay] Compiling layout %s", ini_path.c_str());
+        }
+
+        auto element_id = cfg.get_string(CFG_FIRST_ID);
+        while (!element_id.empty() && records.size() < UINT16_MAX) {
+            element_record record = {};
+            if (read_record(cfg, element_id, record, header.debug))
+                records.emplace_back(record);
+            element_id = cfg.get_string(element_id + CFG_NEXT_ID, true);
+        }
+    }
+
+    if (cfg.has_errors()) {
+        blog(LOG_WARNING, "[input-overlay] %s", cfg.get_error_message().c_str());
+        if (cfg.has_fatal_errors()) {
+            blog(LOG_WARNING, "[input-overlay] Fatal errors occured while loading config file");
+            flag = false;
+        }
+    }
+
+    if (!flag)
+        return false;
+
+    header.magic = LAYOUT_FILE_MAGIC;
+    header.version = LAYOUT_FILE_VERSION;
+    header.element_count = static_cast<uint16_t>(records.size());
+    header.source_mtime = mtime;
+
+    out.resize(sizeof(layout_header) + records.size() * sizeof(element_record));
+    memcpy(out.data(), &header, sizeof(layout_header));
+    if (!records.empty())
+        memcpy(out.data() + sizeof(layout_header), records.data(), records.size() * sizeof(element_record));
+    return true;
+}
+
+bool layout_file::map(const std::string &path, const int64_t mtime)
+{
+#ifdef _WIN32
+    wchar_t* wpath = nullptr;
+    os_utf8_to_wcs_ptr(path.c_str(), 0, &wpath);
+    const auto file = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, nullptr);
+    bfree(wpath);
+
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    const auto mapping = GetFileSizeEx(file, &size) && size.QuadPart > 0
+                         ? CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    const auto view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+    if (!view) {
+        if (mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    m_file_handle = file;
+    m_mapping_handle = mapping;
+    m_mapping = view;
+    m_mapping_size = static_cast<size_t>(size.QuadPart);
+#else
+    const auto fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info = {};
+    void* view = MAP_FAILED;
+
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+        view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); /* The mapping stays valid */
+
+    if (view == MAP_FAILED)
+        return false;
+
+    m_mapping = view;
+    m_mapping_size = static_cast<size_t>(info.st_size);
+#endif
+
+    if (!use(static_cast<const uint8_t*>(m_mapping), m_mapping_size, mtime)) {
+        unload();
+        return false;
+    }
+    return true;
+}
+
+bool layout_file::use(const uint8_t* data, const size_t size, const int64_t mtime)
+{
+    if (size < sizeof(layout_header))
+        return false;
+
+    const auto header = reinterpret_cast<const layout_header*>(data);
+    if (header->magic != LAYOUT_FILE_MAGIC || header->version != LAYOUT_FILE_VERSION)
+        return false;
+
+    /* Compiled layout is outdated */
+    if (mtime >= 0 && header->source_mtime != mtime)
+        return false;
+
+    if (size < sizeof(layout_header) + header->element_count * sizeof(element_record))
+        return false;
+
+    m_header = header;
+    m_records = reinterpret_cast<const element_record*>(data + sizeof(layout_header));
+    return true;
+}
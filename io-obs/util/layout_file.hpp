@@ -0,0 +1,105 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/* Compiled layouts are stored next to the .ini with this extension */
+#define LAYOUT_FILE_EXT         ".iol"
+#define LAYOUT_FILE_MAGIC       0x214C4F49 /* "IOL!" */
+#define LAYOUT_FILE_VERSION     1
+
+/* element_record flags */
+#define LR_TRIGGER_BUTTON_MODE  (1 << 0)
+#define LR_MOUSE_ARROW          (1 << 1)
+
+/* Compiled layout file: a layout_header followed by element_count
+ * element_records in drawing order. Everything is stored in native
+ * byte order, a file from a different architecture fails the magic
+ * check and is simply compiled again
+ */
+struct layout_header
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t element_count;
+    int64_t source_mtime; /* Modification time of the .ini this was compiled from */
+    uint32_t width, height;
+    uint8_t layout_flags; /* See overlay_flag in layout_constants.hpp */
+    uint8_t debug;
+    uint8_t reserved[6];
+};
+
+struct element_record
+{
+    int16_t type;
+    uint16_t keycode;
+    int32_t pos_x, pos_y;
+    int32_t map_x, map_y, map_w, map_h;
+    int8_t side;
+    uint8_t direction;
+    uint8_t flags;
+    uint8_t radius; /* Stick or mouse movement radius */
+};
+
+static_assert(sizeof(layout_header) == 32, "layout_header has to be tightly packed");
+static_assert(sizeof(element_record) == 32, "element_record has to be tightly packed");
+
+/* Read only view of a compiled layout. The compiled file is mapped
+ * into memory and used without any parsing. If it doesn't exist or
+ * is older than the .ini it's compiled from the .ini first
+ */
+class layout_file
+{
+public:
+    layout_file() = default;
+
+    ~layout_file();
+
+    layout_file(const layout_file &) = delete;
+
+    layout_file &operator=(const layout_file &) = delete;
+
+    /* Returns false if neither a compiled layout nor the .ini could be loaded */
+    bool load(const std::string &ini_path);
+
+    void unload();
+
+    const layout_header* header() const
+    {
+        return m_header;
+    }
+
+    const element_record* records() const
+    {
+        return m_records;
+    }
+
+    /* Parses a .ini layout into the compiled format */
+    static bool compile(const std::string &ini_path, int64_t mtime, std::vector<uint8_t> &out);
+
+    static std::string compiled_path(const std::string &ini_path);
+
+private:
+    bool map(const std::string &path, int64_t mtime);
+
+    bool use(const uint8_t* data, size_t size, int64_t mtime);
+
+    const layout_header* m_header = nullptr;
+    const element_record* m_records = nullptr;
+
+    void* m_mapping = nullptr;
+    size_t m_mapping_size = 0;
+#ifdef _WIN32
+    void* m_file_handle = nullptr;
+    void* m_mapping_handle = nullptr;
+#endif
+    std::vector<uint8_t> m_compiled; /* Used if the compiled layout couldn't be written */
+};
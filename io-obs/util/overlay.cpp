@@ -6,8 +6,9 @@
  */
 
 #include "gui/io_settings_dialog.hpp"
-#include "../../ccl/ccl.hpp"
 #include "overlay.hpp"
+#include "layout_file.hpp"
+#include "resource_cache.hpp"
 #include "layout_constants.hpp"
 #include "element/element_button.hpp"
 #include "element/element_data_holder.hpp"
@@ -18,13 +19,13 @@
 #include "../sources/input_source.hpp"
 #include "element/element_gamepad_id.hpp"
 #include "element/element_dpad.hpp"
-#include "network/remote_connection.hpp"
-#include "network/io_server.hpp"
+#include "input_state.hpp"
 #include "element/element_mouse_movement.hpp"
 #include "config.hpp"
 
 extern "C" {
 #include <graphics/image-file.h>
+#include <graphics/vec4.h>
 }
 
 namespace sources
@@ -64,7 +65,7 @@ void overlay::unload()
 {
     unload_texture();
     unload_elements();
-    m_data.clear();
+    m_source = nullptr;
     m_settings->gamepad = 0;
     m_settings->cx = 100;
     m_settings->cy = 100;
@@ -75,74 +76,27 @@ bool overlay::load_cfg()
     if (!m_settings || m_settings->layout_file.empty())
         return false;
 
-    auto cfg = new ccl_config(m_settings->layout_file, "");
-    auto flag = true;
-
-    if (!cfg->has_fatal_errors()) {
-        m_settings->cx = static_cast<uint32_t>(cfg->get_int(CFG_TOTAL_WIDTH, true));
-        m_settings->cy = static_cast<uint32_t>(cfg->get_int(CFG_TOTAL_HEIGHT, true));
-        m_settings->layout_flags = cfg->get_int(CFG_FLAGS, true);
+    m_layout = resource_cache::get_layout(m_settings->layout_file);
+    if (!m_layout)
+        return false;
 
-        auto element_id = cfg->get_string(CFG_FIRST_ID);
-        const auto debug_mode = cfg->get_bool(CFG_DEBUG_FLAG, true);
+    const auto header = m_layout->header();
+    m_settings->cx = header->width;
+    m_settings->cy = header->height;
+    m_settings->layout_flags = header->layout_flags;
 
 #ifndef _DEBUG
-        if (debug_mode)
-        {
+    if (header->debug)
+    {
 #else
-        {
+    {
 #endif
-            blog(LOG_INFO, "[input-overlay] Started loading of %s", m_settings->layout_file.c_str());
-        }
-
-        while (!element_id.empty()) {
-            load_element(cfg, element_id, debug_mode);
-            element_id = cfg->get_string(element_id + CFG_NEXT_ID, true);
-        }
+        blog(LOG_INFO, "[input-overlay] Started loading of %s", m_settings->layout_file.c_str());
     }
 
-    if (cfg->has_errors()) {
-        blog(LOG_WARNING, "[input-overlay] %s", cfg->get_error_message().c_str());
-        if (cfg->has_fatal_errors()) {
-            blog(LOG_WARNING, "[input-overlay] Fatal errors occured while loading config file");
-            flag = false;
-        } else {
-            /* Populate data map */
-            for (auto const &element : m_elements) {
-                element_data* data = nullptr;
-
-                switch (element->get_type()) {
-                    case ET_GAMEPAD_ID: /* Acts just like a button */
-                    case ET_BUTTON:
-                        data = new element_data_button(BS_RELEASED);
-                        break;
-                    case ET_WHEEL:
-                        data = new element_data_wheel(BS_RELEASED);
-                        break;
-                    case ET_TRIGGER:
-                        data = new element_data_trigger(0.f, 0.f);
-                        break;
-                    case ET_ANALOG_STICK:
-                        data = new element_data_analog_stick(false, false, 0.f, 0.f, 0.f, 0.f);
-                        break;
-                    case ET_DPAD_STICK:
-                        data = new element_data_dpad(DD_LEFT, BS_RELEASED);
-                        break;
-                    case ET_MOUSE_STATS:
-                        data = new element_data_mouse_pos(0, 0);
-                        break;
-                    default:;
-                }
-
-                if (data)
-                    m_data[element->get_keycode()] = std::unique_ptr<element_data>(data);
-
-            }
-        }
-    }
-
-    delete cfg;
-    return flag;
+    for (auto i = 0; i < header->element_count; i++)
+        load_element(&m_layout->records()[i], header->debug);
+    return true;
 }
 
 bool overlay::load_texture()
@@ -150,98 +104,157 @@ bool overlay::load_texture()
     if (!m_settings || m_settings->image_file.empty())
         return false;
 
-    auto flag = true;
-
-    if (m_image == nullptr) {
-        m_image = new gs_image_file_t();
-    }
+    m_image = resource_cache::get_texture(m_settings->image_file);
 
-    gs_image_file_init(m_image, m_settings->image_file.c_str());
-
-    obs_enter_graphics();
-    gs_image_file_init_texture(m_image);
-    obs_leave_graphics();
-
-    if (!m_image->loaded) {
+    if (!m_image) {
         blog(LOG_WARNING, "[input-overlay] Error: failed to load texture %s", m_settings->image_file.c_str());
-        flag = false;
-    } else {
-        m_settings->cx = m_image->cx;
-        m_settings->cy = m_image->cy;
+        return false;
     }
 
-    return flag;
+    m_settings->cx = m_image->cx;
+    m_settings->cy = m_image->cy;
+    return true;
 }
 
-void overlay::unload_texture() const
+void overlay::unload_texture()
 {
-    obs_enter_graphics();
-    gs_image_file_free(m_image);
-    obs_leave_graphics();
+    m_image = nullptr;
 }
 
 void overlay::unload_elements()
 {
+    obs_enter_graphics();
+    m_batch.destroy();
+    gs_texrender_destroy(m_cache);
+    obs_leave_graphics();
+    m_cache = nullptr;
+    m_cache_valid = false;
     m_elements.clear();
+    m_layout = nullptr;
+    m_quad_count = 0;
+    m_batch_source = nullptr;
 }
 
 void overlay::draw(gs_effect_t* effect)
 {
-    if (m_is_loaded) {
-        for (auto const &element : m_elements) {
-            const auto data = m_data[element->get_keycode()].get();
-            element->draw(effect, m_image, data, m_settings);
-        }
+    if (!m_is_loaded)
+        return;
+
+    if (!m_batch.valid()) {
+        if (!m_batch.init(m_image->texture, m_quad_count))
+            return;
+        m_batch_dirty = true;
     }
+
+    update_batch();
+
+    if (m_settings->render_cached)
+        draw_cached(effect);
+    else
+        m_batch.draw(effect);
+
+    if (m_source)
+        input_state::mark_drawn(m_settings->selected_source);
 }
 
-void overlay::refresh_data()
+void overlay::update_batch()
 {
-    /* This copies over necessary element data information
-     * to make sure the overlay always has data available to
-     * draw the overlay. If the data was directly accessed in the render
-     * method, the overlay can start to flicker if the frame is rendered
-     * while the data is currently inaccessible, because it is being written
-     * to by the input thread, resulting in all buttons being unpressed
-     */
-    if (io_config::io_window_filters.input_blocked())
+    /* Elements only write their quads again if the input data or the
+     * settings changed, otherwise last frame's vertex buffer is reused */
+    const auto version = m_source ? m_source->get_version() : 0;
+
+    if (!m_batch_dirty && m_source == m_batch_source && version == m_batch_version)
         return;
-    element_data_holder* source = nullptr;
-    std::lock_guard<std::mutex> lck1(hook::mutex);
-    std::lock_guard<std::mutex> lck2(network::mutex);
-
-    if (hook::data_initialized || network::network_flag) {
-        if (network::server_instance && m_settings->selected_source > 0) {
-            source = network::server_instance->get_client(m_settings->selected_source - 1)->get_data();
-        } else {
-            source = hook::input_data;
-        }
-    }
 
-    if (source) {
-        for (auto const &element : m_elements) {
-            element_data* data = nullptr;
+    m_batch.reset();
+    for (auto const &element : m_elements) {
+        const element_data* data = nullptr;
 
-             if (m_data[element->get_keycode()] != nullptr) {
-                switch (element->get_source()) {
-                    case DS_GAMEPAD:
-                        data = source->get_by_gamepad(m_settings->gamepad, element->get_keycode());
-                        break;
-                    default:
+        if (m_source) {
+            switch (element->get_source()) {
+                case DS_GAMEPAD:
+                    data = m_source->get_by_gamepad(m_settings->gamepad, element->get_keycode());
+                    break;
+                default:
                 case DS_MOUSE_POS:
                 case DS_DEFAULT:
-                        data = source->get_by_code(element->get_keycode());
-                        break;
-                }
-                m_data[element->get_keycode()]->merge(data);
+                    data = m_source->get_by_code(element->get_keycode());
+                    break;
             }
         }
+        m_batch.begin(element->get_quad_count());
+        element->draw(&m_batch, data, m_settings);
+        m_batch.end();
+    }
+
+    m_batch_source = m_source;
+    m_batch_version = version;
+    m_batch_dirty = false;
+}
+
+void overlay::draw_cached(gs_effect_t* effect)
+{
+    if (!m_cache) {
+        m_cache = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+        m_cache_valid = false;
+    }
+
+    if (m_batch.dirty() || !m_cache_valid) {
+        gs_texrender_reset(m_cache);
+
+        if (gs_texrender_begin(m_cache, m_settings->cx, m_settings->cy)) {
+            vec4 clear_color;
+            vec4_zero(&clear_color);
+            gs_clear(GS_CLEAR_COLOR, &clear_color, 0.f, 0);
+            gs_ortho(0.f, float(m_settings->cx), 0.f, float(m_settings->cy), -100.f, 100.f);
+
+            /* Cached texture has premultiplied alpha, so overlapping
+             * elements blend the same way as when drawn directly */
+            gs_blend_state_push();
+            gs_blend_function_separate(GS_BLEND_SRCALPHA, GS_BLEND_INVSRCALPHA, GS_BLEND_ONE,
+                                       GS_BLEND_INVSRCALPHA);
+            m_batch.draw(effect);
+            gs_blend_state_pop();
+
+            gs_texrender_end(m_cache);
+            m_cache_valid = true;
+        }
     }
+
+    const auto texture = gs_texrender_get_texture(m_cache);
+    if (!texture)
+        return;
+
+    gs_blend_state_push();
+    gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+    gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"), texture);
+    gs_draw_sprite(texture, 0, m_settings->cx, m_settings->cy);
+    gs_blend_state_pop();
+}
+
+void overlay::invalidate()
+{
+    m_batch_dirty = true;
+    m_cache_valid = false;
+}
+
+void overlay::refresh_data()
+{
+    /* Input data is shared between all sources and only updated
+     * once per frame in input_state::sync(), so it can be read directly
+     * in draw() without any copying or locking. No input is shown while
+     * input is blocked by a window filter */
+    if (io_config::io_window_filters.input_blocked()) {
+        m_source = nullptr;
+        return;
+    }
+
+    m_source = input_state::get(m_settings->selected_source);
 }
 
-void overlay::load_element(ccl_config* cfg, const std::string &id, const bool debug)
+void overlay::load_element(const element_record* record, const bool debug)
 {
-    const auto type = cfg->get_int(id + CFG_TYPE);
+    const auto type = record->type;
     element* new_element = nullptr;
 
     switch (type) {
@@ -271,11 +284,12 @@ void overlay::load_element(ccl_config* cfg, const std::string &id, const bool de
             break;
         default:
             if (debug)
-                blog(LOG_INFO, "[input-overlay] Invalid element type %i for %s", type, id.c_str());
+                blog(LOG_INFO, "[input-overlay] Invalid element type %i", type);
     }
 
     if (new_element) {
-        new_element->load(cfg, id);
+        new_element->load(record);
+        m_quad_count += new_element->get_quad_count();
         m_elements.emplace_back(new_element);
 
 #ifndef _DEBUG
@@ -283,8 +297,8 @@ void overlay::load_element(ccl_config* cfg, const std::string &id, const bool de
 #else
         {
 #endif
-            blog(LOG_INFO, "[input-overlay]  Type: %14s, KEYCODE: 0x%04X ID: %s",
-                 element_type_to_string(static_cast<element_type>(type)), new_element->get_keycode(), id.c_str());
+            blog(LOG_INFO, "[input-overlay]  Type: %14s, KEYCODE: 0x%04X",
+                 element_type_to_string(static_cast<element_type>(type)), new_element->get_keycode());
         }
     }
 }
@@ -15,14 +15,18 @@
 
 #include <memory>
 #include <vector>
-#include <map>
 #include "element/element.hpp"
+#include "sprite_batch.hpp"
 #include "../hook/hook_helper.hpp"
 
-class ccl_config;
+struct element_record;
+
+class layout_file;
 
 class element_data;
 
+class element_data_holder;
+
 typedef struct gs_image_file gs_image_file_t;
 
 class overlay
@@ -42,6 +46,10 @@ public:
 
     void refresh_data();
 
+    /* Forces all elements to be drawn again, has
+     * to be called if the overlay settings changed */
+    void invalidate();
+
     bool is_loaded() const
     {
         return m_is_loaded;
@@ -49,7 +57,7 @@ public:
 
     gs_image_file_t* get_texture() const
     {
-        return m_image;
+        return m_image.get();
     }
 
 private:
@@ -57,21 +65,39 @@ private:
 
     bool load_texture();
 
-    void unload_texture() const;
+    void unload_texture();
 
     void unload_elements();
 
-    void load_element(ccl_config* cfg, const std::string &id, bool debug);
+    /* Lets all elements write their quads again if input changed */
+    void update_batch();
+
+    /* Draws the batch into m_cache if it changed and then only draws m_cache */
+    void draw_cached(gs_effect_t* effect);
+
+    void load_element(const element_record* record, bool debug);
 
     static const char* element_type_to_string(element_type t);
 
-    gs_image_file_t* m_image = nullptr;
+    /* Shared with all other sources using the same files */
+    std::shared_ptr<gs_image_file_t> m_image;
+    std::shared_ptr<const layout_file> m_layout;
 
     sources::overlay_settings* m_settings = nullptr;
 
     bool m_is_loaded = false;
     std::vector<std::unique_ptr<element>> m_elements;
-    std::map<uint16_t, std::unique_ptr<element_data>> m_data;
+    element_data_holder* m_source = nullptr; /* Selected input data, updated every tick */
+
+    /* All elements are drawn as quads in one batch */
+    sprite_batch m_batch;
+    uint32_t m_quad_count = 0;
+    const element_data_holder* m_batch_source = nullptr; /* Data the batch was built from */
+    uint64_t m_batch_version = 0;
+    bool m_batch_dirty = true;
+
+    gs_texrender_t* m_cache = nullptr; /* Only used if render_cached is enabled */
+    bool m_cache_valid = false;
 
     uint16_t m_track_radius{};
     uint16_t m_max_mouse_movement{};
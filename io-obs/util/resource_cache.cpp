@@ -0,0 +1,100 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#include "resource_cache.hpp"
+#include "layout_file.hpp"
+#include "util.hpp"
+#include <util/platform.h>
+#include <sys/stat.h>
+#include <map>
+#include <mutex>
+
+extern "C" {
+#include <graphics/image-file.h>
+}
+
+namespace resource_cache
+{
+    template<class T>
+    struct entry
+    {
+        int64_t mtime;
+        std::weak_ptr<T> data;
+    };
+
+    static std::mutex mutex;
+    static std::map<std::string, entry<const layout_file>> layouts;
+    static std::map<std::string, entry<gs_image_file_t>> textures;
+
+    static int64_t file_mtime(const std::string &path)
+    {
+        struct stat info = {};
+        if (os_stat(path.c_str(), &info) != 0)
+            return -1;
+        return info.st_mtime;
+    }
+
+    /* Returns the cached data, if it's still in use by a source and the file didn't change */
+    template<class T>
+    static std::shared_ptr<T> find(std::map<std::string, entry<T>> &map, const std::string &path,
+                                   const int64_t mtime)
+    {
+        const auto it = map.find(path);
+        if (it == map.end())
+            return nullptr;
+
+        auto data = it->second.data.lock();
+        if (!data || it->second.mtime != mtime) {
+            map.erase(it);
+            return nullptr;
+        }
+        return data;
+    }
+
+    std::shared_ptr<const layout_file> get_layout(const std::string &path)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto mtime = file_mtime(path);
+        auto layout = find(layouts, path, mtime);
+
+        if (!layout) {
+            auto new_layout = std::make_shared<layout_file>();
+            if (!new_layout->load(path))
+                return nullptr;
+            layout = new_layout;
+            layouts[path] = {mtime, layout};
+        }
+        return layout;
+    }
+
+    std::shared_ptr<gs_image_file_t> get_texture(const std::string &path)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto mtime = file_mtime(path);
+        auto texture = find(textures, path, mtime);
+
+        if (!texture) {
+            /* Textures have to be freed inside the graphics context */
+            texture = std::shared_ptr<gs_image_file_t>(new gs_image_file_t(), [](gs_image_file_t* image) {
+                obs_enter_graphics();
+                gs_image_file_free(image);
+                obs_leave_graphics();
+                delete image;
+            });
+
+            gs_image_file_init(texture.get(), path.c_str());
+            obs_enter_graphics();
+            gs_image_file_init_texture(texture.get());
+            obs_leave_graphics();
+
+            if (!texture->loaded)
+                return nullptr;
+            textures[path] = {mtime, texture};
+        }
+        return texture;
+    }
+}
@@ -0,0 +1,30 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+class layout_file;
+
+typedef struct gs_image_file gs_image_file_t;
+
+/* Process wide cache for layouts and textures, so sources using
+ * the same files share them instead of loading them again. Entries
+ * are keyed by path and modification time and are released once the
+ * last source using them lets go of its reference
+ */
+namespace resource_cache
+{
+    /* Returns nullptr if the layout couldn't be loaded */
+    std::shared_ptr<const layout_file> get_layout(const std::string &path);
+
+    /* Returns nullptr if the image couldn't be loaded, has to
+     * be called outside of the graphics context */
+    std::shared_ptr<gs_image_file_t> get_texture(const std::string &path);
+}
@@ -0,0 +1,161 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#include "sprite_batch.hpp"
+#include "util.hpp"
+#include <util/bmem.h>
+
+/* Quads are drawn as two triangles without an index buffer */
+#define QUAD_VERTICES 6
+
+/* Corner (top left, top right, bottom left, bottom right) of each quad vertex */
+static const uint8_t quad_corners[QUAD_VERTICES] = {0, 1, 2, 2, 1, 3};
+
+sprite_batch::~sprite_batch()
+{
+    if (m_vertex_buffer)
+        blog(LOG_WARNING, "[input-overlay] Sprite batch wasn't destroyed inside the graphics context");
+}
+
+bool sprite_batch::init(gs_texture_t* texture, const uint32_t quad_count)
+{
+    destroy();
+
+    if (!texture || !quad_count)
+        return false;
+
+    const auto vertices = quad_count * QUAD_VERTICES;
+    auto data = gs_vbdata_create();
+    data->num = vertices;
+    data->points = static_cast<vec3*>(bzalloc(sizeof(vec3) * vertices));
+    data->num_tex = 1;
+    data->tvarray = static_cast<gs_tvertarray*>(bzalloc(sizeof(gs_tvertarray)));
+    data->tvarray[0].width = 2;
+    data->tvarray[0].array = bzalloc(sizeof(vec2) * vertices);
+
+    m_vertex_buffer = gs_vertexbuffer_create(data, GS_DYNAMIC);
+    if (!m_vertex_buffer) {
+        blog(LOG_ERROR, "[input-overlay] Couldn't create vertex buffer for %u quads", quad_count);
+        return false;
+    }
+
+    /* The buffer owns the data now, but it stays valid for updates */
+    data = gs_vertexbuffer_get_data(m_vertex_buffer);
+    m_points = data->points;
+    m_uvs = static_cast<vec2*>(data->tvarray[0].array);
+    m_texture = texture;
+    m_texture_width = UTIL_MAX(gs_texture_get_width(texture), 1u);
+    m_texture_height = UTIL_MAX(gs_texture_get_height(texture), 1u);
+    m_quad_count = quad_count;
+    m_dirty = true;
+    reset();
+    return true;
+}
+
+void sprite_batch::destroy()
+{
+    gs_vertexbuffer_destroy(m_vertex_buffer);
+    m_vertex_buffer = nullptr;
+    m_texture = nullptr;
+    m_points = nullptr;
+    m_uvs = nullptr;
+    m_quad_count = 0;
+    reset();
+}
+
+void sprite_batch::reset()
+{
+    m_cursor = 0;
+    m_range_end = 0;
+}
+
+void sprite_batch::begin(const uint8_t count)
+{
+    m_cursor = m_range_end;
+    m_range_end = UTIL_MIN(m_range_end + count, m_quad_count);
+}
+
+void sprite_batch::end()
+{
+    static const vec2 hidden[4] = {};
+    while (m_cursor < m_range_end)
+        write_quad(hidden, nullptr);
+}
+
+void sprite_batch::add(const gs_rect* rect, const vec2* pos)
+{
+    vec2 corners[4];
+    vec2_set(&corners[0], pos->x, pos->y);
+    vec2_set(&corners[1], pos->x + rect->cx, pos->y);
+    vec2_set(&corners[2], pos->x, pos->y + rect->cy);
+    vec2_set(&corners[3], pos->x + rect->cx, pos->y + rect->cy);
+    write_quad(corners, rect);
+}
+
+void sprite_batch::add(const gs_rect* rect, const vec2* pos, const float angle)
+{
+    /* Same transformation, which was previously done with the matrix stack:
+     * the quad is centered on the origin, rotated and then moved to
+     * pos + (-width / 2, height / 2) */
+    const auto half_w = rect->cx / 2.f, half_h = rect->cy / 2.f;
+    const auto c = cosf(angle), s = sinf(angle);
+    const float local[4][2] = {{-half_w, -half_h}, {half_w, -half_h}, {-half_w, half_h}, {half_w, half_h}};
+    vec2 corners[4];
+
+    for (auto i = 0; i < 4; i++) {
+        vec2_set(&corners[i], pos->x - half_w + local[i][0] * c - local[i][1] * s,
+                 pos->y + half_h + local[i][0] * s + local[i][1] * c);
+    }
+    write_quad(corners, rect);
+}
+
+void sprite_batch::write_quad(const vec2 corners[4], const gs_rect* rect)
+{
+    if (m_cursor >= m_range_end)
+        return;
+
+    vec2 uvs[4] = {};
+    if (rect) {
+        const auto u0 = rect->x / m_texture_width, u1 = (rect->x + rect->cx) / m_texture_width;
+        const auto v0 = rect->y / m_texture_height, v1 = (rect->y + rect->cy) / m_texture_height;
+        vec2_set(&uvs[0], u0, v0);
+        vec2_set(&uvs[1], u1, v0);
+        vec2_set(&uvs[2], u0, v1);
+        vec2_set(&uvs[3], u1, v1);
+    }
+
+    const auto first = m_cursor * QUAD_VERTICES;
+    for (auto i = 0; i < QUAD_VERTICES; i++) {
+        const auto &corner = corners[quad_corners[i]];
+        const auto &uv = uvs[quad_corners[i]];
+        auto &point = m_points[first + i];
+        auto &tex = m_uvs[first + i];
+
+        if (point.x != corner.x || point.y != corner.y || tex.x != uv.x || tex.y != uv.y) {
+            vec3_set(&point, corner.x, corner.y, 0.f);
+            vec2_set(&tex, uv.x, uv.y);
+            m_dirty = true;
+        }
+    }
+    m_cursor++;
+}
+
+void sprite_batch::draw(gs_effect_t* effect)
+{
+    if (!m_vertex_buffer)
+        return;
+
+    if (m_dirty) {
+        gs_vertexbuffer_flush(m_vertex_buffer);
+        m_dirty = false;
+    }
+
+    gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"), m_texture);
+    gs_load_vertexbuffer(m_vertex_buffer);
+    gs_load_indexbuffer(nullptr);
+    gs_draw(GS_TRIS, 0, m_quad_count * QUAD_VERTICES);
+}
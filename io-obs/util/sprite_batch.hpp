@@ -0,0 +1,70 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <graphics/graphics.h>
+#include <graphics/vec2.h>
+#include <stdint.h>
+
+/* Collects textured quads from one texture atlas in a single
+ * vertex buffer, so a whole overlay is drawn with one draw call.
+ * Every element owns a fixed range of quads, which it rewrites with
+ * begin()/add()/end(). Quads are only uploaded again if their
+ * vertices actually changed
+ */
+class sprite_batch
+{
+public:
+    ~sprite_batch();
+
+    /* Both have to be called inside the graphics context */
+    bool init(gs_texture_t* texture, uint32_t quad_count);
+
+    void destroy();
+
+    bool valid() const
+    {
+        return m_vertex_buffer != nullptr;
+    }
+
+    /* True if quads changed since the last draw() */
+    bool dirty() const
+    {
+        return m_dirty;
+    }
+
+    /* Starts writing the quads of the next element, which
+     * owns count quads. Has to be called in element order */
+    void begin(uint8_t count);
+
+    /* Hides all quads of the current element, which weren't written */
+    void end();
+
+    /* Rewinds to the first element */
+    void reset();
+
+    void add(const gs_rect* rect, const vec2* pos);
+
+    /* Rotates the quad by angle (radians) around its center */
+    void add(const gs_rect* rect, const vec2* pos, float angle);
+
+    void draw(gs_effect_t* effect);
+
+private:
+    void write_quad(const vec2 corners[4], const gs_rect* rect);
+
+    gs_vertbuffer_t* m_vertex_buffer = nullptr;
+    gs_texture_t* m_texture = nullptr;
+    vec3* m_points = nullptr;
+    vec2* m_uvs = nullptr;
+    uint32_t m_quad_count = 0;
+    uint32_t m_cursor = 0; /* Next quad that will be written */
+    uint32_t m_range_end = 0; /* End of the current elements quads */
+    float m_texture_width = 1.f, m_texture_height = 1.f;
+    bool m_dirty = false;
+};
@@ -0,0 +1,70 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/* Bounded lock free queue for exactly one producer thread
+ * and one consumer thread. Neither side ever blocks, if the
+ * ring is full push() drops the item and counts it as overflow.
+ * Capacity has to be a power of two so the read/write indices can
+ * be wrapped with a mask
+ */
+template<class T, size_t Capacity>
+class spsc_ring
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "spsc_ring capacity must be a power of two");
+
+public:
+    /* Producer only. Fails unless more than reserved slots are free, which lets
+     * the producer keep room for items that must never be dropped */
+    bool push(const T &item, const size_t reserved = 0)
+    {
+        const auto write = m_write.load(std::memory_order_relaxed);
+        if (write - m_read.load(std::memory_order_acquire) + reserved >= Capacity) {
+            m_overflow.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        m_items[write & (Capacity - 1)] = item;
+        m_write.store(write + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* Consumer only */
+    bool pop(T &out)
+    {
+        const auto read = m_read.load(std::memory_order_relaxed);
+        if (read == m_write.load(std::memory_order_acquire))
+            return false;
+
+        out = m_items[read & (Capacity - 1)];
+        m_read.store(read + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* Amount of items, which were dropped because the ring was full */
+    uint64_t overflow() const
+    {
+        return m_overflow.load(std::memory_order_relaxed);
+    }
+
+    size_t capacity() const
+    {
+        return Capacity;
+    }
+
+private:
+    /* Keep producer and consumer indices on separate cache lines */
+    alignas(64) std::atomic<size_t> m_write{0};
+    alignas(64) std::atomic<size_t> m_read{0};
+    alignas(64) std::atomic<uint64_t> m_overflow{0};
+    T m_items[Capacity];
+};
@@ -0,0 +1,59 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the GPL v2.0
+ * See LICENSE or http://www.gnu.org/licenses
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/* Wait free hand off of complete state snapshots from one
+ * producer thread to one consumer thread. The producer fills
+ * back() and publishes it, the consumer swaps in the newest
+ * published buffer with acquire() and reads it through front().
+ * Neither side ever waits for the other, intermediate snapshots
+ * are skipped if the consumer is slower than the producer
+ */
+template<class T>
+class triple_buffer
+{
+    static const uint8_t index_mask = 0x3;
+    static const uint8_t dirty_bit = 0x4;
+
+public:
+    /* Producer only */
+    T &back()
+    {
+        return m_buffers[m_back];
+    }
+
+    /* Producer only, back() will point to a different buffer afterwards */
+    void publish()
+    {
+        m_back = m_middle.exchange(m_back | dirty_bit, std::memory_order_acq_rel) & index_mask;
+    }
+
+    /* Consumer only, returns true if a new snapshot was swapped in */
+    bool acquire()
+    {
+        if (!(m_middle.load(std::memory_order_relaxed) & dirty_bit))
+            return false;
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & index_mask;
+        return true;
+    }
+
+    /* Consumer only */
+    const T &front() const
+    {
+        return m_buffers[m_front];
+    }
+
+private:
+    T m_buffers[3];
+    std::atomic<uint8_t> m_middle{1};
+    uint8_t m_back = 0;
+    uint8_t m_front = 2;
+};
@@ -50,6 +50,7 @@
 #define S_REGION                        "input-overlay"
 #define S_UIOHOOK                       "iohook"
 #define S_GAMEPAD                       "gamepad"
+#define S_PAD_EVDEV                     "pad_evdev"
 #define S_OVERLAY                       "overlay"
 #define S_HISTORY                       "history"
 #define S_REMOTE                        "remote"
@@ -106,14 +107,13 @@
 #define S_MONITOR_USE_CENTER            "io.monitor_use_center"
 #define S_MONITOR_H_CENTER              "io.monitor_h_center"
 #define S_MONITOR_V_CENTER              "io.monitor_v_center"
-#define S_RELOAD_PAD_DEVICES            "io.reload_pads"
+#define S_RENDER_CACHED                 "io.render_cached"
 
 #define T_TEXTURE_FILE                  T_("Overlay.Path.Texture")
 #define T_LAYOUT_FILE                   T_("Overlay.Path.Layout")
 #define T_FILTER_IMAGE_FILES            T_("Filter.ImageFiles")
 #define T_FILTER_TEXT_FILES             T_("Filter.TextFiles")
 #define T_FILTER_ALL_FILES              T_("Filter.AllFiles")
-#define T_RELOAD_PAD_DEVICES            T_("Gamepad.Reload")
 #define T_CONTROLLER_ID                 T_("Gamepad.Id")
 #define T_CONROLLER_L_DEADZONE          T_("Gamepad.LeftDeadZone")
 #define T_CONROLLER_R_DEADZONE          T_("Gamepad.RightDeadZone")
@@ -122,6 +122,7 @@
 #define T_MONITOR_USE_CENTER            T_("Mouse.UseCenter")
 #define T_MONITOR_H_CENTER              T_("Monitor.CenterX")
 #define T_MONITOR_V_CENTER              T_("Monitor.CenterY")
+#define T_RENDER_CACHED                 T_("Overlay.RenderCached")
 
 /* Lang Input History */
 #define S_HISTORY_SIZE                  "io.history_size"
@@ -214,7 +215,15 @@
 #define VC_DPAD_DATA                    0xEC32u
 
 #define PAD_TO_VC(a)                    (a | VC_PAD_MASK)
-#define PAD_COUNT 4
+
+/* Pads the local gamepad hook reads, remote pads can use any one byte id */
+#ifndef IO_CLIENT
+#ifdef _WIN32
+#define PAD_COUNT 4 /* XInput only has four users */
+#else
+#define PAD_COUNT 16
+#endif
+#endif
 
 #define VC_PAD_A                        ( 0u | VC_PAD_MASK)
 #define VC_PAD_B                        ( 1u | VC_PAD_MASK)
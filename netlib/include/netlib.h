@@ -257,10 +257,17 @@ extern DECLSPEC void NETLIB_CALL netlib_udp_close(udp_socket sock);
 
 typedef struct _netlib_socket_set* netlib_socket_set;
 
+#ifdef _WIN32
+typedef uintptr_t netlib_native_socket; /* SOCKET */
+#else
+typedef int netlib_native_socket;
+#endif
+
 /* Any network socket can be safely cast to this socket type */
 typedef struct _netlib_generic_socket
 {
 	int ready;
+	netlib_native_socket channel;
 }* netlib_generic_socket;
 
 /* Allocate a socket set for use with netlib_check_socket_set()
@@ -316,6 +323,17 @@ FORCE_INLINE int _netlib_socket_ready(netlib_generic_socket sock)
 	return (sock != NULL) && (sock->ready);
 }
 
+/* The native socket of a tcp or udp socket, so it can be waited on with
+   poll() or epoll instead of a socket set. Reading and writing should
+   still be done through netlib.
+*/
+#define netlib_socket_fd(sock) _netlib_socket_fd((netlib_generic_socket)(sock))
+
+FORCE_INLINE netlib_native_socket _netlib_socket_fd(netlib_generic_socket sock)
+{
+	return sock->channel;
+}
+
 /* Free a set of sockets allocated by netlib_alloc_socket_set() */
 extern DECLSPEC void NETLIB_CALL netlib_free_socket_set(netlib_socket_set set);
 